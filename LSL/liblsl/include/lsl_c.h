@@ -812,6 +812,39 @@ extern LIBLSL_C_API unsigned long lsl_pull_chunk_str(lsl_inlet in, char **data_b
 
 extern LIBLSL_C_API unsigned long lsl_pull_chunk_buf(lsl_inlet in, char **data_buffer, unsigned *lengths_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, int *ec);
 
+/**
+* Pull a chunk of data from the inlet, returning as soon as a given minimum number of samples has arrived.
+* This is the same as lsl_pull_chunk_* (lsl_pull_chunk_min_buf corresponds to lsl_pull_chunk_buf, with the
+* lengths of the binary strings in lengths_buffer) except that the function does not wait for the entire buffer to be filled:
+* it returns once min_samples samples have been received (or the timeout has expired), so that real-time 
+* applications can be woken up once per block of samples rather than once per sample.
+* IMPORTANT: Note that the provided data buffer size is measured in channel values (e.g., floats) rather than in samples.
+* @param in The lsl_inlet object to act on.
+* @param data_buffer A pointer to a buffer of data values where the results shall be stored.
+* @param timestamp_buffer A pointer to a buffer of timestamp values where time stamps shall be stored. 
+*                         If this is NULL, no time stamps will be returned.
+* @param data_buffer_elements The size of the data buffer, in channel data elements (of type T). 
+*                             Must be a multiple of the stream's channel count.
+* @param timestamp_buffer_elements The size of the timestamp buffer. If a timestamp buffer is provided then this 
+*                                  must correspond to the same number of samples as data_buffer_elements.
+* @param timeout The timeout for this operation, if any. When the timeout expires, the function may return
+*                fewer than min_samples samples.
+* @param min_samples The number of samples to wait for (at most the capacity of the buffer; 0 returns only data 
+*                    available for immediate pickup).
+* @param ec Error code: can be either no error or lsl_lost_error (if the stream source has been lost).
+*           Note: if the timeout expires before min_samples samples were received the function returns what it has;
+*                 ec is *not* set to lsl_timeout_error (because this case is not considered an error condition).
+* @return data_elements_written Number of channel data elements written to the data buffer.
+*/
+extern LIBLSL_C_API unsigned long lsl_pull_chunk_min_f(lsl_inlet in, float *data_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, unsigned long min_samples, int *ec);
+extern LIBLSL_C_API unsigned long lsl_pull_chunk_min_d(lsl_inlet in, double *data_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, unsigned long min_samples, int *ec);
+extern LIBLSL_C_API unsigned long lsl_pull_chunk_min_l(lsl_inlet in, long *data_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, unsigned long min_samples, int *ec);
+extern LIBLSL_C_API unsigned long lsl_pull_chunk_min_i(lsl_inlet in, int *data_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, unsigned long min_samples, int *ec);
+extern LIBLSL_C_API unsigned long lsl_pull_chunk_min_s(lsl_inlet in, short *data_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, unsigned long min_samples, int *ec);
+extern LIBLSL_C_API unsigned long lsl_pull_chunk_min_c(lsl_inlet in, char *data_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, unsigned long min_samples, int *ec);
+extern LIBLSL_C_API unsigned long lsl_pull_chunk_min_str(lsl_inlet in, char **data_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, unsigned long min_samples, int *ec);
+extern LIBLSL_C_API unsigned long lsl_pull_chunk_min_buf(lsl_inlet in, char **data_buffer, unsigned *lengths_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, unsigned long min_samples, int *ec);
+
 /**
 * Query whether samples are currently available for immediate pickup.
 * Note that it is not a good idea to use samples_available() to determine whether 
@@ -829,6 +862,27 @@ extern LIBLSL_C_API unsigned lsl_samples_available(lsl_inlet in);
 */
 extern LIBLSL_C_API unsigned lsl_was_clock_reset(lsl_inlet in);
 
+/**
+* Query the number of samples that were dropped since the inlet was created.
+* This counts the samples that were discarded because the inlet's buffer (max_buflen) overflowed, and the samples
+* that were lost in transmission; the latter is only possible if the inlet receives the data feed as unacknowledged 
+* datagrams (see lsl_set_datagram_data()), which trades completeness for low latency.
+*/
+extern LIBLSL_C_API unsigned lsl_samples_dropped(lsl_inlet in);
+
+/**
+* Request the data feed of the inlet as unacknowledged datagrams instead of over TCP.
+* Lost samples are not retransmitted, so a late sample never holds up the subsequent ones (for closed-loop applications 
+* that prefer dropping a sample to waiting for it). The negotiation still runs over the TCP connection, and the inlet falls
+* back to TCP if no datagrams get through. This overrides the DatagramData and DatagramRedundancy settings of the config file.
+* @param in The lsl_inlet object to act on.
+* @param redundancy The number of times that each chunk is sent (in consecutive datagrams, to bridge isolated losses),
+*					 or 0 to receive the data over TCP.
+* @return The error code: if nonzero, can be lsl_argument_error if the redundancy is negative, or lsl_internal_error if 
+*		  the stream has already been opened (this must be called before).
+*/
+extern LIBLSL_C_API int lsl_set_datagram_data(lsl_inlet in, int redundancy);
+
 /**
 * Override the half-time (forget factor) of the time-stamp smoothing.
 * The default is 90 seconds unless a different value is set in the config file.
@@ -952,6 +952,39 @@ namespace lsl {
             return 0;
         }
 
+        /**
+        * Pull a chunk of data from the inlet into a pre-allocated buffer, returning as soon as a given minimum number of samples has arrived.
+        * This is the same as the above, except that the function does not wait for the entire buffer to be filled: it returns 
+        * once min_samples samples have been received (or the timeout has expired), so that real-time applications can be 
+        * woken up once per block of samples rather than once per sample.
+        * @param timeout The timeout for this operation. When the timeout expires, the function may return fewer than min_samples samples.
+        * @param min_samples The number of samples to wait for (at most the capacity of the buffer; 0 returns only data 
+        *                    available for immediate pickup).
+        * @return data_elements_written Number of channel data elements written to the data buffer.
+        * @throws lost_error (if the stream source has been lost).
+        */
+        std::size_t pull_chunk_multiplexed(float *data_buffer, double *timestamp_buffer, std::size_t data_buffer_elements, std::size_t timestamp_buffer_elements, double timeout, std::size_t min_samples) { int ec=0; std::size_t res = lsl_pull_chunk_min_f(obj,data_buffer,timestamp_buffer,(unsigned long)data_buffer_elements,(unsigned long)timestamp_buffer_elements,timeout,(unsigned long)min_samples,&ec); check_error(ec); return res; }
+        std::size_t pull_chunk_multiplexed(double *data_buffer, double *timestamp_buffer, std::size_t data_buffer_elements, std::size_t timestamp_buffer_elements, double timeout, std::size_t min_samples) { int ec=0; std::size_t res = lsl_pull_chunk_min_d(obj,data_buffer,timestamp_buffer,(unsigned long)data_buffer_elements,(unsigned long)timestamp_buffer_elements,timeout,(unsigned long)min_samples,&ec); check_error(ec); return res; }
+        std::size_t pull_chunk_multiplexed(long *data_buffer, double *timestamp_buffer, std::size_t data_buffer_elements, std::size_t timestamp_buffer_elements, double timeout, std::size_t min_samples) { int ec=0; std::size_t res = lsl_pull_chunk_min_l(obj,data_buffer,timestamp_buffer,(unsigned long)data_buffer_elements,(unsigned long)timestamp_buffer_elements,timeout,(unsigned long)min_samples,&ec); check_error(ec); return res; }
+        std::size_t pull_chunk_multiplexed(int *data_buffer, double *timestamp_buffer, std::size_t data_buffer_elements, std::size_t timestamp_buffer_elements, double timeout, std::size_t min_samples) { int ec=0; std::size_t res = lsl_pull_chunk_min_i(obj,data_buffer,timestamp_buffer,(unsigned long)data_buffer_elements,(unsigned long)timestamp_buffer_elements,timeout,(unsigned long)min_samples,&ec); check_error(ec); return res; }
+        std::size_t pull_chunk_multiplexed(short *data_buffer, double *timestamp_buffer, std::size_t data_buffer_elements, std::size_t timestamp_buffer_elements, double timeout, std::size_t min_samples) { int ec=0; std::size_t res = lsl_pull_chunk_min_s(obj,data_buffer,timestamp_buffer,(unsigned long)data_buffer_elements,(unsigned long)timestamp_buffer_elements,timeout,(unsigned long)min_samples,&ec); check_error(ec); return res; }
+        std::size_t pull_chunk_multiplexed(char *data_buffer, double *timestamp_buffer, std::size_t data_buffer_elements, std::size_t timestamp_buffer_elements, double timeout, std::size_t min_samples) { int ec=0; std::size_t res = lsl_pull_chunk_min_c(obj,data_buffer,timestamp_buffer,(unsigned long)data_buffer_elements,(unsigned long)timestamp_buffer_elements,timeout,(unsigned long)min_samples,&ec); check_error(ec); return res; }
+        std::size_t pull_chunk_multiplexed(std::string *data_buffer, double *timestamp_buffer, std::size_t data_buffer_elements, std::size_t timestamp_buffer_elements, double timeout, std::size_t min_samples) {
+            int ec = 0; 
+            if (data_buffer_elements) {
+                std::vector<char*> result_strings(data_buffer_elements);
+                std::vector<unsigned> result_lengths(data_buffer_elements); 
+                std::size_t num = lsl_pull_chunk_min_buf(obj,&result_strings[0],&result_lengths[0],timestamp_buffer,(unsigned long)data_buffer_elements,(unsigned long)timestamp_buffer_elements,timeout,(unsigned long)min_samples,&ec);
+                check_error(ec);
+                for (std::size_t k=0;k<num;k++) {
+                    data_buffer[k].assign(result_strings[k],result_lengths[k]);
+                    lsl_destroy_string(result_strings[k]);
+                }
+                return num;
+            };
+            return 0;
+        }
+
         /**
         * Pull a chunk of samples from the inlet.
         * This is the most complete version, returning both the data and a timestamp for each sample.
@@ -1021,6 +1054,25 @@ namespace lsl {
         */
         bool was_clock_reset() { return lsl_was_clock_reset(obj) != 0; }
 
+        /**
+        * Query the number of samples that were dropped since the inlet was created.
+        * This counts the samples that were discarded because the inlet's buffer (max_buflen) overflowed, and the samples
+        * that were lost in transmission; the latter is only possible if the inlet receives the data feed as unacknowledged 
+        * datagrams (see set_datagram_data()), which trades completeness for low latency.
+        */
+        std::size_t samples_dropped() { return lsl_samples_dropped(obj); }
+
+        /**
+        * Request the data feed of the inlet as unacknowledged datagrams instead of over TCP.
+        * Lost samples are not retransmitted, so a late sample never holds up the subsequent ones (for closed-loop applications 
+        * that prefer dropping a sample to waiting for it). The negotiation still runs over the TCP connection, and the inlet falls
+        * back to TCP if no datagrams get through. This overrides the DatagramData and DatagramRedundancy settings of the config file.
+        * Must be called before the stream is opened.
+        * @param redundancy The number of times that each chunk is sent (in consecutive datagrams, to bridge isolated losses),
+        *					 or 0 to receive the data over TCP.
+        */
+        void set_datagram_data(int redundancy=1) { check_error(lsl_set_datagram_data(obj,redundancy)); }
+
 		/**
 		* Override the half-time (forget factor) of the time-stamp smoothing.
 		* The default is 90 seconds unless a different value is set in the config file.
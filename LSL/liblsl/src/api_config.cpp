@@ -148,6 +148,7 @@ void api_config::load_from_file(const std::string &filename) {
 			multicast_ttl_ = ttl_override;
 		if (!address_override.empty())
 			multicast_addresses_ = address_override;
+		multicast_data_address_ = pt.get("multicast.DataAddress","239.255.172.216");
 
 		// read the [lab] settings
 		known_peers_ = parse_set(pt.get("lab.KnownPeers","{}"));
@@ -173,8 +174,24 @@ void api_config::load_from_file(const std::string &filename) {
 		outlet_buffer_reserve_samples_ = pt.get("tuning.OutletBufferReserveSamples",128);
 		inlet_buffer_reserve_ms_ = pt.get("tuning.InletBufferReserveMs",5000);
 		inlet_buffer_reserve_samples_ = pt.get("tuning.InletBufferReserveSamples",128);
+		outlet_buffer_reserve_bytes_ = pt.get("tuning.OutletBufferReserveBytes",32*1024*1024);
+		inlet_buffer_reserve_bytes_ = pt.get("tuning.InletBufferReserveBytes",32*1024*1024);
 		smoothing_halftime_ = pt.get("tuning.SmoothingHalftime",90.0f);
 		force_default_timestamps_ = pt.get("tuning.ForceDefaultTimestamps", false);
+		consumer_spin_time_ = pt.get("tuning.ConsumerSpinTime",0.0);
+		compression_ = pt.get("tuning.Compression",std::string("none"));
+		shared_memory_ = pt.get("tuning.SharedMemory",true);
+		in_process_ = pt.get("tuning.InProcess",true);
+		multicast_data_ = pt.get("tuning.MulticastData",false);
+		datagram_data_ = pt.get("tuning.DatagramData",false);
+		datagram_redundancy_ = pt.get("tuning.DatagramRedundancy",1);
+		multiplex_ = pt.get("tuning.Multiplex",false);
+		receive_buffer_size_ = std::max(512,pt.get("tuning.ReceiveBufferSize",65536));
+		inlet_reactor_ = pt.get("tuning.InletReactor",false);
+		outlet_io_threads_ = std::max(0,pt.get("tuning.OutletIOThreads",0));
+		share_host_clocks_ = pt.get("tuning.ShareHostClocks",false);
+		binary_time_probes_ = pt.get("tuning.BinaryTimeProbes",true);
+		kernel_timestamps_ = pt.get("tuning.KernelTimestamps",true);
 
 	} catch(std::exception &e) {
 		std::cerr << "Error parsing config file " << filename << " (" << e.what() << "). Rolling back to defaults." << std::endl;
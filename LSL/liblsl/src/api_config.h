@@ -113,6 +113,13 @@ namespace lsl {
 		*/
 		int multicast_ttl() const { return multicast_ttl_; } 
 
+		/**
+		* The (IPv4) multicast group to which outlets send the data feed for inlets that request multicast data transport.
+		* The datagrams are sent to the port of the outlet's TCP data server and tagged with a random stream ID,
+		* so a single group can be shared by all outlets.
+		*/
+		const std::string &multicast_data_address() const { return multicast_data_address_; }
+
 		/**
 		* The configured session ID. 
 		* Allows to keep recording operations isolated from each other (precluding unwanted interference).
@@ -165,10 +172,64 @@ namespace lsl {
 		int inlet_buffer_reserve_ms() const { return inlet_buffer_reserve_ms_; }
 		/// Default pre-allocated buffer size for the inlet, in samples (irregular streams).
 		int inlet_buffer_reserve_samples() const { return inlet_buffer_reserve_samples_; }
+		/// Upper bound of the pre-allocated buffer size for the outlet, in bytes (limits the reservation for streams with large samples, e.g., video).
+		int outlet_buffer_reserve_bytes() const { return outlet_buffer_reserve_bytes_; }
+		/// Upper bound of the pre-allocated buffer size for the inlet, in bytes (limits the reservation for streams with large samples, e.g., video).
+		int inlet_buffer_reserve_bytes() const { return inlet_buffer_reserve_bytes_; }
 		/// Default halftime of the time-stamp smoothing window (if enabled), in seconds.
 		float smoothing_halftime() const { return smoothing_halftime_; }
 		/// Override timestamps with lsl clock if True
 		bool force_default_timestamps() const { return force_default_timestamps_; }
+		/// Time that a blocking pull spins on an empty sample queue before going to sleep, in seconds (0 = sleep right away).
+		double consumer_spin_time() const { return consumer_spin_time_; }
+		/**
+		* Compression codec that an inlet requests for the data feed ("none" or "delta-bitpack").
+		* The codec is only used if the outlet supports it; otherwise the data is transmitted uncompressed.
+		*/
+		const std::string &compression() const { return compression_; }
+		/// Whether inlets receive the data of outlets on the same host through shared memory (if supported), instead of a loopback TCP connection.
+		bool shared_memory() const { return shared_memory_; }
+		/// Whether inlets attach directly to the send buffer of an outlet in the same process, instead of connecting to it over TCP.
+		bool in_process() const { return in_process_; }
+		/// Whether inlets ask outlets to send them the data feed by UDP multicast (shared by all such inlets on the network), rather than a separate TCP stream each.
+		bool multicast_data() const { return multicast_data_; }
+		/**
+		* Whether inlets ask outlets to send them the data feed as unacknowledged datagrams (lossy, but without the retransmission
+		* and head-of-line delays of TCP; meant for closed-loop control). Lost samples are counted by the inlet.
+		*/
+		bool datagram_data() const { return datagram_data_; }
+		/// The number of consecutive datagrams in which each chunk of a datagram feed is sent (1 = no redundancy).
+		int datagram_redundancy() const { return datagram_redundancy_; }
+		/**
+		* Whether outlets share a per-process multiplexing server, and inlets receive the data of all streams of a remote process
+		* over a single (shared) connection to it, instead of one connection per inlet.
+		*/
+		bool multiplex() const { return multiplex_; }
+		/// The size of the buffer from which an inlet decodes the data feed of a TCP connection, in bytes (larger reads bypass it).
+		int receive_buffer_size() const { return receive_buffer_size_; }
+		/**
+		* Whether inlets run their background activities (data, time, info and watchdog) on a process-wide pool of threads
+		* (one per core; see inlet_reactor), instead of a few threads of their own per inlet.
+		*/
+		bool inlet_reactor() const { return inlet_reactor_; }
+
+		/**
+		* The number of threads of the process-wide pool on which outlets serve their connections (see outlet_io_pool).
+		* If 0, each outlet runs two IO threads of its own per IP stack.
+		*/
+		int outlet_io_threads() const { return outlet_io_threads_; }
+
+		/**
+		* Whether the inlets that read from streams of the same host share one estimate of that host's clock (see host_clock),
+		* instead of each inlet probing the clock of its stream on its own.
+		*/
+		bool share_host_clocks() const { return share_host_clocks_; }
+
+		/// Whether inlets use the binary time probes (see time_probe.h) with streams that understand them, instead of the text probes.
+		bool binary_time_probes() const { return binary_time_probes_; }
+
+		/// Whether the time probes are stamped with the receive times of the kernel (where supported), instead of when they are processed.
+		bool kernel_timestamps() const { return kernel_timestamps_; }
 
 	private:
 		// Thread-safe initialization logic (boilerplate).
@@ -197,6 +258,7 @@ namespace lsl {
 		std::string resolve_scope_;
 		std::vector<std::string> multicast_addresses_;
 		int multicast_ttl_;
+		std::string multicast_data_address_;
 		std::string listen_address_;
 		std::vector<std::string> known_peers_;
 		std::string session_id_;
@@ -220,8 +282,24 @@ namespace lsl {
 		int outlet_buffer_reserve_samples_;
 		int inlet_buffer_reserve_ms_;
 		int inlet_buffer_reserve_samples_;
+		int outlet_buffer_reserve_bytes_;
+		int inlet_buffer_reserve_bytes_;
 		float smoothing_halftime_;
 		bool force_default_timestamps_;
+		double consumer_spin_time_;
+		std::string compression_;
+		bool shared_memory_;
+		bool in_process_;
+		bool multicast_data_;
+		bool datagram_data_;
+		int datagram_redundancy_;
+		bool multiplex_;
+		int receive_buffer_size_;
+		bool inlet_reactor_;
+		int outlet_io_threads_;
+		bool share_host_clocks_;
+		bool binary_time_probes_;
+		bool kernel_timestamps_;
 	};
 }
 
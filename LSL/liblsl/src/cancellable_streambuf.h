@@ -23,6 +23,7 @@
 #include <streambuf>
 #include <exception>
 #include <set>
+#include <vector>
 #include <boost/asio/detail/config.hpp>
 #include <boost/utility/base_from_member.hpp>
 #include <boost/asio/basic_socket.hpp>
@@ -47,7 +48,8 @@ namespace boost {
 			typedef typename Protocol::endpoint endpoint_type;
 
 			/// Construct a cancellable_streambuf without establishing a connection.
-			cancellable_streambuf(): basic_socket<Protocol, StreamSocketService>(boost::base_from_member<boost::asio::io_service>::member), cancel_issued_(false), cancel_started_(false) {
+			/// The get buffer holds up to the given number of bytes that have been received ahead (larger reads bypass it; added for lsl).
+			cancellable_streambuf(std::size_t get_buffer_size=buffer_size): basic_socket<Protocol, StreamSocketService>(boost::base_from_member<boost::asio::io_service>::member), get_buffer_(std::max<std::size_t>(get_buffer_size,putback_max+1)), cancel_issued_(false), cancel_started_(false) {
 				init_buffers();
 			}
 
@@ -141,14 +143,16 @@ namespace boost {
 				if (gptr() == egptr()) {
 					io_handler handler = { this };
 					this->get_service().async_receive(this->get_implementation(),
-						boost::asio::buffer(boost::asio::buffer(get_buffer_) + putback_max),
+						boost::asio::buffer(&get_buffer_[0] + putback_max, get_buffer_.size() - putback_max),
 						0, handler);
 
 					ec_ = boost::asio::error::would_block;
+					bytes_transferred_ = 0; // line added for lsl
 					protected_reset(); // line changed for lsl
 					do this->get_service().get_io_service().run_one();
 					while (ec_ == boost::asio::error::would_block);
-					if (ec_)
+					// (a cancellation may end the wait without an error and without data; line changed for lsl)
+					if (ec_ || !bytes_transferred_)
 						return traits_type::eof();
 
 					setg(&get_buffer_[0], &get_buffer_[0] + putback_max,
@@ -159,6 +163,33 @@ namespace boost {
 					return traits_type::eof();
 			}
 
+			/// Read a block of data; large reads are received straight into the destination (rather than through the get buffer). Added for lsl.
+			std::streamsize xsgetn(char_type *s, std::streamsize n) {
+				// take what is buffered first
+				std::streamsize done = std::min<std::streamsize>(n,egptr()-gptr());
+				memcpy(s,gptr(),(std::size_t)done);
+				gbump((int)done);
+				while (n-done >= (std::streamsize)get_buffer_.size()) {
+					io_handler handler = { this };
+					this->get_service().async_receive(this->get_implementation(),
+						boost::asio::buffer(s+done,(std::size_t)(n-done)),
+						0, handler);
+
+					ec_ = boost::asio::error::would_block;
+					bytes_transferred_ = 0;
+					protected_reset();
+					do this->get_service().get_io_service().run_one();
+					while (ec_ == boost::asio::error::would_block);
+					if (ec_ || !bytes_transferred_)
+						return done;
+					done += bytes_transferred_;
+				}
+				// the rest goes through the get buffer
+				if (done < n)
+					done += std::streambuf::xsgetn(s+done,n-done);
+				return done;
+			}
+
 			int_type overflow(int_type c) {
 				// Send all data in the output buffer.
 				boost::asio::const_buffer buffer =
@@ -221,7 +252,7 @@ namespace boost {
 
 			enum { putback_max = 8 };
 			enum { buffer_size = 512 };
-			boost::asio::detail::array<char, buffer_size> get_buffer_;
+			std::vector<char> get_buffer_; // changed for lsl (configurable size)
 			boost::asio::detail::array<char, buffer_size> put_buffer_;
 			boost::system::error_code ec_;
 			std::size_t bytes_transferred_;
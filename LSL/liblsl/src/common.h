@@ -20,7 +20,8 @@
 // the highest supported protocol version
 // * 100 is the original version, supported by library versions 1.00+
 // * 110 is an alternative protocol that improves throughput, supported by library versions 1.10+
-const int LSL_PROTOCOL_VERSION = 110;
+// * 120 transmits numeric samples in chunks with a single header each, supported by library versions newer than 1.12 (negotiated; peers fall back to 110)
+const int LSL_PROTOCOL_VERSION = 120;
 
 // the library version
 const int LSL_LIBRARY_VERSION = 112;
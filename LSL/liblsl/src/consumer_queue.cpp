@@ -1,20 +1,38 @@
 #include "consumer_queue.h"
 #include "send_buffer.h"
+#include "api_config.h"
 #include "../include/lsl_c.h"
 #include <iostream>
 #include <boost/thread.hpp>
+#include <boost/bind.hpp>
 
 
 // === implementation of the consumer_queue class ===
 
 using namespace lsl;
 
+namespace {
+	/// Restores the wakeup threshold of a consumer queue to a single sample once a batch pop returns.
+	struct threshold_reset {
+		boost::atomic<std::size_t> &threshold;
+		~threshold_reset() { threshold.store(1,boost::memory_order_relaxed); }
+	};
+}
+
 /**
 * Create a new queue with a given capacity.
-* @param max_capacity The maximum number of samples that can be held by the queue. Beyond that, the oldest samples are dropped.
+* @param max_capacity The maximum number of samples that can be held by the queue (counting all samples of a chunk). 
+*					  Beyond that, the oldest samples are dropped.
 * @param registry Optionally a pointer to a registration facility, to dispatch samples to all consumers.
 */
-consumer_queue::consumer_queue(std::size_t max_capacity, send_buffer_p registry): registry_(registry), buffer_(max_capacity)  {
+consumer_queue::consumer_queue(std::size_t max_capacity, send_buffer_p registry): registry_(registry), capacity_(std::max(max_capacity,(std::size_t)1)), slots_(new slot[capacity_]), 
+	write_idx_(0), read_idx_(0), queued_(0), dropped_(0), spin_time_(api_config::get_instance()->consumer_spin_time()), wakeup_threshold_(1), waiters_(0)  {
+	for (std::size_t k=0;k<capacity_;k++) {
+		slots_[k].seq.store(k,boost::memory_order_relaxed);
+		slots_[k].value = NULL;
+		slots_[k].length = 0;
+		slots_[k].timestamp = 0.0;
+	}
 	if (registry_)
 		registry_->register_consumer(this);
 }
@@ -30,41 +48,257 @@ consumer_queue::~consumer_queue() {
 	} catch(std::exception &e) {
 		std::cerr << "Unexpected error while trying to unregister a consumer queue from its registry:" << e.what() << std::endl;
 	}
+	// release any samples that are still held by the ring
+	sample_p dummy;
+	while (try_pop(dummy))
+		dummy.reset();
 }
 
 /**
 * Push a new sample onto the queue.
+* If a consumer is blocked waiting for data it will be woken up.
+* @param sample The sample, or the first sample of a chunk that is queued as a single entry.
+* @param num_samples The number of samples of the entry (the length of the chunk).
+* @param timestamp The time stamp of the sample as resolved by the producer, for a sample that is shared with others and
+*				   therefore still carries DEDUCED_TIMESTAMP (by default the sample's own time stamp is queued).
+*/
+void consumer_queue::push_sample(const sample_p &sample, std::size_t num_samples, double timestamp) {
+	// the ring holds one reference to the sample
+	if (sample)
+		intrusive_ptr_add_ref(sample.get());
+	std::size_t pos = write_idx_.load(boost::memory_order_relaxed);
+	slot &s = slots_[pos % capacity_];
+	while (s.seq.load(boost::memory_order_acquire) != pos) {
+		// the slot still holds the sample at position pos-capacity_ (i.e., the ring is full): try to claim it like a consumer would
+		std::size_t oldest = pos - capacity_;
+		if (read_idx_.compare_exchange_weak(oldest, oldest+1, boost::memory_order_relaxed)) {
+			// we own the oldest slot now: drop its sample and hand the slot back to ourselves
+			lsl::sample *victim = s.value;
+			std::size_t victim_length = s.length;
+			s.seq.store(pos, boost::memory_order_release);
+			queued_.fetch_sub(victim_length,boost::memory_order_relaxed);
+			if (victim)
+				intrusive_ptr_release(victim);
+			dropped_.fetch_add(victim_length,boost::memory_order_relaxed);
+		}
+		// otherwise a consumer has just claimed that slot and will release it momentarily
+	}
+	s.value = sample.get();
+	s.length = num_samples;
+	s.timestamp = (timestamp == DEDUCED_TIMESTAMP && sample) ? sample->timestamp : timestamp;
+	queued_.fetch_add(num_samples,boost::memory_order_relaxed);
+	s.seq.store(pos+1, boost::memory_order_release);
+	write_idx_.store(pos+1, boost::memory_order_relaxed);
+	// drop the oldest entries (but never the one just pushed) while more samples are queued than the capacity allows
+	std::size_t oldest = read_idx_.load(boost::memory_order_relaxed);
+	while (oldest < pos && queued_.load(boost::memory_order_relaxed) > capacity_) {
+		// claim the oldest entry like a consumer would (we have published it ourselves, so its slot is ready)
+		if (read_idx_.compare_exchange_weak(oldest, oldest+1, boost::memory_order_relaxed)) {
+			slot &o = slots_[oldest % capacity_];
+			lsl::sample *victim = o.value;
+			std::size_t victim_length = o.length;
+			o.seq.store(oldest+capacity_, boost::memory_order_release);
+			queued_.fetch_sub(victim_length,boost::memory_order_relaxed);
+			if (victim)
+				intrusive_ptr_release(victim);
+			dropped_.fetch_add(victim_length,boost::memory_order_relaxed);
+			oldest++;
+		}
+		// otherwise oldest has been updated by the failed CAS (a consumer may have taken the entry)
+	}
+	// make sure that the sample is published before we check for waiters (pairs with the fence in pop_sample)
+	boost::atomic_thread_fence(boost::memory_order_seq_cst);
+	if (waiters_.load(boost::memory_order_relaxed) && (!sample || size() >= wakeup_threshold_.load(boost::memory_order_relaxed)))
+		notify_waiters();
+}
+
+/**
+* Try to pop a sample from the queue without blocking.
+* @return Whether a sample was popped.
 */
-void consumer_queue::push_sample(const sample_p &sample) {
-	while (!buffer_.push(sample)) {
-		sample_p dummy;
-		buffer_.pop(dummy);
+bool consumer_queue::try_pop(sample_p &result) {
+	std::size_t num_samples;
+	double timestamp;
+	return pop_entry(result,num_samples,timestamp);
+}
+
+/// Try to pop an entry from the queue without blocking; also yields the number of samples and the time stamp of the entry.
+bool consumer_queue::pop_entry(sample_p &result, std::size_t &num_samples, double &timestamp) {
+	std::size_t pos = read_idx_.load(boost::memory_order_relaxed);
+	for (;;) {
+		slot &s = slots_[pos % capacity_];
+		std::size_t seq = s.seq.load(boost::memory_order_acquire);
+		std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos+1);
+		if (diff == 0) {
+			// the slot holds the sample for our position: try to claim it
+			if (read_idx_.compare_exchange_weak(pos, pos+1, boost::memory_order_relaxed)) {
+				// take over the reference held by the ring and free the slot for the next lap of the producer
+				result = sample_p(s.value,false);
+				num_samples = s.length;
+				timestamp = s.timestamp;
+				s.seq.store(pos+capacity_, boost::memory_order_release);
+				queued_.fetch_sub(num_samples,boost::memory_order_relaxed);
+				return true;
+			}
+			// pos has been updated by the failed CAS
+		} else if (diff < 0) {
+			// the slot has not been written yet: the queue is empty
+			return false;
+		} else {
+			// we have been overtaken (e.g., by the producer dropping the oldest sample)
+			pos = read_idx_.load(boost::memory_order_relaxed);
+		}
+	}
+}
+
+/// Wake up any consumers that are blocked in pop_sample() or waiting for a notification.
+void consumer_queue::notify_waiters() {
+	boost::function<void()> callback;
+	{
+		// taking the lock ensures that a consumer is either before its predicate check or already waiting
+		boost::lock_guard<boost::mutex> lock(wakeup_mut_);
+		wakeup_cond_.notify_all();
+		if (notify_) {
+			callback.swap(notify_);
+			waiters_.fetch_sub(1,boost::memory_order_relaxed);
+		}
 	}
+	// invoke the notification outside the lock
+	if (callback)
+		callback();
+}
+
+/**
+* Arm a one-shot callback that is invoked as soon as the next sample is pushed.
+* @return True if the callback has been armed, or false if the queue was not empty.
+*/
+bool consumer_queue::arm_notify(const boost::function<void()> &callback) {
+	boost::lock_guard<boost::mutex> lock(wakeup_mut_);
+	if (notify_)
+		throw std::logic_error("A notification is already armed on this consumer queue.");
+	notify_ = callback;
+	waiters_.fetch_add(1,boost::memory_order_relaxed);
+	// announce ourselves before checking the buffer (pairs with the fence in push_sample)
+	boost::atomic_thread_fence(boost::memory_order_seq_cst);
+	if (!empty()) {
+		notify_.clear();
+		waiters_.fetch_sub(1,boost::memory_order_relaxed);
+		return false;
+	}
+	return true;
 }
 
 /**
 * Pop a sample from the queue.
 * Blocks if empty.
 * @param timeout Timeout for the blocking, in seconds. If expired, an empty sample is returned.
+* @param timestamp Optionally receives the queued time stamp of the sample (see push_sample()).
 */
-sample_p consumer_queue::pop_sample(double timeout) {
+sample_p consumer_queue::pop_sample(double timeout, double *timestamp) {
 	sample_p result;
-	if (timeout <= 0.0) {
-		buffer_.pop(result);
-	} else {
-		if (!buffer_.pop(result)) {
-			// turn timeout into the point in time at which we give up
-			timeout += lsl_local_clock(); 
-			do {
-				if (lsl_local_clock() >= timeout)
-					break;
-				boost::this_thread::sleep(boost::posix_time::milliseconds(1));
-			} while (!buffer_.pop(result));
-		}
+	std::size_t num_samples;
+	double ignored;
+	double &stamp = timestamp ? *timestamp : ignored;
+	if (pop_entry(result,num_samples,stamp) || timeout <= 0.0)
+		return result;
+	// turn timeout into the point in time at which we give up
+	double start_time = lsl_local_clock();
+	// optionally busy-wait for a bounded amount of time (trades CPU for wakeup latency)
+	if (spin_time_ > 0.0) {
+		double spin_until = start_time + std::min(spin_time_,timeout);
+		do {
+			if (pop_entry(result,num_samples,stamp))
+				return result;
+		} while (lsl_local_clock() < spin_until);
+		if (spin_time_ >= timeout)
+			return result;
 	}
+	// go to sleep until a producer wakes us up
+	boost::unique_lock<boost::mutex> lock(wakeup_mut_);
+	waiters_.fetch_add(1,boost::memory_order_relaxed);
+	// announce ourselves before checking the buffer (pairs with the fence in push_sample)
+	boost::atomic_thread_fence(boost::memory_order_seq_cst);
+	if (timeout >= FOREVER)
+		wakeup_cond_.wait(lock, boost::bind(&consumer_queue::pop_entry,this,boost::ref(result),boost::ref(num_samples),boost::ref(stamp)));
+	else
+		wakeup_cond_.wait_for(lock, boost::chrono::duration<double>(timeout - (lsl_local_clock()-start_time)), boost::bind(&consumer_queue::pop_entry,this,boost::ref(result),boost::ref(num_samples),boost::ref(stamp)));
+	waiters_.fetch_sub(1,boost::memory_order_relaxed);
 	return result;
 }
 
+/**
+* Pop up to a given number of samples from the queue in one pass.
+* Blocks until at least min_samples samples have been popped or the timeout has expired.
+* @param results An array of at least max_samples sample pointers that receives the samples.
+* @param max_samples The maximum number of samples to pop.
+* @param min_samples The number of samples to wait for (clamped to max_samples; 0 = don't wait).
+* @param timeout Timeout for the blocking, in seconds.
+* @param timestamps Optionally an array of at least max_samples values that receives the queued time stamps of the samples.
+* @return The number of samples that were popped into results.
+*/
+std::size_t consumer_queue::pop_samples(sample_p *results, std::size_t max_samples, std::size_t min_samples, double timeout, double *timestamps) {
+	std::size_t count = 0;
+	min_samples = std::min(min_samples,max_samples);
+	// drain_samples() may raise the threshold; pop_sample() relies on it being back at 1 whichever way we return
+	threshold_reset reset = {wakeup_threshold_};
+	if (drain_samples(results,timestamps,max_samples,min_samples,count) || timeout <= 0.0)
+		return count;
+	double start_time = lsl_local_clock();
+	// optionally busy-wait for a bounded amount of time (trades CPU for wakeup latency)
+	if (spin_time_ > 0.0) {
+		double spin_until = start_time + std::min(spin_time_,timeout);
+		do {
+			if (drain_samples(results,timestamps,max_samples,min_samples,count))
+				return count;
+		} while (lsl_local_clock() < spin_until);
+		if (spin_time_ >= timeout)
+			return count;
+	}
+	// go to sleep until a producer wakes us up
+	boost::unique_lock<boost::mutex> lock(wakeup_mut_);
+	waiters_.fetch_add(1,boost::memory_order_relaxed);
+	// announce ourselves before checking the buffer (pairs with the fence in push_sample)
+	boost::atomic_thread_fence(boost::memory_order_seq_cst);
+	if (timeout >= FOREVER)
+		wakeup_cond_.wait(lock, boost::bind(&consumer_queue::drain_samples,this,results,timestamps,max_samples,min_samples,boost::ref(count)));
+	else
+		wakeup_cond_.wait_for(lock, boost::chrono::duration<double>(timeout - (lsl_local_clock()-start_time)), boost::bind(&consumer_queue::drain_samples,this,results,timestamps,max_samples,min_samples,boost::ref(count)));
+	waiters_.fetch_sub(1,boost::memory_order_relaxed);
+	return count;
+}
+
+/// Pop the available samples into a results array; returns whether pop_samples() can return.
+bool consumer_queue::drain_samples(sample_p *results, double *timestamps, std::size_t max_samples, std::size_t min_samples, std::size_t &count) {
+	sample_p samp;
+	std::size_t num_samples;
+	double stamp;
+	for (;;) {
+		while (count < max_samples && pop_entry(samp,num_samples,stamp)) {
+			// a blank sample signals the end of the stream
+			if (!samp)
+				return true;
+			if (timestamps)
+				timestamps[count] = stamp;
+			results[count++].swap(samp);
+		}
+		if (count >= min_samples)
+			return true;
+		// tell the producer how many more samples we need before we want to be woken up
+		// (but never more than what the queue can hold)
+		std::size_t missing = std::min(min_samples - count, capacity_);
+		wakeup_threshold_.store(missing,boost::memory_order_relaxed);
+		// make sure that this is visible before we check the fill level (pairs with the fence in push_sample)
+		boost::atomic_thread_fence(boost::memory_order_seq_cst);
+		if (size() < missing)
+			return false;
+	}
+}
+
 bool consumer_queue::empty() {
-	return buffer_.empty();
+	std::size_t pos = read_idx_.load(boost::memory_order_relaxed);
+	return slots_[pos % capacity_].seq.load(boost::memory_order_acquire) != pos+1;
+}
+
+std::size_t consumer_queue::size() const {
+	return queued_.load(boost::memory_order_relaxed);
 }
@@ -1,8 +1,10 @@
 #ifndef CONSUMER_QUEUE_H
 #define CONSUMER_QUEUE_H
 
-#include <boost/lockfree/spsc_queue.hpp>
 #include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/function.hpp>
 #include "sample.h"
 
 namespace lsl {
@@ -13,14 +15,29 @@ namespace lsl {
 
 	/**
 	* A thread-safe producer-consumer queue of unread samples.
-	* Erases the oldest samples if max capacity is exceeded. Implemented as a circular buffer.
+	* Erases the oldest samples if max capacity is exceeded. Implemented as a bounded ring of sequence-numbered slots
+	* (in the style of D. Vyukov's bounded queue): the producer never blocks, and when the ring is full it claims the 
+	* oldest slot through the same compare-and-swap on the read position that the consumer uses, so that dropping a sample 
+	* can never race with a concurrent pop.
+	* An entry of the queue may be a whole chunk of samples (see sample::next_in_chunk()); the capacity bounds the number of 
+	* queued samples, so the producer also drops the oldest entries while the queue holds more samples than that (except
+	* for the newest entry, which is always kept).
+	* A blocking pop_sample() sleeps on a condition variable until a sample is pushed; the producer
+	* only takes the associated lock if a consumer has announced itself as waiting.
 	*/
 	class consumer_queue: private boost::noncopyable {
-		typedef boost::lockfree::spsc_queue<sample_p> buffer_type;
+		/// A slot in the ring; the sequence number tells whether the slot is free for a given write position or holds the sample for a given read position.
+		struct slot {
+			boost::atomic<std::size_t> seq;		// sequence number of the slot
+			sample *value;						// the sample held by the slot (we hold one reference while it is stored)
+			std::size_t length;					// the number of samples of the entry (more than one if it is a chunk)
+			double timestamp;					// the time stamp of the (first) sample as resolved by the producer
+		};
 	public:
 		/**
 		* Create a new queue with a given capacity.
-		* @param max_capacity The maximum number of samples that can be held by the queue. Beyond that, the oldest samples are dropped.
+		* @param max_capacity The maximum number of samples that can be held by the queue (counting all samples of a chunk). 
+		*					  Beyond that, the oldest samples are dropped.
 		* @param registry Optionally a pointer to a registration facility, for multiple-reader arrangements.
 		*/
 		consumer_queue(std::size_t max_capacity, send_buffer_p registry=send_buffer_p());
@@ -33,24 +50,97 @@ namespace lsl {
 
 		/**
 		* Push a new sample onto the queue.
+		* @param sample The sample, or the first sample of a chunk that is queued as a single entry.
+		* @param num_samples The number of samples of the entry (the length of the chunk).
+		* @param timestamp The time stamp of the sample as resolved by the producer, for a sample that is shared with others and
+		*				   therefore still carries DEDUCED_TIMESTAMP (by default the sample's own time stamp is queued).
 		*/
-		void push_sample(const sample_p &sample);
+		void push_sample(const sample_p &sample, std::size_t num_samples=1, double timestamp=DEDUCED_TIMESTAMP);
 
 		/**
 		* Pop a sample from the queue. 
-		* Blocks if empty.
+		* Blocks if empty (optionally spinning for a short while before going to sleep, see api_config::consumer_spin_time()).
 		* @param timeout Timeout for the blocking, in seconds. If expired, an empty sample is returned.
+		* @param timestamp Optionally receives the queued time stamp of the sample (see push_sample()).
 		*/
-		sample_p pop_sample(double timeout=FOREVER);
+		sample_p pop_sample(double timeout=FOREVER, double *timestamp=NULL);
+
+		/**
+		* Pop up to a given number of samples from the queue in one pass.
+		* Blocks until at least min_samples samples have been popped or the timeout has expired; while waiting, the 
+		* consumer is only woken up once enough samples have accumulated in the queue (rather than once per sample).
+		* A blank sample in the queue (as pushed on end of stream) ends the wait early; it is consumed but not returned.
+		* @param results An array of at least max_samples sample pointers that receives the samples.
+		* @param max_samples The maximum number of samples to pop.
+		* @param min_samples The number of samples to wait for (clamped to max_samples; 0 = don't wait).
+		* @param timeout Timeout for the blocking, in seconds.
+		* @param timestamps Optionally an array of at least max_samples values that receives the queued time stamps of the samples.
+		* @return The number of samples that were popped into results.
+		*/
+		std::size_t pop_samples(sample_p *results, std::size_t max_samples, std::size_t min_samples, double timeout=FOREVER, double *timestamps=NULL);
+
+		/**
+		* Try to pop a sample from the queue without blocking.
+		* @param result Receives the sample (which may be a blank sample if one was pushed).
+		* @return Whether a sample was popped.
+		*/
+		bool try_pop(sample_p &result);
+
+		/**
+		* Arm a one-shot callback that is invoked as soon as the next sample is pushed.
+		* This is for consumers that do not want to block a thread in pop_sample() (e.g., asynchronous writers).
+		* The callback is invoked by the pushing thread and should therefore only dispatch the actual work elsewhere.
+		* @param callback The function to invoke.
+		* @return True if the callback has been armed, or false if the queue was not empty (in which case the
+		*		  callback is not invoked and the caller should read the queue instead).
+		*/
+		bool arm_notify(const boost::function<void()> &callback);
 
 		/**
 		* Check whether the buffer is empty.
 		*/ 
 		bool empty();
 
+		/**
+		* Get the (approximate) number of samples in the queue (counting all samples of a chunk).
+		*/
+		std::size_t size() const;
+
+		/**
+		* Get the number of samples that were dropped so far because the queue was full.
+		*/
+		uint64_t dropped() const { return dropped_.load(boost::memory_order_relaxed); }
+
 	private:
+		/// Wake up any consumers that are blocked in pop_sample() or waiting for a notification.
+		void notify_waiters();
+
+		/// Try to pop an entry from the queue without blocking; also yields the number of samples and the time stamp of the entry.
+		bool pop_entry(sample_p &result, std::size_t &num_samples, double &timestamp);
+
+		/**
+		* Pop the available samples into a results array (used as the predicate of the wakeup condition in pop_samples()).
+		* If not enough samples were available, the wakeup threshold of the producer is set to the number of missing samples.
+		* @return Whether pop_samples() can return (either enough samples were popped or a blank sample was encountered).
+		*/
+		bool drain_samples(sample_p *results, double *timestamps, std::size_t max_samples, std::size_t min_samples, std::size_t &count);
+
 		send_buffer_p registry_;				// optional consumer registry
-		buffer_type buffer_;					// the sample buffer
+		std::size_t capacity_;					// number of slots in the ring
+		boost::scoped_array<slot> slots_;		// the ring of sample slots
+		char pad0_[64];							// keeps the producer and consumer positions on separate cache lines
+		boost::atomic<std::size_t> write_idx_;	// next position to write (only modified by the producer)
+		char pad1_[64];
+		boost::atomic<std::size_t> read_idx_;	// next position to read (claimed by consumers and by the producer when dropping)
+		char pad2_[64];
+		boost::atomic<std::size_t> queued_;		// number of queued samples (counted before an entry is published and after it has been claimed)
+		boost::atomic<uint64_t> dropped_;		// number of samples dropped due to overflow
+		double spin_time_;						// time to spin before a blocking pop goes to sleep (in seconds)
+		boost::atomic<std::size_t> wakeup_threshold_;	// number of queued samples at which the producer wakes up blocked consumers
+		boost::atomic<int> waiters_;			// number of consumers that are (about to be) blocked in pop_sample(), plus 1 if a notification is armed
+		boost::mutex wakeup_mut_;				// mutex protecting the wakeup condition
+		boost::condition_variable wakeup_cond_;	// condition variable signaling that a sample has been pushed
+		boost::function<void()> notify_;		// one-shot callback to invoke when the next sample is pushed (protected by wakeup_mut_)
 	};
 
 }
@@ -6,6 +6,11 @@
 #include <boost/algorithm/string.hpp>
 #include "data_receiver.h"
 #include "socket_utils.h"
+#include "delta_bitpack_codec.h"
+#include "shm_ring.h"
+#include "multicast_feed.h"
+#include "datagram_feed.h"
+#include "mux_client.h"
 #include "portable_archive/portable_iarchive.hpp"
 
 
@@ -14,6 +19,159 @@
 using namespace lsl;
 using namespace boost::algorithm;
 
+namespace {
+	/// Interval at which the data thread re-checks its state while it is attached to an outlet in the same process, in seconds.
+	const double in_process_check_interval = 0.5;
+
+	/// Time that the data thread waits for the first datagram of a datagram feed before it concludes that the datagrams do not get through, in seconds.
+	const double datagram_handshake_timeout = 2.0;
+
+	/// The maximum number of buffered samples that the data thread decodes at a time (protocol 1.10).
+	const std::size_t max_decode_batch = 256;
+
+	/// Maximum time that the data thread waits for a multiplexed connection to the outlet's host to be established, in seconds.
+	const double mux_connect_timeout = 2.0;
+	/// Wakes up the data thread while it is attached to an outlet in the same process (when the stream is closed or the inlet is disengaged).
+	class in_process_wakeup: public cancellable_obj {
+	public:
+		~in_process_wakeup() { unregister_from_all(); }
+		virtual void cancel() { outlet_registry::wake_all(); }
+	};
+
+	/// Keeps a sample queue attached to the send buffer of an outlet in the same process for the lifetime of this object.
+	class direct_attachment {
+	public:
+		direct_attachment(const send_buffer_p &buffer, consumer_queue *queue): buffer_(buffer), queue_(queue) { buffer_->attach_direct(queue_); }
+		~direct_attachment() { buffer_->detach_direct(queue_); }
+	private:
+		send_buffer_p buffer_;
+		consumer_queue *queue_;
+	};
+
+	/// Receives the samples of a stream over a multiplexed connection and pushes them into the sample queue of the inlet.
+	class mux_channel: public mux_client::channel, public cancellable_obj {
+	public:
+		mux_channel(inlet_connection &conn, sample::factory &factory, consumer_queue &queue, const boost::function<void()> &on_change=boost::function<void()>()): conn_(conn), factory_(factory), queue_(queue),
+			suppress_subnormals_(!format_subnormal[conn.type_info().channel_format()]), srate_(conn.current_srate()), last_timestamp_(0.0), k_(0), subscribed_(false), ended_(false), cancelled_(false), on_change_(on_change) { }
+		~mux_channel() { unregister_from_all(); }
+
+		/// Wait until the subscription has been accepted; returns false if the stream ended first or the wait was cancelled.
+		bool wait_subscribed() {
+			boost::unique_lock<boost::mutex> lock(mut_);
+			while (!subscribed_ && !ended_ && !cancelled_)
+				upd_.wait(lock);
+			return subscribed_ && !ended_ && !cancelled_;
+		}
+
+		/// Wait until the stream has ended or the wait was cancelled; returns whether the stream has ended.
+		bool wait_ended() {
+			boost::unique_lock<boost::mutex> lock(mut_);
+			while (!ended_ && !cancelled_)
+				upd_.wait(lock);
+			return ended_;
+		}
+
+		/// Whether the subscription has been accepted.
+		bool is_subscribed() { boost::lock_guard<boost::mutex> lock(mut_); return subscribed_; }
+		/// Whether the stream has ended.
+		bool has_ended() { boost::lock_guard<boost::mutex> lock(mut_); return ended_; }
+		/// Whether the channel has been cancelled.
+		bool was_cancelled() { boost::lock_guard<boost::mutex> lock(mut_); return cancelled_; }
+
+		virtual void subscribed() {
+			{
+				boost::lock_guard<boost::mutex> lock(mut_);
+				subscribed_ = true;
+				upd_.notify_all();
+			}
+			if (on_change_)
+				on_change_();
+		}
+
+		virtual void receive_chunk(const char *data, std::size_t size, int byte_order) {
+			try {
+				memory_source source = {data,size};
+				block_.clear();
+				sample::load_chunk_streambuf(source,factory_,byte_order,suppress_subnormals_,scratchpad_,block_);
+				for (std::vector<sample_p>::iterator samp=block_.begin(); samp!=block_.end(); samp++,k_++) {
+					// deduce timestamp if necessary
+					if ((*samp)->timestamp == DEDUCED_TIMESTAMP) {
+						(*samp)->timestamp = last_timestamp_;
+						if (srate_ != IRREGULAR_RATE)
+							(*samp)->timestamp += 1.0/srate_;
+					}
+					last_timestamp_ = (*samp)->timestamp;
+					queue_.push_sample(*samp);
+					// periodically update the last receive time to keep the watchdog happy
+					if (srate_<=16 || (k_ & 0xF) == 0)
+						conn_.update_receive_time(lsl_clock());
+				}
+			} catch(std::exception &e) {
+				std::cerr << "Received a malformed chunk over a multiplexed connection (" << e.what() << "); re-connecting..." << std::endl;
+				ended();
+			}
+		}
+
+		virtual void ended() {
+			{
+				boost::lock_guard<boost::mutex> lock(mut_);
+				ended_ = true;
+				upd_.notify_all();
+			}
+			if (on_change_)
+				on_change_();
+		}
+
+		virtual void cancel() {
+			{
+				boost::lock_guard<boost::mutex> lock(mut_);
+				cancelled_ = true;
+				upd_.notify_all();
+			}
+			if (on_change_)
+				on_change_();
+		}
+
+	private:
+		inlet_connection &conn_;
+		sample::factory &factory_;
+		consumer_queue &queue_;
+		bool suppress_subnormals_;
+		double srate_;
+		double last_timestamp_;
+		int k_;
+		std::vector<sample_p> block_;
+		std::vector<char> scratchpad_;
+		bool subscribed_;
+		bool ended_;
+		bool cancelled_;
+		boost::mutex mut_;
+		boost::condition_variable upd_;
+		boost::function<void()> on_change_;
+	};
+
+	/// Keeps a channel subscribed to a stream for the lifetime of this object.
+	class mux_subscription {
+	public:
+		mux_subscription(const mux_client_p &client, const std::string &uid, int max_buffered, int max_chunklen, mux_channel *chan): client_(client), id_(client->subscribe(uid,max_buffered,max_chunklen,chan)) { }
+		~mux_subscription() { client_->unsubscribe(id_); }
+	private:
+		mux_client_p client_;
+		boost::uint32_t id_;
+	};
+}
+
+/// A subscription of the reception on the inlet reactor: a channel that notifies the data receiver of its state changes, and its subscription.
+struct data_receiver::reactive_feed {
+	reactive_feed(data_receiver &receiver, const mux_client_p &client): channel(receiver.conn_,*receiver.sample_factory_,receiver.sample_queue_,boost::bind(&data_receiver::notify_multiplexed,&receiver)) {
+		channel.register_at(&receiver.conn_);
+		channel.register_at(&receiver);
+		subscription.reset(new mux_subscription(client,receiver.conn_.current_uid(),receiver.max_buflen_,receiver.max_chunklen_,&channel));
+	}
+	mux_channel channel;
+	boost::scoped_ptr<mux_subscription> subscription;
+};
+
 /**
 * Construct a new data receiver from an info connection.
 * @param conn An inlet connection object.
@@ -22,20 +180,30 @@ using namespace boost::algorithm;
 * @param max_chunklen Optionally the maximum size, in samples, at which chunks are transmitted (the default corresponds to the chunk sizes used by the sender).
 *					  Recording applications can use a generous size here (leaving it to the network how to pack things), while real-time applications may want a finer (perhaps 1-sample) granularity.
 */
-data_receiver::data_receiver(inlet_connection &conn, int max_buflen, int max_chunklen): conn_(conn), check_thread_start_(true), closing_stream_(false), connected_(false), sample_queue_(max_buflen), 
-	sample_factory_(new sample::factory(conn.type_info().channel_format(),conn.type_info().channel_count(),conn.type_info().nominal_srate()?conn.type_info().nominal_srate()*api_config::get_instance()->inlet_buffer_reserve_ms()/1000:api_config::get_instance()->inlet_buffer_reserve_samples())), max_buflen_(max_buflen), max_chunklen_(max_chunklen) 
+data_receiver::data_receiver(inlet_connection &conn, int max_buflen, int max_chunklen): conn_(conn), 
+	sample_factory_(new sample::factory(conn.type_info().channel_format(),conn.type_info().channel_count(),conn.type_info().nominal_srate()?conn.type_info().nominal_srate()*api_config::get_instance()->inlet_buffer_reserve_ms()/1000:api_config::get_instance()->inlet_buffer_reserve_samples(),api_config::get_instance()->inlet_buffer_reserve_bytes())), 
+	check_thread_start_(true), closing_stream_(false), connected_(false), sample_queue_(max_buflen), samples_dropped_(0), datagram_redundancy_(api_config::get_instance()->datagram_data() ? api_config::get_instance()->datagram_redundancy() : 0),
+	max_buflen_(max_buflen), max_chunklen_(max_chunklen), reactive_(false), watchdog_held_(false), stopped_(false)
 {
 	if (max_buflen < 0)
 		throw std::invalid_argument("The max_buflen argument must not be smaller than 0.");
 	if (max_chunklen < 0)
 		throw std::invalid_argument("The max_chunklen argument must not be smaller than 0.");
 	conn_.register_onlost(this,&connected_upd_);
+	if (conn_.reactor()) {
+		strand_.reset(new reactor_strand(conn_.reactor()->io()));
+	}
 }
 
 /// Destructor. Stops the background activities.
 data_receiver::~data_receiver() {
 	try {
 		conn_.unregister_onlost(this);
+		if (strand_) {
+			strand_->close(boost::bind(&data_receiver::stop_operations,this));
+			if (watchdog_held_)
+				conn_.release_watchdog();
+		}
 		if (data_thread_.joinable())
 			data_thread_.join();
 	}
@@ -63,10 +231,8 @@ void data_receiver::open_stream(double timeout) {
 	boost::unique_lock<boost::mutex> lock(connected_mut_);
 	if (!connection_completed()) {
 		// start thread if not yet running
-		if (check_thread_start_ && !data_thread_.joinable()) {
-			data_thread_ = boost::thread(&data_receiver::data_thread,this);
-			check_thread_start_ = false;
-		}
+		if (check_thread_start_)
+			start_receiving();
 		// wait until the connection attempt completes (or we time out)
 		if (timeout >= FOREVER)
 			connected_upd_.wait(lock, boost::bind(&data_receiver::connection_completed,this));
@@ -90,6 +256,20 @@ void data_receiver::close_stream() {
 	cancel_all_registered();
 }
 
+/**
+* Request the data feed as unacknowledged datagrams (overrides tuning.DatagramData and tuning.DatagramRedundancy for this inlet).
+* @param redundancy The number of times that each chunk is sent (in consecutive datagrams), or 0 to receive the data over TCP.
+* @throws std::invalid_argument if the redundancy is negative, or std::logic_error if the stream has already been opened.
+*/
+void data_receiver::set_datagram_data(int redundancy) {
+	if (redundancy < 0)
+		throw std::invalid_argument("The datagram redundancy must not be smaller than 0.");
+	// (the feed is negotiated once the reception has been started)
+	if (reactive_ || data_thread_.joinable())
+		throw std::logic_error("The datagram feed must be requested before the stream is opened.");
+	datagram_redundancy_ = redundancy;
+}
+
 /**
 * Pull a sample from the inlet and read it into a pointer to raw data.
 * No type checking or conversions are done (not recommended!). Do not use for variable-size/string-formatted streams.
@@ -104,16 +284,15 @@ double data_receiver::pull_sample_untyped(void *buffer, int buffer_bytes, double
 	if (conn_.lost())
 		throw lost_error("The stream read by this inlet has been lost. To recover, you need to re-resolve the source and re-create the inlet.");
 	// start data thread implicitly if necessary
-	if (check_thread_start_ && !data_thread_.joinable()) {
-		data_thread_ = boost::thread(&data_receiver::data_thread,this);
-		check_thread_start_ = false;
-	}
+	if (check_thread_start_)
+		start_receiving();
 	// get the sample with timeout
-	if (sample_p s = sample_queue_.pop_sample(timeout)) {
+	double timestamp;
+	if (sample_p s = sample_queue_.pop_sample(timeout,&timestamp)) {
 		if (buffer_bytes != conn_.type_info().sample_bytes())
 			throw std::range_error("The size of the provided buffer does not match the number of bytes in the sample.");
 		s->retrieve_untyped(buffer);
-		return s->timestamp;
+		return timestamp;
 	} else {
 		if (conn_.lost())
 			throw lost_error("The stream read by this inlet has been lost. To recover, you need to re-resolve the source and re-create the inlet.");
@@ -124,18 +303,56 @@ double data_receiver::pull_sample_untyped(void *buffer, int buffer_bytes, double
 
 // === internal processing ===
 
+/// Start receiving the data (in the data thread, or on the inlet reactor) unless it is being received already.
+void data_receiver::start_receiving() {
+	if (reactive_ || data_thread_.joinable())
+		return;
+	if (strand_ && api_config::get_instance()->multiplex() && mux_client::supports(conn_.type_info().channel_format(),conn_.type_info().sample_bytes())) {
+		// (the data thread takes over if the multiplexed connection is not usable)
+		reactive_ = true;
+		watchdog_held_ = true;
+		conn_.acquire_watchdog();
+		strand_->post(boost::bind(&data_receiver::attach_multiplexed,this));
+	} else
+		data_thread_ = boost::thread(&data_receiver::data_thread,this);
+	check_thread_start_ = false;
+}
+
 /// The data reader thread.
 void data_receiver::data_thread() {
 	conn_.acquire_watchdog();
 	// ensure that the sample factory persists for the lifetime of this thread
 	sample::factory_p factory(sample_factory_);
+	// whether we ask outlets on the same host for a shared-memory transfer (given up for this inlet if attaching fails)
+	bool try_shared_memory = api_config::get_instance()->shared_memory() && shm_ring::supported();
+	// whether we ask outlets for the multicast data feed (given up for this inlet if joining the group fails)
+	bool try_multicast = api_config::get_instance()->multicast_data();
+	// whether we ask outlets for an unacknowledged datagram feed (given up for this inlet if no datagrams get through)
+	bool try_datagram = datagram_redundancy_ > 0;
+	// whether we receive through a connection that is shared with the other inlets for the outlet's process (given up for this inlet if it cannot be established)
+	bool try_multiplex = api_config::get_instance()->multiplex() && mux_client::supports(conn_.type_info().channel_format(),conn_.type_info().sample_bytes());
 	try {
 		while (!conn_.lost() && !conn_.shutdown() && !closing_stream_) {
 			try {
+				// --- in-process attachment (if the outlet lives in this process) ---
+				outlet_registry::entry outlet;
+				if (api_config::get_instance()->in_process() && outlet_registry::find(conn_.current_uid(),outlet)) {
+					receive_in_process(outlet);
+					continue;
+				}
+
+				// --- multiplexed connection (if the outlet's process offers one) ---
+				if (try_multiplex) {
+					tcp::endpoint mux_endpoint = conn_.get_mux_endpoint();
+					if (mux_endpoint.port() && receive_multiplexed(mux_endpoint))
+						continue;
+					try_multiplex = false;
+				}
+
 				// --- connection setup ---
 
 				// make a new stream buffer and a stream on top of it
-				boost::asio::cancellable_streambuf<tcp> buffer;
+				boost::asio::cancellable_streambuf<tcp> buffer(api_config::get_instance()->receive_buffer_size());
 				buffer.register_at(&conn_);
 				buffer.register_at(this);
 				std::iostream server_stream(&buffer);
@@ -150,6 +367,11 @@ void data_receiver::data_thread() {
 				int use_byte_order = 0;				// which byte order we shall use (0=portable byte order)
 				int data_protocol_version = 100;	// which protocol version we shall use for data transmission (100=version 1.00)
 				bool suppress_subnormals = false;	// whether we shall suppress subnormal numbers
+				boost::scoped_ptr<delta_bitpack_codec> codec;	// the codec for compressed data blocks, if negotiated
+				shm_ring_p ring;					// the shared-memory ring through which we receive the data, if negotiated
+				boost::scoped_ptr<multicast_feed_receiver> mcast;	// the multicast feed through which we receive the data, if negotiated
+				boost::scoped_ptr<datagram_feed_receiver> dgram;	// the datagram feed through which we receive the data, if negotiated
+				bool dgram_granted = false;			// whether the outlet agreed to send us the datagram feed
 
 				// propose to use the highest protocol version supported by both parties
 				int proposed_protocol_version = std::min(api_config::get_instance()->use_protocol_version(),conn_.type_info().version());
@@ -168,6 +390,23 @@ void data_receiver::data_thread() {
 					server_stream << "Hostname: " << conn_.type_info().hostname() << "\r\n";
 					server_stream << "Source-Id: " << conn_.type_info().source_id() << "\r\n";
 					server_stream << "Session-Id: " << conn_.type_info().session_id() << "\r\n";
+					if (api_config::get_instance()->compression() != "none")
+						server_stream << "Compression: " << api_config::get_instance()->compression() << "\r\n";
+					if (try_shared_memory && conn_.type_info().hostname() == boost::asio::ip::host_name())
+						server_stream << "Shared-Memory: 1\r\n";
+					if (try_multicast)
+						server_stream << "Multicast-Data: 1\r\n";
+					if (try_datagram) {
+						// [Port] [Redundancy]
+						try {
+							dgram.reset(new datagram_feed_receiver(conn_.get_tcp_endpoint().address()));
+							server_stream << "Datagram-Data: " << dgram->port() << " " << datagram_redundancy_ << "\r\n";
+						} catch(std::exception &e) {
+							std::cerr << "Could not open a socket for the datagram feed (" << e.what() << "); using TCP instead." << std::endl;
+							try_datagram = false;
+							dgram.reset();
+						}
+					}
 					server_stream << "\r\n" << std::flush;
 
 					// check server response line (LSL/[Version] [StatusCode] [Message])
@@ -213,10 +452,60 @@ void data_receiver::data_thread() {
 								if (data_protocol_version > api_config::get_instance()->use_protocol_version())
 									throw std::runtime_error("The protocol version requested by the other party is not supported by this client.");
 							}
+							if (type == "compression" && rest != "none") {
+								if (rest != delta_bitpack_codec::name() || !delta_bitpack_codec::supports(conn_.type_info().channel_format()))
+									throw std::runtime_error("The compression requested by the other party is not supported by this client.");
+								codec.reset(new delta_bitpack_codec(conn_.type_info().channel_format(),conn_.type_info().channel_count()));
+							}
+							if (type == "shared-memory") {
+								try {
+									ring = shm_ring::open(rest);
+								} catch(std::exception &e) {
+									// e.g., the outlet runs under another account or in another container
+									std::cerr << "Could not attach to the shared memory of the outlet (" << e.what() << "); falling back to TCP." << std::endl;
+									try_shared_memory = false;
+									throw lost_error("Could not attach to the shared memory of the outlet.");
+								}
+								ring->register_at(&conn_);
+								ring->register_at(this);
+							}
+							if (type == "multicast-data") {
+								// [GroupAddress] [Port] [StreamID]
+								std::vector<std::string> feed; split(feed,rest,is_any_of(" \t"),token_compress_on);
+								try {
+									if (feed.size() < 3)
+										throw std::runtime_error("malformed announcement");
+									mcast.reset(new multicast_feed_receiver(feed[0],boost::lexical_cast<int>(feed[1]),boost::lexical_cast<boost::uint32_t>(feed[2]),server_stream));
+								} catch(std::exception &e) {
+									// e.g., multicast is not routed to this host
+									std::cerr << "Could not join the multicast data feed of the outlet (" << e.what() << "); falling back to TCP." << std::endl;
+									try_multicast = false;
+									throw lost_error("Could not join the multicast data feed of the outlet.");
+								}
+								mcast->register_at(&conn_);
+								mcast->register_at(this);
+							}
+							if (type == "datagram-data" && dgram) {
+								// [FeedID]
+								dgram->set_feed(boost::lexical_cast<boost::uint32_t>(rest),use_byte_order);
+								dgram_granted = true;
+							}
 						}
 					}
 					if (!server_stream)
 						throw lost_error("Server connection lost.");
+					if (dgram && !dgram_granted)
+						dgram.reset();
+					if (dgram) {
+						dgram->register_at(&conn_);
+						dgram->register_at(this);
+						// make sure that the datagrams get through to us (e.g., they might be blocked by a firewall)
+						if (!dgram->wait_for_handshake(datagram_handshake_timeout)) {
+							std::cerr << "The datagram feed of the outlet does not get through; falling back to TCP." << std::endl;
+							try_datagram = false;
+							throw lost_error("The datagram feed of the outlet does not get through.");
+						}
+					}
 				} else {
 					// version 1.00: send request line and feed parameters
 					server_stream << "LSL:streamfeed\r\n";
@@ -257,22 +546,51 @@ void data_receiver::data_thread() {
 
                 double last_timestamp = 0.0;
                 double srate = conn_.current_srate();
-                for (int k=0;!conn_.lost() && !conn_.shutdown() && !closing_stream_;k++) {
-                    // allocate and fetch a new sample						
-                    sample_p samp(factory->new_sample(0.0,false));
-					if (data_protocol_version >= 110) samp->load_streambuf(buffer,data_protocol_version,use_byte_order,suppress_subnormals); else *inarch >> *samp;
-                    // deduce timestamp if necessary
-                    if (samp->timestamp == DEDUCED_TIMESTAMP) {
-                        samp->timestamp = last_timestamp;
-                        if (srate != IRREGULAR_RATE)
-                            samp->timestamp += 1.0/srate;
-                    }
-                    last_timestamp = samp->timestamp;
-                    // push it into the sample queue
-                    sample_queue_.push_sample(samp);
-                    // periodically update the last receive time to keep the watchdog happy
-					if (srate<=16 || (k & 0xF) == 0)
-						conn_.update_receive_time(lsl_clock());
+				std::vector<sample_p> block;
+				std::vector<char> scratchpad;
+				// the largest possible size of a (numeric) sample in protocol 1.10
+				std::streamsize max_sample_bytes = (conn_.type_info().channel_format() != cf_string) ? 1+sizeof(double)+conn_.type_info().sample_bytes() : 0;
+                for (int k=0;!conn_.lost() && !conn_.shutdown() && !closing_stream_;) {
+					// fetch the next block of samples (a chunk from shared memory, a datagram or multicast, a compressed block, a chunk, or else a single sample)
+					block.clear();
+					if (ring)
+						sample::load_chunk_streambuf(*ring,*factory,use_byte_order,suppress_subnormals,scratchpad,block);
+					else if (dgram) {
+						sample::load_chunk_streambuf(*dgram,*factory,use_byte_order,suppress_subnormals,scratchpad,block);
+						samples_dropped_ += dgram->take_dropped();
+					} else if (mcast)
+						sample::load_chunk_streambuf(*mcast,*factory,use_byte_order,suppress_subnormals,scratchpad,block);
+					else if (codec)
+						codec->read_block(buffer,*factory,suppress_subnormals,block);
+					else if (data_protocol_version >= 120)
+						sample::load_chunk_streambuf(buffer,*factory,use_byte_order,suppress_subnormals,scratchpad,block);
+					else {
+						sample_p samp(factory->new_sample(0.0,false));
+						if (data_protocol_version >= 110) samp->load_streambuf(buffer,data_protocol_version,use_byte_order,suppress_subnormals); else *inarch >> *samp;
+						block.push_back(samp);
+						// decode the further samples that have already been received in one go (as long as they are surely complete)
+						if (data_protocol_version >= 110 && max_sample_bytes) {
+							while (block.size() < max_decode_batch && buffer.in_avail() >= max_sample_bytes) {
+								samp = factory->new_sample(0.0,false);
+								samp->load_streambuf(buffer,data_protocol_version,use_byte_order,suppress_subnormals);
+								block.push_back(samp);
+							}
+						}
+					}
+					for (std::vector<sample_p>::iterator samp=block.begin(); samp!=block.end(); samp++,k++) {
+						// deduce timestamp if necessary
+						if ((*samp)->timestamp == DEDUCED_TIMESTAMP) {
+							(*samp)->timestamp = last_timestamp;
+							if (srate != IRREGULAR_RATE)
+								(*samp)->timestamp += 1.0/srate;
+						}
+						last_timestamp = (*samp)->timestamp;
+						// push it into the sample queue
+						sample_queue_.push_sample(*samp);
+						// periodically update the last receive time to keep the watchdog happy
+						if (srate<=16 || (k & 0xF) == 0)
+							conn_.update_receive_time(lsl_clock());
+					}
                 }
 			}
 			catch(error_code &) {
@@ -305,3 +623,190 @@ void data_receiver::data_thread() {
 	conn_.release_watchdog();
 }
 
+/**
+* Receive the samples of an outlet in the same process by attaching the sample queue directly to its send buffer (until the outlet goes away or the stream is closed).
+* The samples are shared by reference with the outlet (and its other consumers), so they are neither copied nor modified here;
+* their deduced time stamps are resolved by the send buffer and queued alongside them.
+* @throws lost_error if the outlet has been destroyed.
+*/
+void data_receiver::receive_in_process(const outlet_registry::entry &outlet) {
+	// the samples in our queue were allocated by the outlet's factory
+	if (outlet_factories_.empty() || outlet_factories_.back() != outlet.factory)
+		outlet_factories_.push_back(outlet.factory);
+	in_process_wakeup wakeup;
+	wakeup.register_at(&conn_);
+	wakeup.register_at(this);
+	direct_attachment attachment(outlet.buffer,&sample_queue_);
+	{
+		boost::lock_guard<boost::mutex> lock(connected_mut_);
+		connected_ = true;
+	}
+	connected_upd_.notify_all();
+	// wait until the outlet goes away, keeping the watchdog happy in the meantime
+	while (!conn_.lost() && !conn_.shutdown() && !closing_stream_) {
+		if (outlet_registry::wait_for_removal(conn_.current_uid(),in_process_check_interval))
+			throw lost_error("The outlet has been destroyed.");
+		conn_.update_receive_time(lsl_clock());
+	}
+}
+
+/**
+* Receive the samples of the outlet through the multiplexed connection to its process (until the stream ends or is closed).
+* The connection is shared with all other inlets of this process that read from the same process.
+* @return false if the multiplexed connection is not usable (the caller then connects to the outlet directly).
+* @throws lost_error if the stream has ended or the connection has been lost.
+*/
+bool data_receiver::receive_multiplexed(const tcp::endpoint &endpoint) {
+	mux_client_p client;
+	try {
+		client = mux_client::connect(endpoint,mux_connect_timeout);
+	} catch(std::exception &e) {
+		std::cerr << "Could not use the multiplexed connection to the outlet's host (" << e.what() << "); using a connection of our own." << std::endl;
+		return false;
+	}
+	if (client->byte_order()==2134 && BOOST_BYTE_ORDER!=2134 && format_sizes[conn_.type_info().channel_format()]>=8) {
+		std::cerr << "The byte order of the outlet's host is not supported over a multiplexed connection; using a connection of our own." << std::endl;
+		return false;
+	}
+	mux_channel channel(conn_,*sample_factory_,sample_queue_);
+	channel.register_at(&conn_);
+	channel.register_at(this);
+	if (conn_.shutdown() || closing_stream_)
+		return true;
+	mux_subscription subscription(client,conn_.current_uid(),max_buflen_,max_chunklen_,&channel);
+	if (!channel.wait_subscribed()) {
+		if (conn_.shutdown() || closing_stream_)
+			return true;
+		throw lost_error("The outlet did not accept the subscription (likely outdated).");
+	}
+	{
+		boost::lock_guard<boost::mutex> lock(connected_mut_);
+		connected_ = true;
+	}
+	connected_upd_.notify_all();
+	if (channel.wait_ended())
+		throw lost_error("The stream has ended.");
+	return true;
+}
+
+
+// === the reception on the inlet reactor ===
+
+/// Subscribe to the stream over the multiplexed connection to the outlet's process; falls back to the data thread if that is not possible.
+void data_receiver::attach_multiplexed() {
+	if (stopped_)
+		return;
+	if (conn_.lost() || conn_.shutdown() || closing_stream_) {
+		end_reactive();
+		return;
+	}
+	// outlets in the same process and outlets without a multiplexing server are served by the data thread
+	outlet_registry::entry outlet;
+	tcp::endpoint endpoint = conn_.get_mux_endpoint();
+	if ((api_config::get_instance()->in_process() && outlet_registry::find(conn_.current_uid(),outlet)) || !endpoint.port()) {
+		fall_back_to_thread();
+		return;
+	}
+	// (we continue in subscribe_multiplexed() once the connection has been established, without holding up the reactor meanwhile)
+	try {
+		mux_connecting_ = mux_client::connect_async(endpoint,mux_connect_timeout);
+	} catch(std::exception &e) {
+		std::cerr << "Could not use the multiplexed connection to the outlet's host (" << e.what() << "); receiving in a thread of our own." << std::endl;
+		fall_back_to_thread();
+		return;
+	}
+	if (!mux_connecting_->arm_connected(strand_->wrap(boost::bind(&data_receiver::subscribe_multiplexed,this))))
+		subscribe_multiplexed();
+}
+
+/// Subscribe to the stream once the connection to the outlet's process has been established; falls back to the data thread if that failed.
+void data_receiver::subscribe_multiplexed() {
+	mux_client_p client;
+	client.swap(mux_connecting_);
+	if (stopped_ || !client)
+		return;
+	if (conn_.lost() || conn_.shutdown() || closing_stream_) {
+		end_reactive();
+		return;
+	}
+	if (!client->is_connected()) {
+		std::cerr << "Could not establish the multiplexed connection to the outlet's host; receiving in a thread of our own." << std::endl;
+		fall_back_to_thread();
+		return;
+	}
+	if (client->byte_order()==2134 && BOOST_BYTE_ORDER!=2134 && format_sizes[conn_.type_info().channel_format()]>=8) {
+		fall_back_to_thread();
+		return;
+	}
+	try {
+		feed_.reset(new reactive_feed(*this,client));
+	} catch(shutdown_error &) {
+		end_reactive();
+		return;
+	}
+	// (the subscription may have changed its state before we got here)
+	update_multiplexed();
+}
+
+/// Callback of the subscription when its state has changed (called from other threads); schedules update_multiplexed().
+void data_receiver::notify_multiplexed() {
+	strand_->post(boost::bind(&data_receiver::update_multiplexed,this));
+}
+
+/// Handle a change of the state of the subscription.
+void data_receiver::update_multiplexed() {
+	if (stopped_ || !feed_)
+		return;
+	bool cancelled = feed_->channel.was_cancelled(), ended = feed_->channel.has_ended();
+	if (!cancelled && !ended) {
+		if (feed_->channel.is_subscribed() && !connected_) {
+			{
+				boost::lock_guard<boost::mutex> lock(connected_mut_);
+				connected_ = true;
+			}
+			connected_upd_.notify_all();
+		}
+		return;
+	}
+	feed_.reset();
+	if (conn_.lost() || conn_.shutdown() || closing_stream_) {
+		end_reactive();
+		return;
+	}
+	// a cancellation (e.g., after a recovery) is followed by an immediate re-subscription
+	if (cancelled) {
+		attach_multiplexed();
+		return;
+	}
+	// the stream has ended: re-subscribe once it has been recovered
+	if (!conn_.recover_from_error_async(boost::bind(&data_receiver::reattach_after_recovery,this)))
+		end_reactive();
+}
+
+/// Callback of the recovery attempt after the stream has ended (called from its thread); schedules the next subscription attempt.
+void data_receiver::reattach_after_recovery() {
+	strand_->post(boost::bind(&data_receiver::attach_multiplexed,this));
+}
+
+/// Hand the reception over to the data thread.
+void data_receiver::fall_back_to_thread() {
+	end_reactive();
+	data_thread_ = boost::thread(&data_receiver::data_thread,this);
+}
+
+/// End the reception (and release the watchdog); wakes up pull calls if the stream has been lost.
+void data_receiver::end_reactive() {
+	if (conn_.lost())
+		sample_queue_.push_sample(sample_p());
+	if (watchdog_held_) {
+		watchdog_held_ = false;
+		conn_.release_watchdog();
+	}
+}
+
+/// Stop the reception (runs on the inlet reactor when the data_receiver is destroyed).
+void data_receiver::stop_operations() {
+	stopped_ = true;
+	feed_.reset();
+	mux_connecting_.reset();
+}
@@ -2,9 +2,12 @@
 #define DATA_RECEIVER_H
 
 #include <boost/thread.hpp>
+#include <boost/scoped_ptr.hpp>
 #include "consumer_queue.h"
 #include "inlet_connection.h"
 #include "cancellable_streambuf.h"
+#include "outlet_registry.h"
+#include "mux_client.h"
 
 
 
@@ -16,6 +19,8 @@ namespace lsl {
 	/// The actual communication runs in an internal background thread, while the public functions (pull_sample_typed/untyped, open_stream, close_stream) wait for the thread to finish.
 	/// The public functions have an optional timeout after which they give up, while the background thread continues to do its job (so the next public-function call may succeed within the timeout).
 	/// The background thread terminates only if the data_receiver is destroyed or the underlying connection is lost or shut down.
+	/// If the inlet runs on the inlet reactor and the outlet's process offers a multiplexed connection, the samples are received
+	/// over that connection by handlers on the reactor instead (other transports still use the background thread).
 	class data_receiver: public cancellable_registry {
 	public:
 		/**
@@ -54,16 +59,15 @@ namespace lsl {
 			if (conn_.lost())
 				throw lost_error("The stream read by this outlet has been lost. To recover, you need to re-resolve the source and re-create the inlet.");
 			// start data thread implicitly if necessary
-			if (check_thread_start_ && !data_thread_.joinable()) {
-				data_thread_ = boost::thread(&data_receiver::data_thread,this);
-				check_thread_start_ = false;
-			}
+			if (check_thread_start_)
+				start_receiving();
 			// get the sample with timeout
-			if (sample_p s = sample_queue_.pop_sample(timeout)) {
+			double timestamp;
+			if (sample_p s = sample_queue_.pop_sample(timeout,&timestamp)) {
 				if (buffer_elements != conn_.type_info().channel_count())
 					throw std::range_error("The number of buffer elements provided does not match the number of channels in the sample.");
 				s->retrieve_typed(buffer);
-				return s->timestamp;
+				return timestamp;
 			} else {
 				if (conn_.lost())
 					throw lost_error("The stream read by this inlet has been lost. To recover, you need to re-resolve the source and re-create the inlet.");
@@ -71,16 +75,102 @@ namespace lsl {
 			}
 		}
 
+		/**
+		* Retrieve a chunk of samples from the sample queue and assign their contents to the given typed buffers.
+		* @param data_buffer The buffer that receives the multiplexed channel data (room for max_samples samples).
+		* @param timestamp_buffer The buffer that receives the time stamps (room for max_samples values).
+		* @param max_samples The maximum number of samples to retrieve.
+		* @param min_samples The number of samples to wait for (unless the timeout expires first).
+		* @param timeout The timeout for the operation.
+		* @return The number of samples retrieved.
+		*/
+		template<class T> std::size_t pull_chunk_typed(T *data_buffer, double *timestamp_buffer, std::size_t max_samples, std::size_t min_samples, double timeout=FOREVER) {
+			if (conn_.lost())
+				throw lost_error("The stream read by this outlet has been lost. To recover, you need to re-resolve the source and re-create the inlet.");
+			// start data thread implicitly if necessary
+			if (check_thread_start_)
+				start_receiving();
+			// get the samples in batches and copy them straight into the caller's buffers
+			std::size_t num_chans = conn_.type_info().channel_count(), samples_written = 0;
+			double end_time = (timeout > 0.0 && timeout < FOREVER) ? lsl_clock()+timeout : 0.0;
+			sample_p batch[chunk_batch_size];
+			while (samples_written < max_samples) {
+				std::size_t batch_max = std::min(max_samples-samples_written,(std::size_t)chunk_batch_size);
+				std::size_t batch_min = (samples_written < min_samples) ? std::min(min_samples-samples_written,batch_max) : 0;
+				double batch_timeout = batch_min ? (end_time ? end_time-lsl_clock() : timeout) : 0.0;
+				std::size_t n = sample_queue_.pop_samples(batch,batch_max,batch_min,batch_timeout,&timestamp_buffer[samples_written]);
+				for (std::size_t k=0; k<n; k++,samples_written++) {
+					batch[k]->retrieve_typed(&data_buffer[samples_written*num_chans]);
+					batch[k].reset();
+				}
+				if (n < batch_max)
+					break;
+			}
+			if (!samples_written && conn_.lost())
+				throw lost_error("The stream read by this inlet has been lost. To recover, you need to re-resolve the source and re-create the inlet.");
+			return samples_written;
+		}
+
 		/// Read sample from the inlet and read it into a pointer to raw data.
 		double pull_sample_untyped(void *buffer, int buffer_bytes, double timeout=FOREVER);
 
 		/// Check whether the underlying buffer is empty. This value may be inaccurate.
 		bool empty() { return sample_queue_.empty(); };
 
+		/// Get the number of samples in the underlying buffer. This value may be inaccurate.
+		std::size_t size() { return sample_queue_.size(); };
+
+		/// Get the number of samples that were dropped (lost in transmission with a datagram feed, or discarded because the buffer overflowed).
+		std::size_t samples_dropped() { return samples_dropped_ + (std::size_t)sample_queue_.dropped(); }
+
+		/**
+		* Request the data feed as unacknowledged datagrams (overrides tuning.DatagramData and tuning.DatagramRedundancy for this inlet).
+		* @param redundancy The number of times that each chunk is sent (in consecutive datagrams), or 0 to receive the data over TCP.
+		* @throws std::invalid_argument if the redundancy is negative, or std::logic_error if the stream has already been opened.
+		*/
+		void set_datagram_data(int redundancy);
+
 	private:
+		struct reactive_feed;
+
+		/// Start receiving the data (in the data thread, or on the inlet reactor) unless it is being received already.
+		void start_receiving();
+
 		/// The data reader thread.
 		void data_thread();
 
+		/// Receive the samples of an outlet in the same process by attaching the sample queue directly to its send buffer (until the outlet goes away or the stream is closed).
+		void receive_in_process(const outlet_registry::entry &outlet);
+
+		/// Receive the samples of the outlet through the multiplexed connection to its process (until the stream ends or is closed); returns false if that connection is not usable.
+		bool receive_multiplexed(const tcp::endpoint &endpoint);
+
+		// === the reception on the inlet reactor ===
+
+		/// Subscribe to the stream over the multiplexed connection to the outlet's process; falls back to the data thread if that is not possible.
+		void attach_multiplexed();
+
+		/// Subscribe to the stream once the connection to the outlet's process has been established; falls back to the data thread if that failed.
+		void subscribe_multiplexed();
+
+		/// Callback of the subscription when its state has changed (called from other threads); schedules update_multiplexed().
+		void notify_multiplexed();
+
+		/// Handle a change of the state of the subscription.
+		void update_multiplexed();
+
+		/// Callback of the recovery attempt after the stream has ended (called from its thread); schedules the next subscription attempt.
+		void reattach_after_recovery();
+
+		/// Hand the reception over to the data thread.
+		void fall_back_to_thread();
+
+		/// End the reception (and release the watchdog); wakes up pull calls if the stream has been lost.
+		void end_reactive();
+
+		/// Stop the reception (runs on the inlet reactor when the data_receiver is destroyed).
+		void stop_operations();
+
 		/// Function that is polled by the condition variable
 		bool connection_completed() { return connected_ || conn_.lost(); }
 
@@ -93,13 +183,27 @@ namespace lsl {
 		bool check_thread_start_;					// whether we need to check whether the thread has been started
 		bool closing_stream_;						// indicates to the data thread that it a close has been requested
 		bool connected_;							// whether the stream has been connected / opened
+		std::vector<sample::factory_p> outlet_factories_;	// factories of the outlets in the same process whose samples we may hold (must outlive the sample queue)
 		consumer_queue sample_queue_;				// queue of samples ready to be picked up (populated by the data thread)
 		boost::mutex connected_mut_;				// mutex to protect the connected state
 		boost::condition_variable connected_upd_;	// condition variable to indicate that an update for the connected state is available
+		boost::atomic<std::size_t> samples_dropped_;	// the number of samples that were lost in transmission
+		int datagram_redundancy_;					// the redundancy of the datagram feed that we ask for (0 = receive over TCP)
+
+		// number of samples that pull_chunk_typed() pops from the sample queue at a time
+		enum { chunk_batch_size = 64 };
 
 		// internal data used by the reader thread
 		int max_buflen_;							// the maximum number of samples to be buffered for this inlet
 		int max_chunklen_;							// the desired maximum chunklen for received samples
+
+		// the reception on the inlet reactor
+		boost::scoped_ptr<reactor_strand> strand_;	// runs the handlers of the reception one at a time (if on the reactor)
+		boost::scoped_ptr<reactive_feed> feed_;		// the current subscription (strand only)
+		mux_client_p mux_connecting_;				// the multiplexed connection while it is being established (strand only)
+		bool reactive_;								// whether the reception has been started on the reactor
+		bool watchdog_held_;						// whether the reception on the reactor holds the watchdog (strand only once started)
+		bool stopped_;								// whether the reception on the reactor has been stopped (strand only)
 	};
 
 }
@@ -0,0 +1,238 @@
+#include "datagram_feed.h"
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+
+
+// === implementation of the datagram_feed_sender and datagram_feed_receiver classes ===
+
+using namespace lsl;
+using namespace boost::asio;
+using boost::asio::ip::udp;
+
+namespace {
+	/// The size of the datagram header (feed ID and chunk count).
+	const std::size_t header_bytes = 8;
+
+	/// The size of the header of a chunk record (sample index and chunk size).
+	const std::size_t record_header_bytes = 12;
+
+	/// The size of the header of a chunk without further explicit time stamps.
+	const std::size_t chunk_header_bytes = 16;
+
+	/// The preferred maximum size of a datagram (small enough to not be fragmented on common networks).
+	const std::size_t max_datagram_bytes = 1200;
+
+	/// The largest datagram that we ever send (samples that do not fit into a preferred-size datagram get one of their own).
+	const std::size_t max_datagram_limit = 65000;
+
+	/// The chunk count that announces the end of the feed.
+	const boost::uint32_t end_of_feed = 0xFFFFFFFF;
+
+	/// The number of handshake datagrams that are sent when the feed starts (any of them will do).
+	const int handshake_count = 3;
+
+	/// The receive buffer size that the receiver asks for (the operating system may grant less).
+	const int receive_buffer_bytes = 4*1024*1024;
+
+	/// Maximum time that the receiver waits for a datagram before re-checking its state, in seconds.
+	const double max_wait = 0.1;
+}
+
+
+// === sender ===
+
+/**
+* Create a sender for a client.
+* @param io The IO service of the session (the sender must only be used from its thread).
+* @param target The address and port to which the datagrams are sent.
+* @param redundancy The number of datagrams in which each chunk is sent (at least 1).
+* @param use_byte_order The byte order of the feed.
+* @param srate The nominal sampling rate of the stream (to resolve deduced time stamps).
+* @throws std::exception if the socket could not be set up.
+*/
+datagram_feed_sender::datagram_feed_sender(io_service &io, const udp::endpoint &target, int redundancy, int use_byte_order, double srate): socket_(io), target_(target),
+	redundancy_(std::max(redundancy,1)), use_byte_order_(use_byte_order), srate_(srate), next_index_(0), last_timestamp_(0.0)
+{
+	boost::uuids::uuid tag = boost::uuids::random_generator()();
+	memcpy(&id_,tag.data,sizeof(id_));
+	socket_.open(target.protocol());
+	for (int k=0; k<handshake_count; k++)
+		send_datagram(0,records_.size());
+}
+
+/// Destructor. Announces the end of the feed.
+datagram_feed_sender::~datagram_feed_sender() {
+	send_datagram(end_of_feed,records_.size());
+}
+
+/// Whether a sample of the given size can be sent at all (i.e., fits into the largest possible datagram).
+bool datagram_feed_sender::supports(std::size_t sample_bytes) {
+	return header_bytes + record_header_bytes + chunk_header_bytes + sample_bytes <= max_datagram_limit;
+}
+
+/// Send a block of samples (split into as many chunks as needed to fit the datagrams).
+void datagram_feed_sender::send(const sample_p *samples, std::size_t num_samples) {
+	// the chunks are kept small enough that a datagram can hold as many of them as the redundancy asks for
+	std::size_t max_record_bytes = (max_datagram_bytes - header_bytes) / redundancy_;
+	std::size_t sample_bytes = sample::chunk_bytes(samples,1) - chunk_header_bytes, begin = 0, bytes = chunk_header_bytes;
+	for (std::size_t k=0; k<num_samples; k++) {
+		std::size_t added = sample_bytes + ((k > begin && samples[k]->timestamp != DEDUCED_TIMESTAMP) ? sizeof(boost::uint32_t)+sizeof(double) : 0);
+		if (k > begin && record_header_bytes + bytes + added > max_record_bytes) {
+			send_chunk(&samples[begin],k-begin);
+			begin = k;
+			bytes = chunk_header_bytes;
+			added = sample_bytes;
+		}
+		bytes += added;
+	}
+	if (begin < num_samples)
+		send_chunk(&samples[begin],num_samples-begin);
+}
+
+/// Send a chunk of samples (along with the most recent previous ones).
+void datagram_feed_sender::send_chunk(const sample_p *samples, std::size_t num_samples) {
+	// make a record for the chunk (recycling the oldest one)
+	std::vector<char> record;
+	if (records_.size() >= redundancy_) {
+		record.swap(records_.front());
+		records_.pop_front();
+	}
+	record.clear();
+	vector_sink sink = {record};
+	sample::save_value(sink,next_index_,use_byte_order_);
+	sample::save_value(sink,(boost::uint32_t)sample::chunk_bytes(samples,num_samples),use_byte_order_);
+	std::size_t chunk_begin = record.size();
+	sample::save_chunk_streambuf(sink,samples,num_samples,use_byte_order_,coded_);
+	// resolve the deduced time stamps as the receiver would; the first one is written into the chunk, since the receiver may have missed its predecessors
+	for (std::size_t k=0; k<num_samples; k++) {
+		if (samples[k]->timestamp == DEDUCED_TIMESTAMP) {
+			if (srate_ != IRREGULAR_RATE)
+				last_timestamp_ += 1.0/srate_;
+			if (k == 0) {
+				double stamp = last_timestamp_;
+				if (use_byte_order_ != BOOST_BYTE_ORDER)
+					lslboost::endian::reverse(stamp);
+				memcpy(&record[chunk_begin+sizeof(boost::uint32_t)],&stamp,sizeof(stamp));
+			}
+		} else
+			last_timestamp_ = samples[k]->timestamp;
+	}
+	records_.push_back(std::vector<char>());
+	records_.back().swap(record);
+	next_index_ += num_samples;
+	// send it along with as many of the previous chunks as fit into the datagram
+	std::size_t first = records_.size()-1, bytes = header_bytes + records_.back().size();
+	while (first > 0 && bytes + records_[first-1].size() <= max_datagram_bytes)
+		bytes += records_[--first].size();
+	send_datagram((boost::uint32_t)(records_.size()-first),first);
+}
+
+/// Send a datagram with the given chunk count and the given chunk records.
+void datagram_feed_sender::send_datagram(boost::uint32_t num_chunks, std::size_t first_record) {
+	datagram_.clear();
+	vector_sink sink = {datagram_};
+	sample::save_value(sink,id_,use_byte_order_);
+	sample::save_value(sink,num_chunks,use_byte_order_);
+	for (std::size_t k=first_record; k<records_.size(); k++)
+		datagram_.insert(datagram_.end(),records_[k].begin(),records_[k].end());
+	// (a datagram that cannot be sent is simply lost)
+	boost::system::error_code ec;
+	socket_.send_to(buffer(datagram_),target_,0,ec);
+}
+
+
+// === receiver ===
+
+/**
+* Open a socket on an ephemeral port to receive a feed from an outlet.
+* @param source The address of the outlet (datagrams from elsewhere are ignored).
+* @throws std::exception if the socket could not be set up.
+*/
+datagram_feed_receiver::datagram_feed_receiver(const ip::address &source): source_(source), use_byte_order_(BOOST_BYTE_ORDER), id_(0),
+	datagram_(max_datagram_limit), datagram_size_(0), chunks_left_(0), record_pos_(0), chunk_pos_(0), chunk_end_(0), next_index_(0), dropped_(0), ended_(false), cancelled_(false)
+{
+	udp protocol = source.is_v4() ? udp::v4() : udp::v6();
+	socket_.socket().open(protocol);
+	socket_.socket().bind(udp::endpoint(protocol,0));
+	// a large receive buffer absorbs bursts (it does not delay anything, since the datagrams are read as soon as they arrive)
+	boost::system::error_code ec;
+	socket_.socket().set_option(socket_base::receive_buffer_size(receive_buffer_bytes),ec);
+}
+
+/// Destructor. Closes the socket.
+datagram_feed_receiver::~datagram_feed_receiver() {
+	unregister_from_all();
+}
+
+/// Wait for the handshake (or any other datagram) of the feed; returns false if nothing arrived within the timeout.
+bool datagram_feed_receiver::wait_for_handshake(double timeout) {
+	for (double deadline = lsl_clock()+timeout, now = lsl_clock(); now < deadline && !cancelled_; now = lsl_clock())
+		if (receive_datagram(deadline-now))
+			return true;
+	return false;
+}
+
+/// Read data of the feed, waiting until it is available; returns fewer bytes only if the feed has ended or the read was cancelled.
+std::streamsize datagram_feed_receiver::sgetn(char *data, std::streamsize n) {
+	std::streamsize done = 0;
+	while (done < n) {
+		if (chunk_pos_ < chunk_end_) {
+			std::size_t count = std::min(chunk_end_-chunk_pos_,(std::size_t)(n-done));
+			memcpy(data+done,&datagram_[chunk_pos_],count);
+			chunk_pos_ += count;
+			done += count;
+		} else if (!next_chunk())
+			break;
+	}
+	return done;
+}
+
+/// Cancel any blocking read (and all future reads).
+void datagram_feed_receiver::cancel() {
+	cancelled_ = true;
+	socket_.cancel();
+}
+
+/// Move on to the next new chunk (receiving datagrams as needed); returns false if the feed has ended or the read was cancelled.
+bool datagram_feed_receiver::next_chunk() {
+	while (!cancelled_ && !ended_) {
+		// look at the remaining chunks of the current datagram, oldest first
+		while (chunks_left_) {
+			chunks_left_--;
+			if (record_pos_ + record_header_bytes + chunk_header_bytes > datagram_size_)
+				break;
+			boost::uint64_t index = field<boost::uint64_t>(record_pos_);
+			std::size_t begin = record_pos_ + record_header_bytes, size = field<boost::uint32_t>(record_pos_+8);
+			if (size < chunk_header_bytes || begin + size > datagram_size_)
+				break;
+			record_pos_ = begin + size;
+			// skip the chunks that we already have (or that arrived after a newer one)
+			if (index < next_index_)
+				continue;
+			dropped_ += (std::size_t)(index - next_index_);
+			next_index_ = index + field<boost::uint32_t>(begin);
+			chunk_pos_ = begin;
+			chunk_end_ = begin + size;
+			return true;
+		}
+		chunks_left_ = 0;
+		receive_datagram(max_wait);
+	}
+	return false;
+}
+
+/// Receive a datagram of the feed; returns false if none arrived within the timeout.
+bool datagram_feed_receiver::receive_datagram(double timeout) {
+	udp::endpoint sender;
+	datagram_size_ = socket_.receive(&datagram_[0],datagram_.size(),sender,timeout);
+	if (datagram_size_ < header_bytes || sender.address() != source_ || field<boost::uint32_t>(0) != id_)
+		return false;
+	boost::uint32_t num_chunks = field<boost::uint32_t>(4);
+	if (num_chunks == end_of_feed)
+		ended_ = true;
+	else {
+		chunks_left_ = num_chunks;
+		record_pos_ = header_bytes;
+	}
+	return true;
+}
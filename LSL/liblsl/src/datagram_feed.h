@@ -0,0 +1,143 @@
+#ifndef DATAGRAM_FEED_H
+#define DATAGRAM_FEED_H
+
+#include <deque>
+#include <cstring>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include "cancellation.h"
+#include "datagram_socket.h"
+#include "sample.h"
+
+
+namespace lsl {
+
+	/**
+	* Sends the data feed of a client session as unacknowledged datagrams, for inlets that prefer fresh samples over complete ones
+	* (e.g., closed-loop control; "Datagram-Data: <port> <redundancy>" in the feed negotiation). Lost datagrams are not sent again;
+	* instead, each datagram may repeat the most recent chunks of the feed so that isolated losses are bridged without any delay.
+	*
+	* Each datagram carries whole chunks (protocol 1.20, in the negotiated byte order, with the time stamp of the first sample resolved):
+	*   [uint32: feed ID][uint32: number of chunks] followed, oldest first, by
+	*   [uint64: index of the first sample in the feed][uint32: size of the chunk in bytes][chunk]
+	* All header fields are in the byte order of the chunks. A datagram without chunks is a handshake (sent when the feed starts),
+	* and a chunk count of 0xFFFFFFFF announces the end of the feed.
+	*/
+	class datagram_feed_sender: private boost::noncopyable {
+	public:
+		/**
+		* Create a sender for a client.
+		* @param io The IO service of the session (the sender must only be used from its thread).
+		* @param target The address and port to which the datagrams are sent.
+		* @param redundancy The number of datagrams in which each chunk is sent (at least 1).
+		* @param use_byte_order The byte order of the feed.
+		* @param srate The nominal sampling rate of the stream (to resolve deduced time stamps).
+		* @throws std::exception if the socket could not be set up.
+		*/
+		datagram_feed_sender(boost::asio::io_service &io, const boost::asio::ip::udp::endpoint &target, int redundancy, int use_byte_order, double srate);
+
+		/// Destructor. Announces the end of the feed.
+		~datagram_feed_sender();
+
+		/// The random ID that tags the datagrams of the feed.
+		boost::uint32_t id() const { return id_; }
+
+		/// Send a block of samples (split into as many chunks as needed to fit the datagrams).
+		void send(const sample_p *samples, std::size_t num_samples);
+
+		/// Whether a sample of the given size can be sent at all (i.e., fits into the largest possible datagram).
+		static bool supports(std::size_t sample_bytes);
+
+	private:
+		/// Send a chunk of samples (along with the most recent previous ones).
+		void send_chunk(const sample_p *samples, std::size_t num_samples);
+
+		/// Send a datagram with the given chunk count and the given chunk records.
+		void send_datagram(boost::uint32_t num_chunks, std::size_t first_record);
+
+		boost::asio::ip::udp::socket socket_;		// the socket through which we send
+		boost::asio::ip::udp::endpoint target_;		// the address of the client
+		boost::uint32_t id_;						// the ID that tags our datagrams
+		std::size_t redundancy_;					// the number of datagrams per chunk
+		int use_byte_order_;						// the byte order of the feed
+		double srate_;								// the nominal sampling rate
+		boost::uint64_t next_index_;				// the feed index of the next sample
+		double last_timestamp_;						// the (resolved) time stamp of the most recently sent sample
+		std::deque<std::vector<char> > records_;	// the most recent chunk records (index, size and chunk), oldest first
+		std::vector<char> datagram_;				// scratchpad memory for the datagram
+		std::vector<char> coded_;					// scratchpad memory for the byte-order conversion
+	};
+
+
+	/**
+	* Receives the data feed of a datagram_feed_sender and presents its chunks as a stream buffer, in order and without duplicates.
+	* Chunks that arrive late (after a newer one) are dropped, and the samples that never arrived are counted.
+	*/
+	class datagram_feed_receiver: public cancellable_obj, private boost::noncopyable {
+	public:
+		/**
+		* Open a socket on an ephemeral port to receive a feed from an outlet.
+		* @param source The address of the outlet (datagrams from elsewhere are ignored).
+		* @throws std::exception if the socket could not be set up.
+		*/
+		datagram_feed_receiver(const boost::asio::ip::address &source);
+
+		/// Destructor. Closes the socket.
+		~datagram_feed_receiver();
+
+		/// The port on which we receive.
+		int port() { return socket_.socket().local_endpoint().port(); }
+
+		/// Set the ID and the byte order of the feed (once negotiated).
+		void set_feed(boost::uint32_t id, int use_byte_order) { id_ = id; use_byte_order_ = use_byte_order; }
+
+		/// Wait for the handshake (or any other datagram) of the feed; returns false if nothing arrived within the timeout.
+		bool wait_for_handshake(double timeout);
+
+		/// Read data of the feed, waiting until it is available; returns fewer bytes only if the feed has ended or the read was cancelled.
+		std::streamsize sgetn(char *data, std::streamsize n);
+
+		/// Take the number of samples that were lost since the last call.
+		std::size_t take_dropped() { return dropped_.exchange(0); }
+
+		/// Cancel any blocking read (and all future reads).
+		virtual void cancel();
+
+	private:
+		/// Move on to the next new chunk (receiving datagrams as needed); returns false if the feed has ended or the read was cancelled.
+		bool next_chunk();
+
+		/// Receive a datagram of the feed; returns false if none arrived within the timeout.
+		bool receive_datagram(double timeout);
+
+		/// Read a header field of the current datagram at the given position.
+		template<class T> T field(std::size_t pos) {
+			T value;
+			memcpy(&value,&datagram_[pos],sizeof(value));
+			if (sizeof(T) > 1 && use_byte_order_ != BOOST_BYTE_ORDER)
+				lslboost::endian::reverse(value);
+			return value;
+		}
+
+		datagram_socket socket_;			// the socket on which we receive
+		boost::asio::ip::address source_;	// the address of the outlet
+		int use_byte_order_;				// the byte order of the feed
+		boost::uint32_t id_;				// the ID of the feed
+		std::vector<char> datagram_;		// the current datagram
+		std::size_t datagram_size_;			// the size of the current datagram
+		std::size_t chunks_left_;			// the number of chunks in the current datagram that have not been looked at yet
+		std::size_t record_pos_;			// the position of the next chunk record in the current datagram
+		std::size_t chunk_pos_;				// the read position in the current chunk
+		std::size_t chunk_end_;				// the end of the current chunk
+		boost::uint64_t next_index_;		// the feed index of the next sample that we expect
+		boost::atomic<std::size_t> dropped_;	// the number of samples that were lost since the last take_dropped()
+		bool ended_;						// whether the feed has ended
+		boost::atomic<bool> cancelled_;		// whether reads have been cancelled
+	};
+
+}
+
+#endif
@@ -0,0 +1,59 @@
+#include "datagram_socket.h"
+#include <boost/bind.hpp>
+
+
+// === implementation of the datagram_socket class ===
+
+using namespace lsl;
+using namespace boost::asio;
+
+/// Create a (not yet opened) socket.
+datagram_socket::datagram_socket(): socket_(io_), timer_(io_), received_(0) { }
+
+/**
+* Receive a datagram.
+* @param buffer The buffer that receives the datagram.
+* @param size The size of the buffer.
+* @param sender Receives the address of the sender.
+* @param timeout The maximum time to wait, in seconds.
+* @return The size of the datagram, or 0 if none arrived within the timeout (or the socket has been closed).
+*/
+std::size_t datagram_socket::receive(char *buffer, std::size_t size, ip::udp::endpoint &sender, double timeout) {
+	io_.reset();
+	if (!socket_.is_open()) {
+		// run a pending close, if any
+		io_.poll();
+		return 0;
+	}
+	received_ = 0;
+	socket_.async_receive_from(boost::asio::buffer(buffer,size),sender,boost::bind(&datagram_socket::handle_receive,this,placeholders::error,placeholders::bytes_transferred));
+	timer_.expires_from_now(boost::posix_time::microseconds((boost::int64_t)(timeout*1000000)));
+	timer_.async_wait(boost::bind(&datagram_socket::handle_timeout,this,placeholders::error));
+	io_.run();
+	return received_;
+}
+
+/// Close the socket, which ends a blocking receive (may be called from any thread).
+void datagram_socket::cancel() {
+	io_.post(boost::bind(&datagram_socket::close,this));
+}
+
+/// Handler that gets called when a datagram has been received.
+void datagram_socket::handle_receive(boost::system::error_code err, std::size_t len) {
+	if (!err)
+		received_ = len;
+	timer_.cancel();
+}
+
+/// Handler that gets called when the receive has timed out.
+void datagram_socket::handle_timeout(boost::system::error_code err) {
+	if (err != error::operation_aborted && socket_.is_open())
+		socket_.cancel();
+}
+
+/// Close the socket (runs on the receiving thread).
+void datagram_socket::close() {
+	boost::system::error_code ec;
+	socket_.close(ec);
+	timer_.cancel();
+}
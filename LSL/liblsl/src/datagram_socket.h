@@ -0,0 +1,53 @@
+#ifndef DATAGRAM_SOCKET_H
+#define DATAGRAM_SOCKET_H
+
+#include <boost/asio.hpp>
+#include <boost/noncopyable.hpp>
+
+
+namespace lsl {
+
+	/**
+	* A UDP socket with its own IO service, from which a data thread can receive datagrams with a timeout.
+	* A blocking receive can be ended from another thread by cancel() (which closes the socket).
+	*/
+	class datagram_socket: private boost::noncopyable {
+	public:
+		/// Create a (not yet opened) socket.
+		datagram_socket();
+
+		/// The underlying socket (for opening, binding and setting options before the first receive).
+		boost::asio::ip::udp::socket &socket() { return socket_; }
+
+		/**
+		* Receive a datagram.
+		* @param buffer The buffer that receives the datagram.
+		* @param size The size of the buffer.
+		* @param sender Receives the address of the sender.
+		* @param timeout The maximum time to wait, in seconds.
+		* @return The size of the datagram, or 0 if none arrived within the timeout (or the socket has been closed).
+		*/
+		std::size_t receive(char *buffer, std::size_t size, boost::asio::ip::udp::endpoint &sender, double timeout);
+
+		/// Close the socket, which ends a blocking receive (may be called from any thread).
+		void cancel();
+
+	private:
+		/// Handler that gets called when a datagram has been received.
+		void handle_receive(boost::system::error_code err, std::size_t len);
+
+		/// Handler that gets called when the receive has timed out.
+		void handle_timeout(boost::system::error_code err);
+
+		/// Close the socket (runs on the receiving thread).
+		void close();
+
+		boost::asio::io_service io_;			// the IO service on which we receive
+		boost::asio::ip::udp::socket socket_;	// the socket
+		boost::asio::deadline_timer timer_;		// the timeout of a receive
+		std::size_t received_;					// the size of the most recently received datagram (0 if none)
+	};
+
+}
+
+#endif
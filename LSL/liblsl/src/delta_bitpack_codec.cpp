@@ -0,0 +1,228 @@
+#include "delta_bitpack_codec.h"
+#include "value_conversion.h"
+#include <cstring>
+
+
+// === implementation of the delta_bitpack_codec class ===
+
+using namespace lsl;
+
+namespace {
+
+	/// The number of words that share a bit width.
+	const std::size_t group_size = 16;
+
+	/// The error that is thrown for malformed blocks.
+	void corrupted() { throw std::runtime_error("Stream contents corrupted (invalid compressed block)."); }
+
+	/// Number of significant bits of a word.
+	inline unsigned bit_width(boost::uint64_t w) { unsigned n = 0; while (w) { w >>= 1; n++; } return n; }
+
+	/// Number of trailing zero bits of a (non-zero) word.
+	inline unsigned trailing_zeros(boost::uint64_t w) { unsigned n = 0; while (!(w & 1)) { w >>= 1; n++; } return n; }
+
+	/// Zigzag coding of signed differences (small magnitudes become small words).
+	inline boost::uint64_t zigzag(boost::uint64_t d) { return (d << 1) ^ (boost::uint64_t)((boost::int64_t)d >> 63); }
+	inline boost::uint64_t unzigzag(boost::uint64_t z) { return (z >> 1) ^ ((boost::uint64_t)0 - (z & 1)); }
+
+	/// Read a channel value as a 64-bit word (integers sign-extended, floating-point numbers as their bit pattern).
+	inline boost::uint64_t load_word(const char *p, channel_format_t fmt) {
+		switch (fmt) {
+			case cf_int8: return (boost::uint64_t)(boost::int64_t)*(const boost::int8_t*)p;
+			case cf_int16: { boost::int16_t v; memcpy(&v,p,sizeof(v)); return (boost::uint64_t)(boost::int64_t)v; }
+			case cf_int32: { boost::int32_t v; memcpy(&v,p,sizeof(v)); return (boost::uint64_t)(boost::int64_t)v; }
+			case cf_float32: { boost::uint32_t v; memcpy(&v,p,sizeof(v)); return v; }
+			default: { boost::uint64_t v; memcpy(&v,p,sizeof(v)); return v; }
+		}
+	}
+
+	/// Store a 64-bit word as a channel value (truncating it to the size of the format).
+	inline void store_word(char *p, channel_format_t fmt, boost::uint64_t w) {
+		switch (fmt) {
+			case cf_int8: *(boost::int8_t*)p = (boost::int8_t)w; break;
+			case cf_int16: { boost::int16_t v = (boost::int16_t)w; memcpy(p,&v,sizeof(v)); break; }
+			case cf_int32: { boost::int32_t v = (boost::int32_t)w; memcpy(p,&v,sizeof(v)); break; }
+			case cf_float32: { boost::uint32_t v = (boost::uint32_t)w; memcpy(p,&v,sizeof(v)); break; }
+			default: memcpy(p,&w,sizeof(w));
+		}
+	}
+
+	/// Transform a column of channel values into words (differences for integers, XORs for floating-point numbers).
+	void transform_column(const char *values, std::size_t stride, std::size_t n, channel_format_t fmt, boost::uint64_t *words) {
+		boost::uint64_t prev = 0;
+		bool integer = fmt != cf_float32 && fmt != cf_double64;
+		for (std::size_t k=0; k<n; k++, values += stride) {
+			boost::uint64_t cur = load_word(values,fmt);
+			words[k] = integer ? zigzag(cur - prev) : (cur ^ prev);
+			prev = cur;
+		}
+	}
+
+	/// Invert the transformation of a column of words back into channel values.
+	void restore_column(const boost::uint64_t *words, std::size_t n, channel_format_t fmt, char *values, std::size_t stride) {
+		boost::uint64_t prev = 0;
+		bool integer = fmt != cf_float32 && fmt != cf_double64;
+		for (std::size_t k=0; k<n; k++, values += stride) {
+			prev = integer ? prev + unzigzag(words[k]) : (prev ^ words[k]);
+			store_word(values,fmt,prev);
+		}
+	}
+
+	/// Append a column of words to a buffer, bit-packed in groups.
+	void pack_column(const boost::uint64_t *words, std::size_t n, std::vector<char> &out) {
+		for (std::size_t begin=0; begin<n; begin+=group_size) {
+			std::size_t count = std::min(group_size,n-begin);
+			// determine the common trailing zeros and the bit width of the group
+			boost::uint64_t all = 0;
+			for (std::size_t k=0; k<count; k++)
+				all |= words[begin+k];
+			unsigned shift = all ? trailing_zeros(all) : 0, width = bit_width(all >> shift);
+			out.push_back((char)shift);
+			out.push_back((char)width);
+			if (!width)
+				continue;
+			// pack the words LSB-first (in pieces of at most 32 bits)
+			boost::uint64_t acc = 0; unsigned bits = 0;
+			for (std::size_t k=0; k<count; k++) {
+				boost::uint64_t w = words[begin+k] >> shift;
+				for (unsigned remaining=width; remaining; ) {
+					unsigned piece = std::min(remaining,32u);
+					acc |= (w & ((boost::uint64_t(1) << piece) - 1)) << bits;
+					bits += piece; w >>= piece; remaining -= piece;
+					for (; bits >= 8; bits -= 8, acc >>= 8)
+						out.push_back((char)(acc & 0xFF));
+				}
+			}
+			if (bits)
+				out.push_back((char)(acc & 0xFF));
+		}
+	}
+
+	/// Read a bit-packed column of words from a buffer; returns the position after the column.
+	const unsigned char *unpack_column(const unsigned char *p, const unsigned char *end, std::size_t n, boost::uint64_t *words) {
+		for (std::size_t begin=0; begin<n; begin+=group_size) {
+			std::size_t count = std::min(group_size,n-begin);
+			if (end-p < 2)
+				corrupted();
+			unsigned shift = p[0], width = p[1];
+			p += 2;
+			if (width > 64 || shift + width > 64)
+				corrupted();
+			if ((std::size_t)(end-p) < (count*width+7)/8)
+				corrupted();
+			if (!width) {
+				for (std::size_t k=0; k<count; k++)
+					words[begin+k] = 0;
+				continue;
+			}
+			boost::uint64_t acc = 0; unsigned bits = 0;
+			for (std::size_t k=0; k<count; k++) {
+				boost::uint64_t w = 0;
+				for (unsigned done=0; done<width; ) {
+					unsigned piece = std::min(width-done,32u);
+					for (; bits < piece; bits += 8)
+						acc |= (boost::uint64_t)*p++ << bits;
+					w |= (acc & ((boost::uint64_t(1) << piece) - 1)) << done;
+					acc >>= piece; bits -= piece; done += piece;
+				}
+				words[begin+k] = w << shift;
+			}
+		}
+		return p;
+	}
+}
+
+/// Create a codec for samples of a given format and channel count.
+delta_bitpack_codec::delta_bitpack_codec(channel_format_t fmt, int num_channels): format_(fmt), num_channels_(num_channels), sample_bytes_(format_sizes[fmt]*num_channels) {
+	if (!supports(fmt))
+		throw std::invalid_argument("The delta-bitpack codec does not support this channel format.");
+}
+
+/**
+* Encode a block of samples and append it to a buffer.
+* @param samples The samples to encode.
+* @param num_samples The number of samples (at least 1).
+* @param out The buffer to append the block to.
+*/
+void delta_bitpack_codec::encode(const sample_p *samples, std::size_t num_samples, std::vector<char> &out) {
+	std::size_t start = out.size();
+	out.resize(start+4);
+	// number of samples
+	for (std::size_t n=num_samples; ; n >>= 7) {
+		if (n < 0x80) { out.push_back((char)n); break; }
+		out.push_back((char)((n & 0x7F) | 0x80));
+	}
+	// bitmap of the explicit time stamps and the time stamps themselves
+	std::size_t bitmap = out.size();
+	out.resize(bitmap + (num_samples+7)/8, 0);
+	timestamps_.clear();
+	for (std::size_t k=0; k<num_samples; k++) {
+		if (samples[k]->timestamp != DEDUCED_TIMESTAMP) {
+			out[bitmap + k/8] |= (char)(1 << (k%8));
+			timestamps_.push_back(samples[k]->timestamp);
+		}
+	}
+	words_.resize(num_samples);
+	if (!timestamps_.empty()) {
+		transform_column((const char*)&timestamps_[0],sizeof(double),timestamps_.size(),cf_double64,&words_[0]);
+		pack_column(&words_[0],timestamps_.size(),out);
+	}
+	// channel data, column by column
+	rows_.resize(num_samples*sample_bytes_);
+	for (std::size_t k=0; k<num_samples; k++)
+		samples[k]->retrieve_untyped(&rows_[k*sample_bytes_]);
+	for (int c=0; c<num_channels_; c++) {
+		transform_column(&rows_[c*format_sizes[format_]],sample_bytes_,num_samples,format_,&words_[0]);
+		pack_column(&words_[0],num_samples,out);
+	}
+	// fill in the size of the remainder
+	boost::uint32_t size = (boost::uint32_t)(out.size() - start - 4);
+	for (int b=0; b<4; b++)
+		out[start+b] = (char)((size >> (8*b)) & 0xFF);
+}
+
+/// Decode the remainder of a block (after its size field) into new samples.
+void delta_bitpack_codec::decode(const char *data, std::size_t size, sample::factory &factory, bool suppress_subnormals, std::vector<sample_p> &samples) {
+	const unsigned char *p = (const unsigned char*)data, *end = p + size;
+	// number of samples
+	std::size_t num_samples = 0;
+	for (unsigned shift=0; ; shift += 7) {
+		if (p == end || shift > 28)
+			corrupted();
+		num_samples |= (std::size_t)(*p & 0x7F) << shift;
+		if (!(*p++ & 0x80))
+			break;
+	}
+	// every channel needs at least two bytes per group, which bounds the number of samples before we allocate anything
+	std::size_t bitmap_bytes = (num_samples+7)/8, num_groups = (num_samples+group_size-1)/group_size;
+	if (!num_samples || (std::size_t)(end-p) < bitmap_bytes + 2*num_groups*num_channels_)
+		corrupted();
+	const unsigned char *bitmap = p;
+	p += bitmap_bytes;
+	std::size_t num_timestamps = 0;
+	for (std::size_t k=0; k<num_samples; k++)
+		if (bitmap[k/8] & (1 << (k%8)))
+			num_timestamps++;
+	words_.resize(num_samples);
+	timestamps_.resize(num_timestamps);
+	if (num_timestamps) {
+		p = unpack_column(p,end,num_timestamps,&words_[0]);
+		restore_column(&words_[0],num_timestamps,cf_double64,(char*)&timestamps_[0],sizeof(double));
+	}
+	// channel data, column by column
+	rows_.resize(num_samples*sample_bytes_);
+	for (int c=0; c<num_channels_; c++) {
+		p = unpack_column(p,end,num_samples,&words_[0]);
+		restore_column(&words_[0],num_samples,format_,&rows_[c*format_sizes[format_]],sample_bytes_);
+	}
+	if (p != end)
+		corrupted();
+	if (suppress_subnormals)
+		flush_subnormals(format_,&rows_[0],num_samples*num_channels_);
+	// create the samples
+	for (std::size_t k=0,t=0; k<num_samples; k++) {
+		sample_p s(factory.new_sample((bitmap[k/8] & (1 << (k%8))) ? timestamps_[t++] : DEDUCED_TIMESTAMP,false));
+		s->assign_untyped(&rows_[k*sample_bytes_]);
+		samples.push_back(s);
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef DELTA_BITPACK_CODEC_H
+#define DELTA_BITPACK_CODEC_H
+
+#include <vector>
+#include <stdexcept>
+#include <boost/cstdint.hpp>
+#include "sample.h"
+
+namespace lsl {
+
+	/**
+	* A fast lossless codec for blocks of numeric samples, which can be negotiated for the data feed ("Compression: delta-bitpack").
+	* The values of a block are coded channel by channel: integers as the zigzag-coded differences between successive samples,
+	* and floating-point numbers as the XOR of the bit patterns of successive samples. The resulting words are bit-packed in groups
+	* of 16, each with the bit width (and number of trailing zero bits) of its largest word, so that smooth signals such as 24-bit EEG
+	* or 16-bit audio take only a fraction of their raw size. Explicit time stamps are coded like the values of a double channel.
+	*
+	* Block layout (multi-byte quantities are little endian):
+	*   [uint32: size of the remainder][varint: number of samples][bitmap: samples that have an explicit time stamp]
+	*   [coded explicit time stamps][coded values of channel 0] ... [coded values of channel n-1]
+	* Each coded column is a sequence of groups: [uint8: trailing zero bits][uint8: bit width][bit-packed words].
+	*/
+	class delta_bitpack_codec {
+	public:
+		/// The name of the codec in the feed negotiation.
+		static const char *name() { return "delta-bitpack"; }
+
+		/// Whether the codec can code samples of the given channel format.
+		static bool supports(channel_format_t fmt) { return fmt != cf_string && fmt != cf_undefined && format_sizes[fmt] > 0; }
+
+		/// Create a codec for samples of a given format and channel count.
+		delta_bitpack_codec(channel_format_t fmt, int num_channels);
+
+		/**
+		* Encode a block of samples and append it to a buffer.
+		* @param samples The samples to encode.
+		* @param num_samples The number of samples (at least 1).
+		* @param out The buffer to append the block to.
+		*/
+		void encode(const sample_p *samples, std::size_t num_samples, std::vector<char> &out);
+
+		/**
+		* Read a block from a stream buffer and decode it into new samples.
+		* @param sb The stream buffer to read from.
+		* @param factory The factory to allocate the samples from.
+		* @param suppress_subnormals Whether subnormal values shall be flushed to zero.
+		* @param samples The vector to which the decoded samples are appended.
+		*/
+		template<class StreamBuf> void read_block(StreamBuf &sb, sample::factory &factory, bool suppress_subnormals, std::vector<sample_p> &samples) {
+			unsigned char header[4];
+			if (sb.sgetn((char*)header,sizeof(header)) != sizeof(header))
+				throw std::runtime_error("Input stream error.");
+			std::size_t size = header[0] | (header[1] << 8) | (header[2] << 16) | ((std::size_t)header[3] << 24);
+			if (size > max_block_bytes)
+				throw std::runtime_error("Stream contents corrupted (compressed block too large).");
+			payload_.resize(size);
+			if (size && (std::size_t)sb.sgetn(&payload_[0],(std::streamsize)size) != size)
+				throw std::runtime_error("Input stream error.");
+			decode(size ? &payload_[0] : NULL,size,factory,suppress_subnormals,samples);
+		}
+
+		/// Decode the remainder of a block (after its size field) into new samples.
+		void decode(const char *data, std::size_t size, sample::factory &factory, bool suppress_subnormals, std::vector<sample_p> &samples);
+
+	private:
+		// upper bound for the size of a block that we accept
+		enum { max_block_bytes = 1<<30 };
+
+		channel_format_t format_;				// the channel format of the samples
+		int num_channels_;						// the number of channels of the samples
+		std::size_t sample_bytes_;				// the number of bytes of a sample's channel data
+		std::vector<char> rows_;				// scratch buffer holding the channel data of a block in sample order
+		std::vector<boost::uint64_t> words_;	// scratch buffer holding the transformed words of a column
+		std::vector<double> timestamps_;		// scratch buffer holding the explicit time stamps of a block
+		std::vector<char> payload_;				// scratch buffer holding a received block
+	};
+
+}
+
+#endif
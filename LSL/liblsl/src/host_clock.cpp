@@ -0,0 +1,318 @@
+#include <iostream>
+#include <boost/bind.hpp>
+#include <boost/thread/once.hpp>
+#include "host_clock.h"
+#include "common.h"
+#include "time_probe.h"
+#include "socket_utils.h"
+
+#ifdef __linux__
+	#include <sys/socket.h>
+#endif
+
+
+// === implementation of the host_clock class ===
+
+using namespace lsl;
+using namespace boost::asio;
+using boost::posix_time::millisec;
+
+namespace {
+	/// The shared clocks of this process, by host address (created once; protected by clocks_mut).
+	boost::once_flag clocks_once = BOOST_ONCE_INIT;
+	boost::mutex *clocks_mut = NULL;
+	std::map<ip::address,boost::weak_ptr<host_clock> > *clocks = NULL;
+
+	/// Create the clock table (called once).
+	void create_clocks() {
+		clocks_mut = new boost::mutex();
+		clocks = new std::map<ip::address,boost::weak_ptr<host_clock> >();
+	}
+}
+
+/**
+* Get the clock of the host of a stream, starting it if necessary.
+* @param endpoint The UDP service endpoint of the stream.
+* @param reactor The inlet reactor on which the clock runs, or an empty pointer if the clock shall run a thread of its own.
+*/
+host_clock_p host_clock::get(const udp::endpoint &endpoint, const inlet_reactor_p &reactor) {
+	if (!api_config::get_instance()->share_host_clocks())
+		return host_clock_p(new host_clock(endpoint.protocol(),reactor));
+	boost::call_once(&create_clocks,clocks_once);
+	boost::lock_guard<boost::mutex> lock(*clocks_mut);
+	host_clock_p result = (*clocks)[endpoint.address()].lock();
+	if (!result) {
+		result.reset(new host_clock(endpoint.protocol(),reactor));
+		(*clocks)[endpoint.address()] = result;
+	}
+	return result;
+}
+
+/// Create the clock (see get()); the probing starts with the first subscription.
+host_clock::host_clock(udp protocol, const inlet_reactor_p &reactor): next_id_(1), target_id_(0), started_(false), have_estimate_(false),
+	cfg_(api_config::get_instance()), reactor_(reactor), io_(reactor ? reactor->io() : clock_io_), strand_(io_), stopped_(false),
+	time_sock_(io_), next_estimate_(io_), aggregate_results_(io_), next_packet_(io_)
+{
+	time_sock_.open(protocol);
+	time_sock_.non_blocking(true);
+	enable_receive_timestamps(time_sock_);
+}
+
+/// Destructor. Stops the probing.
+host_clock::~host_clock() {
+	try {
+		if (reactor_)
+			strand_.close(boost::bind(&host_clock::stop_operations,this));
+		else {
+			clock_io_.stop();
+			if (clock_thread_.joinable())
+				clock_thread_.join();
+		}
+	}
+	catch(std::exception &e) {
+		std::cerr << "Unexpected error during destruction of a host_clock: " << e.what() << std::endl;
+	}
+	catch(...) {
+		std::cerr << "Severe error during host clock shutdown." << std::endl;
+	}
+}
+
+/**
+* Subscribe to the estimates of the clock (the first subscription starts the probing).
+* @param endpoint The UDP service endpoint of the subscriber's stream (may be used as a target for the probes).
+* @param binary Whether the UDP service of the subscriber's stream understands the binary time probes (see time_probe.h).
+* @param lis The listener that receives the estimates (must stay alive until it is unsubscribed).
+* @param use_current Whether the listener shall receive the current estimate right away (if there is one), or only the next one.
+* @return The ID of the subscription.
+*/
+boost::uint32_t host_clock::subscribe(const udp::endpoint &endpoint, bool binary, listener *lis, bool use_current) {
+	boost::lock_guard<boost::mutex> lock(subscribers_mut_);
+	subscriber sub = {lis,endpoint,binary};
+	boost::uint32_t id = next_id_++;
+	subscribers_[id] = sub;
+	if (use_current && have_estimate_)
+		lis->estimate(offset_,remote_time_,uncertainty_);
+	// start probing once there is a target for the probes
+	if (!started_) {
+		started_ = true;
+		strand_.post(boost::bind(&host_clock::start_time_estimation,this));
+		if (!reactor_)
+			clock_thread_ = boost::thread(&host_clock::clock_thread,this);
+	}
+	return id;
+}
+
+/// Cancel a subscription; once this returns, the listener is no longer called.
+void host_clock::unsubscribe(boost::uint32_t id) {
+	boost::lock_guard<boost::mutex> lock(subscribers_mut_);
+	subscribers_.erase(id);
+}
+
+
+// === internal processing ===
+
+/// The thread that runs the operations (unless they run on the inlet reactor).
+void host_clock::clock_thread() {
+	while (true) {
+		try {
+			clock_io_.run();
+			break;
+		} catch(std::exception &e) {
+			std::cerr << "Hiccup during clock_thread io_service processing: " << e.what() << std::endl;
+		}
+	}
+}
+
+/// Start a new multi-packet exchange for time estimation
+void host_clock::start_time_estimation() {
+	if (stopped_)
+		return;
+	// clear the estimates buffer
+	estimates_.clear();
+	estimate_times_.clear();
+	// generate a new wave id so that we don't confuse packets from earlier (or mis-guided) estimations
+	current_wave_id_ = rng_();
+	// start the packet exchange chains
+	send_next_packet(1);
+	receive_next_packet();
+	// schedule the aggregation of results (by the time when all replies should have been received)
+	aggregate_results_.expires_from_now(millisec(1000*(cfg_->time_probe_max_rtt() + cfg_->time_probe_interval()*cfg_->time_probe_count())));
+	aggregate_results_.async_wait(strand_.wrap(boost::bind(&host_clock::result_aggregation_scheduled,this,placeholders::error)));
+	// schedule the next estimation step
+	next_estimate_.expires_from_now(millisec(1000*cfg_->time_update_interval()));
+	next_estimate_.async_wait(strand_.wrap(boost::bind(&host_clock::next_estimate_scheduled,this,placeholders::error)));
+}
+
+/// Handler that gets called once the next time estimation shall be scheduled
+void host_clock::next_estimate_scheduled(error_code err) {
+	if (err != error::operation_aborted)
+		start_time_estimation();
+}
+
+/// Send the next packet in an exchange
+void host_clock::send_next_packet(int packet_num) {
+	if (stopped_)
+		return;
+	try {
+		// pick the stream to which we send (the current target, or the next one if it has unsubscribed)
+		udp::endpoint target;
+		bool binary = false;
+		{
+			boost::lock_guard<boost::mutex> lock(subscribers_mut_);
+			subscriber_map::iterator sub = subscribers_.lower_bound(target_id_);
+			if (sub == subscribers_.end())
+				sub = subscribers_.begin();
+			if (sub != subscribers_.end()) {
+				target_id_ = sub->first;
+				target = sub->second.endpoint;
+				binary = sub->second.binary;
+			}
+		}
+		// form the request & send it
+		if (target.port()) {
+			string_p msg_buffer;
+			if (binary) {
+				msg_buffer.reset(new std::string(time_request_bytes,'\0'));
+				encode_time_request(&(*msg_buffer)[0],current_wave_id_,lsl_clock());
+			} else {
+				std::ostringstream request; request.precision(16); request << "LSL:timedata\r\n" << current_wave_id_ << " " << lsl_clock() << "\r\n";
+				msg_buffer.reset(new std::string(request.str()));
+			}
+			time_sock_.async_send_to(boost::asio::buffer(*msg_buffer), target,
+				strand_.wrap(boost::bind(&host_clock::handle_send_outcome,this,msg_buffer,placeholders::error)));
+		}
+	} catch(std::exception &e) {
+		std::cerr << "Error trying to send a time packet: " << e.what() << std::endl;
+	}
+	// schedule next packet
+	if (packet_num < cfg_->time_probe_count()) {
+		next_packet_.expires_from_now(millisec(1000.0*cfg_->time_probe_interval()));
+		next_packet_.async_wait(strand_.wrap(boost::bind(&host_clock::next_packet_scheduled,this,++packet_num,placeholders::error)));
+	}
+}
+
+/// Handler that gets called once the sending of a packet has completed
+void host_clock::handle_send_outcome(string_p, error_code) { }
+
+/// Handler that gets called when the next packet shall be scheduled
+void host_clock::next_packet_scheduled(int packet_num, error_code err) {
+	if (!err)
+		send_next_packet(packet_num);
+}
+
+/// Request reception of the next time packets (waits until the socket is readable; the packets are then read by receive_packet())
+void host_clock::receive_next_packet() {
+	if (stopped_)
+		return;
+	time_sock_.async_receive(boost::asio::null_buffers(),
+		strand_.wrap(boost::bind(&host_clock::handle_receive_outcome, this, placeholders::error)));
+}
+
+/// Handler that gets called once time packets can be read from the socket
+void host_clock::handle_receive_outcome(error_code err) {
+	if (err == error::operation_aborted)
+		return;
+	// read all packets that have arrived (this also clears a pending socket error)
+	std::size_t len;
+	double t3;
+	while (receive_packet(len,t3))
+		process_reply(len,t3);
+	receive_next_packet();
+}
+
+/**
+* Read the next packet from the socket (without blocking) into the receive buffer.
+* @param len Receives the length of the packet.
+* @param t3 Receives the time of reception (the receive time stamp of the kernel if available, otherwise the current time).
+* @return Whether a packet was read.
+*/
+bool host_clock::receive_packet(std::size_t &len, double &t3) {
+#ifdef __linux__
+	iovec iov = {recv_buffer_,sizeof(recv_buffer_)};
+	receive_time_control control;
+	msghdr msg;
+	memset(&msg,0,sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+	ssize_t result = recvmsg(time_sock_.native_handle(),&msg,MSG_DONTWAIT);
+	if (result < 0)
+		return false;
+	len = (std::size_t)result;
+	if (!(t3 = kernel_receive_time(msg)))
+		t3 = lsl_clock();
+	return true;
+#else
+	error_code ec;
+	len = time_sock_.receive_from(boost::asio::buffer(recv_buffer_),remote_endpoint_,0,ec);
+	t3 = lsl_clock();
+	return !ec;
+#endif
+}
+
+/// Process a time packet that has been received at time t3
+void host_clock::process_reply(std::size_t len, double t3) {
+	try {
+		// parse the buffer contents (a binary reply or a text reply)
+		boost::int32_t wave_id = 0;
+		double t0 = 0, t1 = 0, t2 = 0;
+		bool valid = true;
+		if (is_time_reply(recv_buffer_,len))
+			decode_time_reply(recv_buffer_,wave_id,t0,t1,t2);
+		else {
+			std::istringstream is(std::string(recv_buffer_,len));
+			is >> wave_id >> t0 >> t1 >> t2;
+			valid = !is.fail();
+		}
+		if (valid && wave_id == current_wave_id_) {
+			// calculate RTT and offset
+			double rtt = (t3-t0) - (t2-t1);				// round trip time (time passed here - time passed there)
+			double offset = ((t1-t0) + (t2-t3)) / 2;	// averaged clock offset (other clock - my clock) with rtt bias averaged out
+			// store it
+			estimates_.push_back(std::make_pair(rtt,offset));
+			estimate_times_.push_back(std::make_pair((t3 + t0)/2.0, (t2 + t1)/2.0));   //local_time, remote_time
+		}
+	} catch(std::exception &e) {
+		std::cerr << "Error while processing a time estimation return packet: " << e.what() << std::endl;
+	}
+}
+
+/// Handlers that gets called once the time estimation results shall be aggregated.
+void host_clock::result_aggregation_scheduled(error_code err) {
+	if (!err) {
+		boost::lock_guard<boost::mutex> lock(subscribers_mut_);
+		if ((int)estimates_.size() >= cfg_->time_update_minprobes()) {
+			// take the estimate with the lowest error bound (=rtt), as in NTP
+			double best_offset=0, best_rtt=FOREVER;
+			double best_remote_time=0;
+			for (unsigned k=0;k<estimates_.size();k++) {
+				if (estimates_[k].first < best_rtt) {
+					best_rtt = estimates_[k].first;
+					best_offset = estimates_[k].second;
+					best_remote_time = estimate_times_[k].second;
+				}
+			}
+			// remember the result and hand it to the subscribers
+			have_estimate_ = true;
+			uncertainty_ = best_rtt;
+			offset_ = -best_offset;
+			remote_time_ = best_remote_time;
+			for (subscriber_map::iterator sub=subscribers_.begin(); sub!=subscribers_.end(); sub++)
+				sub->second.lis->estimate(offset_,remote_time_,uncertainty_);
+		} else {
+			// the stream that we probed may be gone: try another stream of the host in the next round
+			target_id_++;
+		}
+	}
+}
+
+/// Stop all operations (runs on the strand when the clock is destroyed).
+void host_clock::stop_operations() {
+	stopped_ = true;
+	error_code ec;
+	next_estimate_.cancel(ec);
+	aggregate_results_.cancel(ec);
+	next_packet_.cancel(ec);
+	time_sock_.close(ec);
+}
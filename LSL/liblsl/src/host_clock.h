@@ -0,0 +1,161 @@
+#ifndef HOST_CLOCK_H
+#define HOST_CLOCK_H
+
+#include <map>
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/random.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include "inlet_reactor.h"
+#include "api_config.h"
+
+
+using boost::asio::ip::udp;
+using boost::asio::deadline_timer;
+using boost::system::error_code;
+
+namespace lsl {
+
+	/// list of time estimates with error bounds
+	typedef std::vector<std::pair<double,double> > estimate_list;
+	/// pointer to a string
+	typedef boost::shared_ptr<std::string> string_p;
+	/// shared pointer to the clock of a host
+	typedef boost::shared_ptr<class host_clock> host_clock_p;
+
+	/**
+	* The clock of a remote host, as estimated by periodic exchanges of time packets with the UDP servers of its streams.
+	* All streams of a host share the clock of that host, so if enabled in the configuration (see api_config::share_host_clocks()),
+	* the inlets of this process that read from streams of the same host subscribe to the same host_clock, which runs a single
+	* probing schedule for all of them and hands each estimate to every subscriber. Otherwise each inlet has a clock of its own.
+	*
+	* The probes are sent to the UDP service port of one of the subscribed streams (another one is tried if a round of probes fails).
+	* Where supported, the replies are stamped with their receive times from the kernel (see enable_receive_timestamps()), so that
+	* the delays of the handler dispatch do not add to the measured round-trip times.
+	* The clock runs its operations on the inlet reactor if the inlets do, otherwise on a thread of its own.
+	*/
+	class host_clock: private boost::noncopyable {
+	public:
+		/// The receiving end of a subscription (its function is called from the thread or strand of the clock).
+		class listener {
+		public:
+			virtual ~listener() { }
+			/**
+			* A new estimate of the clock is available.
+			* @param offset The time correction offset (to be added to remote time stamps to map them into the local clock).
+			* @param remote_time The remote time at which the offset was measured.
+			* @param uncertainty The uncertainty of the offset (the round-trip time of the best probe).
+			*/
+			virtual void estimate(double offset, double remote_time, double uncertainty) = 0;
+		};
+
+		/**
+		* Get the clock of the host of a stream, starting it if necessary.
+		* @param endpoint The UDP service endpoint of the stream.
+		* @param reactor The inlet reactor on which the clock runs, or an empty pointer if the clock shall run a thread of its own.
+		*/
+		static host_clock_p get(const udp::endpoint &endpoint, const inlet_reactor_p &reactor);
+
+		/// Destructor. Stops the probing.
+		~host_clock();
+
+		/**
+		* Subscribe to the estimates of the clock (the first subscription starts the probing).
+		* @param endpoint The UDP service endpoint of the subscriber's stream (may be used as a target for the probes).
+		* @param binary Whether the UDP service of the subscriber's stream understands the binary time probes (see time_probe.h).
+		* @param lis The listener that receives the estimates (must stay alive until it is unsubscribed).
+		* @param use_current Whether the listener shall receive the current estimate right away (if there is one), or only the next one.
+		* @return The ID of the subscription.
+		*/
+		boost::uint32_t subscribe(const udp::endpoint &endpoint, bool binary, listener *lis, bool use_current);
+
+		/// Cancel a subscription; once this returns, the listener is no longer called.
+		void unsubscribe(boost::uint32_t id);
+
+	private:
+		/// A subscriber to the estimates.
+		struct subscriber {
+			listener *lis;				// the listener of the subscriber
+			udp::endpoint endpoint;		// the UDP service endpoint of the subscriber's stream
+			bool binary;				// whether that endpoint understands the binary time probes
+		};
+		typedef std::map<boost::uint32_t,subscriber> subscriber_map;
+
+		/// Create the clock (see get()); the probing starts with the first subscription.
+		host_clock(udp protocol, const inlet_reactor_p &reactor);
+
+		/// The thread that runs the operations (unless they run on the inlet reactor).
+		void clock_thread();
+
+		/// Start a new multi-packet exchange for time estimation
+		void start_time_estimation();
+
+		/// Handler that gets called once the next time estimation shall be scheduled
+		void next_estimate_scheduled(error_code err);
+
+		/// Send the next packet in an exchange
+		void send_next_packet(int packet_num);
+
+		/// Handler that gets called once the sending of a packet has completed
+		void handle_send_outcome(string_p msg_buffer, error_code err);
+
+		/// Handler that gets called when the next packet shall be scheduled
+		void next_packet_scheduled(int packet_num, error_code err);
+
+		/// Request reception of the next time packets (waits until the socket is readable; the packets are then read by receive_packet())
+		void receive_next_packet();
+
+		/// Handler that gets called once time packets can be read from the socket
+		void handle_receive_outcome(error_code err);
+
+		/**
+		* Read the next packet from the socket (without blocking) into the receive buffer.
+		* @param len Receives the length of the packet.
+		* @param t3 Receives the time of reception (the receive time stamp of the kernel if available, otherwise the current time).
+		* @return Whether a packet was read.
+		*/
+		bool receive_packet(std::size_t &len, double &t3);
+
+		/// Process a time packet that has been received at time t3
+		void process_reply(std::size_t len, double t3);
+
+		/// Handlers that gets called once the time estimation results shall be aggregated.
+		void result_aggregation_scheduled(error_code err);
+
+		/// Stop all operations (runs on the strand when the clock is destroyed).
+		void stop_operations();
+
+		// the subscribers and the most recent estimate
+		subscriber_map subscribers_;				// the subscribers, by ID
+		boost::uint32_t next_id_;					// the ID of the next subscription
+		boost::uint32_t target_id_;					// the ID of the subscriber to whose stream the probes are sent
+		bool started_;								// whether the probing has been started by the first subscription
+		bool have_estimate_;						// whether an estimate is available
+		double offset_, remote_time_, uncertainty_;	// the most recent estimate (if any)
+		boost::mutex subscribers_mut_;				// mutex to protect the subscribers, the target, the start flag and the estimate (held while a listener is being called)
+
+		// data used by the operations
+		const api_config *cfg_;						// the configuration object
+		inlet_reactor_p reactor_;					// the inlet reactor on which we run, if any
+		boost::asio::io_service clock_io_;			// an IO service for the operations (unless they run on the inlet reactor)
+		boost::asio::io_service &io_;				// the IO service on which the operations run (clock_io_ or that of the inlet reactor)
+		reactor_strand strand_;						// runs the handlers of the operations one at a time
+		bool stopped_;								// whether the operations have been stopped (strand only)
+		char recv_buffer_[16384];					// a buffer to hold inbound packet contents
+		boost::random::mt19937 rng_;				// a random number generator
+		udp::socket time_sock_;						// the socket through which the probes are exchanged
+		deadline_timer next_estimate_;				// schedule the next time estimate
+		deadline_timer aggregate_results_;			// schedules result aggregation
+		deadline_timer next_packet_;				// schedules the next packet transfer
+		udp::endpoint remote_endpoint_;				// a dummy endpoint
+		estimate_list estimates_;					// a vector of time estimates collected so far during the current exchange
+		estimate_list estimate_times_;              // a vector of the local time and the remote time at a given estimate
+		int current_wave_id_;						// an id for the current wave of time packets
+		boost::thread clock_thread_;				// the thread that runs clock_io_ (unless we run on the inlet reactor)
+	};
+
+}
+
+#endif
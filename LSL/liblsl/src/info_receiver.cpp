@@ -7,16 +7,32 @@
 // === implementation of the info_receiver class ===
 
 using namespace lsl;
+using namespace boost::asio;
+
+namespace {
+	/// The request for the full info.
+	const char fullinfo_request[] = "LSL:fullinfo\r\n";
+}
 
 /// Construct a new info receiver.
-info_receiver::info_receiver(inlet_connection &conn): conn_(conn) {
+info_receiver::info_receiver(inlet_connection &conn): conn_(conn), started_(false), watchdog_held_(false), stopped_(false) {
 	conn_.register_onlost(this,&fullinfo_upd_);
+	if (conn_.reactor()) {
+		strand_.reset(new reactor_strand(conn_.reactor()->io()));
+		register_at(&conn_);
+	}
 }
 
 /// Destructor. Stops the background activities.
 info_receiver::~info_receiver() {
 	try {
 		conn_.unregister_onlost(this);
+		if (strand_) {
+			unregister_from_all();
+			strand_->close(boost::bind(&info_receiver::stop_operations,this));
+			if (watchdog_held_)
+				conn_.release_watchdog();
+		}
 		if (info_thread_.joinable())
 			info_thread_.join();
 	} 
@@ -32,9 +48,16 @@ info_receiver::~info_receiver() {
 const stream_info_impl &info_receiver::info(double timeout) {
 	boost::unique_lock<boost::mutex> lock(fullinfo_mut_);
 	if (!info_ready()) {
-		// start thread if not yet running
-		if (!info_thread_.joinable())
-			info_thread_ = boost::thread(&info_receiver::info_thread,this);
+		// start the query if not yet running (in a thread, or on the inlet reactor)
+		if (!started_) {
+			started_ = true;
+			if (strand_) {
+				watchdog_held_ = true;
+				conn_.acquire_watchdog();
+				strand_->post(boost::bind(&info_receiver::request_info,this));
+			} else
+				info_thread_ = boost::thread(&info_receiver::info_thread,this);
+		}
 		// wait until we are ready to return a result (or we time out)
 		if (timeout >= FOREVER)
 			fullinfo_upd_.wait(lock, boost::bind(&info_receiver::info_ready,this));
@@ -91,3 +114,110 @@ void info_receiver::info_thread() {
 	conn_.release_watchdog();
 }
 
+
+// === the info query on the inlet reactor ===
+
+/// Connect to the outlet and request the info.
+void info_receiver::request_info() {
+	if (stopped_ || conn_.lost() || conn_.shutdown()) {
+		finish();
+		return;
+	}
+	try {
+		info_buf_.consume(info_buf_.size());
+		info_sock_.reset(new tcp::socket(strand_->io()));
+		info_sock_->async_connect(conn_.get_tcp_endpoint(),strand_->wrap(boost::bind(&info_receiver::handle_connect_outcome,this,placeholders::error)));
+	} catch(std::exception &e) {
+		std::cerr << "Error while requesting the stream info (" << e.what() << "); retrying..." << std::endl;
+		retry_after_error();
+	}
+}
+
+/// Handler that gets called when the connection attempt has completed.
+void info_receiver::handle_connect_outcome(error_code err) {
+	if (err || stopped_) {
+		retry_after_error();
+		return;
+	}
+	async_write(*info_sock_,buffer(fullinfo_request,sizeof(fullinfo_request)-1),strand_->wrap(boost::bind(&info_receiver::handle_send_outcome,this,placeholders::error)));
+}
+
+/// Handler that gets called when the request has been sent.
+void info_receiver::handle_send_outcome(error_code err) {
+	if (err || stopped_) {
+		retry_after_error();
+		return;
+	}
+	async_read(*info_sock_,info_buf_,strand_->wrap(boost::bind(&info_receiver::handle_receive_outcome,this,placeholders::error)));
+}
+
+/// Handler that gets called when the response has been received completely (i.e., the outlet has closed the connection).
+void info_receiver::handle_receive_outcome(error_code err) {
+	if (err != error::eof || stopped_) {
+		retry_after_error();
+		return;
+	}
+	try {
+		close_socket();
+		stream_info_impl info;
+		std::string msg(buffers_begin(info_buf_.data()),buffers_end(info_buf_.data()));
+		info.from_fullinfo_message(msg);
+		// if this is not a valid streaminfo we retry
+		if (!info.created_at()) {
+			request_info();
+			return;
+		}
+		// store the result for pickup & return
+		{
+			boost::lock_guard<boost::mutex> lock(fullinfo_mut_);
+			fullinfo_ = stream_info_impl_p(new stream_info_impl(info));
+		}
+		fullinfo_upd_.notify_all();
+		finish();
+	} catch(std::exception &e) {
+		// parsing-level error: intermittent disconnect or invalid protocol
+		std::cerr << "Error while receiving the stream info (" << e.what() << "); retrying..." << std::endl;
+		retry_after_error();
+	}
+}
+
+/// Close the socket after an error and retry once the connection has been recovered (unless the stream has been lost or shut down).
+void info_receiver::retry_after_error() {
+	close_socket();
+	if (stopped_ || !conn_.recover_from_error_async(boost::bind(&info_receiver::retry_after_recovery,this)))
+		finish();
+}
+
+/// Callback of the recovery attempt (called from its thread); schedules the next attempt of the query.
+void info_receiver::retry_after_recovery() {
+	strand_->post(boost::bind(&info_receiver::request_info,this));
+}
+
+/// End the query (and release the watchdog).
+void info_receiver::finish() {
+	close_socket();
+	if (watchdog_held_) {
+		watchdog_held_ = false;
+		conn_.release_watchdog();
+	}
+}
+
+/// Close the socket of the query, if any.
+void info_receiver::close_socket() {
+	if (info_sock_) {
+		error_code ec;
+		info_sock_->close(ec);
+	}
+}
+
+/// Cancel the current query (if running on the inlet reactor); it is retried at the (possibly recovered) endpoint.
+void info_receiver::cancel() {
+	if (strand_)
+		strand_->post(boost::bind(&info_receiver::close_socket,this));
+}
+
+/// Stop the query (runs on the inlet reactor when the info_receiver is destroyed).
+void info_receiver::stop_operations() {
+	stopped_ = true;
+	close_socket();
+}
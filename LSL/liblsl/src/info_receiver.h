@@ -3,6 +3,7 @@
 
 #include "inlet_connection.h"
 #include <boost/thread.hpp>
+#include <boost/scoped_ptr.hpp>
 
 
 namespace lsl {
@@ -11,7 +12,8 @@ namespace lsl {
 	/// The actual communication runs in an internal background thread, while the public function (info()) waits for the thread to finish.
 	/// The public function has an optional timeout after which it gives up, while the background thread continues to do its job (so the next public-function call may succeed within the timeout).
 	/// The background thread terminates only if the info_receiver is destroyed or the underlying connection is lost or shut down.
-	class info_receiver {
+	/// If the inlet runs on the inlet reactor, the info is retrieved by asynchronous operations on the reactor instead of a thread.
+	class info_receiver: public cancellable_obj {
 	public:
 		/// Construct a new info receiver for a given connection.
 		info_receiver(inlet_connection &conn);
@@ -26,9 +28,41 @@ namespace lsl {
 		*/
 		const stream_info_impl &info(double timeout=FOREVER);
 
+		/// Cancel the current query (if running on the inlet reactor); it is retried at the (possibly recovered) endpoint.
+		virtual void cancel();
+
 	private:
 		/// The info reader thread.
 		void info_thread();
+
+		// === the info query on the inlet reactor ===
+
+		/// Connect to the outlet and request the info.
+		void request_info();
+
+		/// Handler that gets called when the connection attempt has completed.
+		void handle_connect_outcome(error_code err);
+
+		/// Handler that gets called when the request has been sent.
+		void handle_send_outcome(error_code err);
+
+		/// Handler that gets called when the response has been received completely (i.e., the outlet has closed the connection).
+		void handle_receive_outcome(error_code err);
+
+		/// Close the socket after an error and retry once the connection has been recovered (unless the stream has been lost or shut down).
+		void retry_after_error();
+
+		/// Callback of the recovery attempt (called from its thread); schedules the next attempt of the query.
+		void retry_after_recovery();
+
+		/// End the query (and release the watchdog).
+		void finish();
+
+		/// Close the socket of the query, if any.
+		void close_socket();
+
+		/// Stop the query (runs on the inlet reactor when the info_receiver is destroyed).
+		void stop_operations();
 		
 		/// function polled by the condition variable
 		bool info_ready() { return fullinfo_ || conn_.lost(); }
@@ -42,6 +76,14 @@ namespace lsl {
 		stream_info_impl_p fullinfo_;				// the full stream_info_impl object (retrieved by the info thread)
 		boost::mutex fullinfo_mut_;					// mutex to protect the fullinfo
 		boost::condition_variable fullinfo_upd_;	// condition variable to indicate that an update for the fullinfo is available
+
+		// the query when running on the inlet reactor
+		boost::scoped_ptr<reactor_strand> strand_;	// runs the handlers of the query one at a time (if on the reactor)
+		boost::scoped_ptr<tcp::socket> info_sock_;	// the socket of the current query attempt
+		boost::asio::streambuf info_buf_;			// holds the response of the outlet
+		bool started_;								// whether the query has been started
+		bool watchdog_held_;						// whether the query holds the watchdog (strand only once started)
+		bool stopped_;								// whether the query has been stopped (strand only)
 	};
 
 }
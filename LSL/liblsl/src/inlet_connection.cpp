@@ -19,7 +19,7 @@ using namespace boost::asio;
 * @param recover Try to silently recover lost streams that are recoverable (=those that that have a source_id set).
 *				 In all other cases (recover is false or the stream is not recoverable) a lost_error is thrown where indicated if the stream's source is lost (e.g., due to an app or computer crash).
 */
-inlet_connection::inlet_connection(const stream_info_impl &info, bool recover): type_info_(info), host_info_(info), recovery_enabled_(recover), tcp_protocol_(tcp::v4()), udp_protocol_(udp::v4()), lost_(false), shutdown_(false), last_receive_time_(lsl_clock()), active_transmissions_(0) {
+inlet_connection::inlet_connection(const stream_info_impl &info, bool recover): type_info_(info), host_info_(info), recovery_enabled_(recover), tcp_protocol_(tcp::v4()), udp_protocol_(udp::v4()), lost_(false), reactor_(inlet_reactor::configured()), recovering_(false), shutdown_(false), last_receive_time_(lsl_clock()), active_transmissions_(0) {
 	// if the given stream_info is already fully resolved...
 	if (!host_info_.v4address().empty() || !host_info_.v6address().empty()) {
 
@@ -76,12 +76,22 @@ inlet_connection::inlet_connection(const stream_info_impl &info, bool recover):
 		// recovery must generally be enabled
 		recovery_enabled_ = true;
 	}	
+
+	// the watchdog runs on the inlet reactor if there is one
+	if (reactor_) {
+		watchdog_strand_.reset(new reactor_strand(reactor_->io()));
+		watchdog_timer_.reset(new deadline_timer(reactor_->io()));
+	}
 }
 
 /// Engage the connection and its recovery watchdog thread.
 void inlet_connection::engage() {
-	if (recovery_enabled_)
-		watchdog_thread_ = boost::thread(&inlet_connection::watchdog_thread,this);
+	if (recovery_enabled_) {
+		if (reactor_)
+			watchdog_strand_->post(boost::bind(&inlet_connection::watchdog_check,this,error_code()));
+		else
+			watchdog_thread_ = boost::thread(&inlet_connection::watchdog_thread,this);
+	}
 }
 
 /// Disengage the connection and all its resolver capabilities (including the watchdog).
@@ -96,8 +106,13 @@ void inlet_connection::disengage() {
 	resolver_.cancel();
 	cancel_and_shutdown();
 	// and wait for the watchdog to finish
-	if (recovery_enabled_)
+	if (reactor_)
+		watchdog_strand_->close(boost::bind(&inlet_connection::cancel_watchdog,this));
+	else if (recovery_enabled_)
 		watchdog_thread_.join();
+	// as well as a recovery attempt that may be running in the background (no new one can start now)
+	if (recovery_thread_.joinable())
+		recovery_thread_.join();
 }
 
 
@@ -119,12 +134,26 @@ udp::endpoint inlet_connection::get_udp_endpoint() {
 	return udp::endpoint(ip::address::from_string(address),(unsigned short)port);
 }
 
+// get the endpoint of the multiplexing server from the info (port 0 if there is none or we use IPv6)
+tcp::endpoint inlet_connection::get_mux_endpoint() {
+	boost::shared_lock<boost::shared_mutex> lock(host_info_mut_);
+	if (tcp_protocol_ != tcp::v4())
+		return tcp::endpoint(tcp::v4(),0);
+	return tcp::endpoint(ip::address::from_string(host_info_.v4address()),(unsigned short)host_info_.v4mux_port());
+}
+
 // get the hostname from the info
 std::string inlet_connection::get_hostname() {
 	boost::shared_lock<boost::shared_mutex> lock(host_info_mut_);
 	return host_info_.hostname();
 }
 
+// get the newest version of the binary time probes that the UDP service port understands (0 if only the text probes)
+int inlet_connection::get_timedata_version() {
+	boost::shared_lock<boost::shared_mutex> lock(host_info_mut_);
+	return host_info_.timedata_version();
+}
+
 /// get the current stream UID (may change between crashes/reconnects)
 std::string inlet_connection::current_uid() {
 	boost::shared_lock<boost::shared_mutex> lock(host_info_mut_);
@@ -227,6 +256,64 @@ void inlet_connection::watchdog_thread() {
 	}
 }
 
+/// The periodic check of the watchdog when it runs on the inlet reactor (see watchdog_thread()).
+void inlet_connection::watchdog_check(error_code err) {
+	if (err == error::operation_aborted || lost_ || shutdown_)
+		return;
+	try {
+		// we only try to recover if a) there are active transmissions and b) we haven't seen new data for some time
+		{
+			boost::unique_lock<boost::mutex> lock(client_status_mut_);
+			if ((active_transmissions_ > 0) && (lsl_clock() - last_receive_time_ > api_config::get_instance()->watchdog_time_threshold())) {
+				lock.unlock();
+				recover_in_background();
+			}
+		}
+		// schedule the next check
+		watchdog_timer_->expires_from_now(boost::posix_time::millisec((int)(1000*api_config::get_instance()->watchdog_check_interval())));
+		watchdog_timer_->async_wait(watchdog_strand_->wrap(boost::bind(&inlet_connection::watchdog_check,this,placeholders::error)));
+	} catch(std::exception &e) {
+		std::cerr << "Unexpected hiccup in the watchdog: " << e.what() << std::endl;
+	}
+}
+
+/// Cancel the watchdog timer (runs on the inlet reactor).
+void inlet_connection::cancel_watchdog() {
+	error_code ec;
+	watchdog_timer_->cancel(ec);
+}
+
+/// Start a recovery attempt in a background thread, unless one is in progress already; on_done (if any) is called once it has finished.
+/// Returns false if the connection is shutting down.
+bool inlet_connection::recover_in_background(const boost::function<void()> &on_done) {
+	boost::lock_guard<boost::mutex> lock(shutdown_mut_);
+	if (shutdown_)
+		return false;
+	if (on_done)
+		recovery_done_.push_back(on_done);
+	if (!recovering_) {
+		// (a previous recovery thread has finished already)
+		if (recovery_thread_.joinable())
+			recovery_thread_.join();
+		recovering_ = true;
+		recovery_thread_ = boost::thread(&inlet_connection::recovery_thread,this);
+	}
+	return true;
+}
+
+/// The background thread of recover_in_background().
+void inlet_connection::recovery_thread() {
+	try_recover();
+	std::vector<boost::function<void()> > done;
+	{
+		boost::lock_guard<boost::mutex> lock(shutdown_mut_);
+		recovering_ = false;
+		done.swap(recovery_done_);
+	}
+	for (std::vector<boost::function<void()> >::iterator i=done.begin(); i!=done.end(); i++)
+		(*i)();
+}
+
 /// Issue a recovery attempt if a connection loss was detected.
 void inlet_connection::try_recover_from_error() {
 	if (!shutdown_) {
@@ -247,6 +334,19 @@ void inlet_connection::try_recover_from_error() {
 	}
 }
 
+/// Handle a connection error of an asynchronous operation (which must not block for a recovery).
+/// This declares the connection as lost if recovery is disabled; otherwise a recovery attempt is started in the
+/// background (or joined if one is in progress), and on_done is called from the background thread once it has finished.
+/// Returns whether the operation should be retried (false if lost or shut down, in which case on_done is not called).
+bool inlet_connection::recover_from_error_async(const boost::function<void()> &on_done) {
+	if (recovery_enabled_)
+		return recover_in_background(on_done);
+	try {
+		try_recover_from_error();
+	} catch(lost_error &) { }
+	return !lost_ && !shutdown_;
+}
+
 
 // === client status updates ===
 
@@ -2,16 +2,19 @@
 #define INLET_CONNECTION_H
 
 #include <map>
+#include <vector>
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
 #include <boost/function.hpp>
 #include "common.h"
 #include "resolver_impl.h"
 #include "cancellation.h"
+#include "inlet_reactor.h"
 
 
 using boost::asio::ip::tcp;
 using boost::asio::ip::udp;
+using boost::system::error_code;
 
 namespace lsl {
 
@@ -24,6 +27,10 @@ namespace lsl {
 	* Since in some cases a client might not be able to detect a connection loss and so would stall forever, the inlet_connection 
 	* maintains a watchdog thread that periodically checks and recovers the connection state. Internally the recovery works by 
 	* using the resolver to find the desired stream on the network again and updating the endpoint information if it has changed.
+	*
+	* If the inlets run on the inlet reactor (see api_config::inlet_reactor()), the watchdog is a periodic timer on the reactor, 
+	* and the (blocking) recovery attempts that it and the asynchronous components of the inlet request run in a background thread 
+	* that exists only while a recovery is in progress.
 	*/
 	class inlet_connection: public cancellable_registry {
 	public:
@@ -52,8 +59,12 @@ namespace lsl {
 		tcp::endpoint get_tcp_endpoint();
 		/// Get the current UDP endpoint from the info (according to our configured protocol).
 		udp::endpoint get_udp_endpoint();
+		/// Get the current endpoint of the multiplexing server of the outlet's process (port 0 if there is none or we use IPv6).
+		tcp::endpoint get_mux_endpoint();
 		/// Get the current hostname from the info.
 		std::string get_hostname();
+		/// Get the newest version of the binary time probes that the UDP service port understands (0 if only the text probes).
+		int get_timedata_version();
 
 		/// Get the TCP protocol type.
 		tcp tcp_protocol() const { return tcp_protocol_; }
@@ -78,6 +89,12 @@ namespace lsl {
 		/// (e.g., socket error).
 		void try_recover_from_error();
 
+		/// Handle a connection error of an asynchronous operation (which must not block for a recovery).
+		/// This declares the connection as lost if recovery is disabled; otherwise a recovery attempt is started in the
+		/// background (or joined if one is in progress), and on_done is called from the background thread once it has finished.
+		/// Returns whether the operation should be retried (false if lost or shut down, in which case on_done is not called).
+		bool recover_from_error_async(const boost::function<void()> &on_done);
+
 
 		// === client status info ===
 
@@ -116,6 +133,9 @@ namespace lsl {
 		/// Get the current stream instance UID (which would be different after a crash and restart of the data source).
 		std::string current_uid();
 
+		/// Get the reactor on which the inlet runs its background activities (empty if each component runs threads of its own).
+		const inlet_reactor_p &reactor() const { return reactor_; }
+
 		/// Get the nominal srate of the endpoint; we assume that this might possibly change between crashes/restarts 
 		/// of the data source under some circumstances (although such behavior would be strongly discouraged).
 		double current_srate();
@@ -125,6 +145,19 @@ namespace lsl {
         /// A thread that periodically checks whether the connection should be recovered.
         void watchdog_thread();
 
+		/// The periodic check of the watchdog when it runs on the inlet reactor (see watchdog_thread()).
+		void watchdog_check(error_code err);
+
+		/// Cancel the watchdog timer (runs on the inlet reactor).
+		void cancel_watchdog();
+
+		/// Start a recovery attempt in a background thread, unless one is in progress already; on_done (if any) is called once it has finished.
+		/// Returns false if the connection is shutting down.
+		bool recover_in_background(const boost::function<void()> &on_done=boost::function<void()>());
+
+		/// The background thread of recover_in_background().
+		void recovery_thread();
+
         /// A (potentially speculative) resolve-and-recover operation.
         void try_recover();
 
@@ -140,6 +173,14 @@ namespace lsl {
 		// internal watchdog thread (to detect dead connections)
 		boost::thread watchdog_thread_;				// re-resolves the current connection speculatively
 
+		// the inlet reactor (if used) and the watchdog that runs on it
+		inlet_reactor_p reactor_;					// the reactor on which the inlet runs (empty if not used)
+		boost::scoped_ptr<reactor_strand> watchdog_strand_;	// runs the watchdog checks on the reactor
+		boost::scoped_ptr<boost::asio::deadline_timer> watchdog_timer_;	// schedules the next watchdog check
+		boost::thread recovery_thread_;				// runs a recovery attempt that was requested on the reactor (protected by shutdown_mut_)
+		bool recovering_;							// whether the recovery thread is running (protected by shutdown_mut_)
+		std::vector<boost::function<void()> > recovery_done_;	// callbacks for the end of the running recovery attempt (protected by shutdown_mut_)
+
 		// things related to the shutdown condition
 		bool shutdown_;								// indicates to threads that we're shutting down
 		boost::mutex shutdown_mut_;					// a mutex to protect the shutdown state
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <boost/bind.hpp>
+#include <boost/thread/once.hpp>
+#include "inlet_reactor.h"
+#include "api_config.h"
+
+
+// === implementation of the inlet_reactor class ===
+
+using namespace lsl;
+using namespace boost::asio;
+
+namespace {
+	/// The reactor of this process, if any (created once; protected by reactor_mut).
+	boost::once_flag reactor_once = BOOST_ONCE_INIT;
+	boost::mutex *reactor_mut = NULL;
+	boost::weak_ptr<inlet_reactor> *reactor = NULL;
+
+	/// Create the state of the process-wide reactor (called once).
+	void create_reactor_state() {
+		reactor_mut = new boost::mutex();
+		reactor = new boost::weak_ptr<inlet_reactor>();
+	}
+
+	/// Run an IO service until it is stopped (continuing after errors in handlers).
+	void run_io(io_service *io) {
+		while (true) {
+			try {
+				io->run();
+				return;
+			} catch(std::exception &e) {
+				std::cerr << "Error during io_service processing of the inlet reactor: " << e.what() << std::endl;
+			}
+		}
+	}
+}
+
+/// Get the reactor of this process, starting it if necessary.
+inlet_reactor_p inlet_reactor::instance() {
+	boost::call_once(&create_reactor_state,reactor_once);
+	boost::lock_guard<boost::mutex> lock(*reactor_mut);
+	inlet_reactor_p result = reactor->lock();
+	if (!result) {
+		result.reset(new inlet_reactor());
+		*reactor = result;
+	}
+	return result;
+}
+
+/// Get the reactor of this process if the configuration asks for one, otherwise an empty pointer.
+inlet_reactor_p inlet_reactor::configured() {
+	return api_config::get_instance()->inlet_reactor() ? instance() : inlet_reactor_p();
+}
+
+/// Start the threads (see instance()).
+inlet_reactor::inlet_reactor(): work_(new io_service::work(io_)) {
+	for (unsigned k=0, num_threads=std::max(1u,boost::thread::hardware_concurrency()); k<num_threads; k++)
+		threads_.create_thread(boost::bind(&run_io,&io_));
+}
+
+/// Destructor. Stops the threads.
+inlet_reactor::~inlet_reactor() {
+	work_.reset();
+	io_.stop();
+	threads_.join_all();
+}
+
+
+// === implementation of the reactor_strand class ===
+
+/// Create a strand on the given IO service.
+reactor_strand::reactor_strand(io_service &io): strand_(io), state_(new idle_state()) {
+	state_->idle = false;
+	idle_notifier notifier = {state_};
+	// (the token points to the state merely so that it is non-empty; the notifier does not delete anything)
+	token_ = boost::shared_ptr<void>(static_cast<void*>(state_.get()),notifier);
+}
+
+/**
+* Close the strand: runs the given handler on the strand, which must end all activities of the component (close its sockets,
+* cancel its timers), and waits until all handlers have run. Must not be called from a handler of the strand.
+*/
+void reactor_strand::close(const boost::function<void()> &stop) {
+	post(boost::bind(&reactor_strand::run_stop,this,stop));
+	boost::unique_lock<boost::mutex> lock(state_->mut);
+	while (!state_->idle)
+		state_->upd.wait(lock);
+}
+
+/// Run the stop handler of close() and release our token (runs on the strand).
+void reactor_strand::run_stop(const boost::function<void()> &stop) {
+	try {
+		stop();
+	} catch(std::exception &e) {
+		std::cerr << "Unexpected error while stopping an inlet component: " << e.what() << std::endl;
+	}
+	boost::lock_guard<boost::mutex> lock(token_mut_);
+	token_.reset();
+}
@@ -0,0 +1,125 @@
+#ifndef INLET_REACTOR_H
+#define INLET_REACTOR_H
+
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+
+namespace lsl {
+
+	/// shared pointer to an inlet reactor
+	typedef boost::shared_ptr<class inlet_reactor> inlet_reactor_p;
+
+	/**
+	* The inlet reactor of a process: a pool of threads (one per core) that run a shared IO service, on which the inlets of the
+	* process run their watchdog, time and info activities as asynchronous operations, instead of each inlet running a few threads 
+	* of its own. The data is received on the reactor only over a multiplexed connection (see api_config::multiplex()); the other
+	* transports (in-process, shared memory, a TCP connection of the inlet's own) are built on blocking reads and still run in a 
+	* data thread per inlet. With multiplexing, this keeps the number of threads constant for applications with hundreds of inlets.
+	*
+	* The reactor is used if enabled in the configuration (see api_config::inlet_reactor()). It is created with the first inlet
+	* that asks for it and stops once the last inlet has released it. The components of an inlet run their handlers through a
+	* reactor_strand each.
+	*/
+	class inlet_reactor: private boost::noncopyable {
+	public:
+		/// Get the reactor of this process, starting it if necessary.
+		static inlet_reactor_p instance();
+
+		/// Get the reactor of this process if the configuration asks for one, otherwise an empty pointer.
+		static inlet_reactor_p configured();
+
+		/// Destructor. Stops the threads.
+		~inlet_reactor();
+
+		/// The IO service on which the inlets run.
+		boost::asio::io_service &io() { return io_; }
+
+	private:
+		/// Start the threads (see instance()).
+		inlet_reactor();
+
+		boost::asio::io_service io_;							// the IO service that is shared by the inlets
+		boost::scoped_ptr<boost::asio::io_service::work> work_;	// keeps the threads running while there is nothing to do
+		boost::thread_group threads_;							// the threads that run the IO service
+	};
+
+
+	/**
+	* Runs the handlers of an inlet component on an IO service one at a time (as a strand) and keeps track of them, so that the
+	* component can wait until all of them have run before it goes away (see close()).
+	* Handlers that are posted or wrapped after the strand has been closed are dropped without being called.
+	*/
+	class reactor_strand: private boost::noncopyable {
+		/// A handler that holds on to the token of the strand until it has run.
+		template <class Handler> class tracked_handler {
+		public:
+			tracked_handler(const Handler &handler, const boost::shared_ptr<void> &token): handler_(handler), token_(token) { }
+			void operator()() { if (token_) handler_(); }
+			template <class Arg1> void operator()(const Arg1 &arg1) { if (token_) handler_(arg1); }
+			template <class Arg1, class Arg2> void operator()(const Arg1 &arg1, const Arg2 &arg2) { if (token_) handler_(arg1,arg2); }
+		private:
+			Handler handler_;
+			boost::shared_ptr<void> token_;
+		};
+
+	public:
+		/// Create a strand on the given IO service.
+		reactor_strand(boost::asio::io_service &io);
+
+		/// The IO service of the strand.
+		boost::asio::io_service &io() { return strand_.get_io_service(); }
+
+		/// Wrap a completion handler so that it runs on the strand.
+		template <class Handler> boost::asio::detail::wrapped_handler<boost::asio::io_service::strand,tracked_handler<Handler>,boost::asio::detail::is_continuation_if_running> wrap(const Handler &handler) {
+			return strand_.wrap(tracked_handler<Handler>(handler,token()));
+		}
+
+		/// Schedule a handler to run on the strand (it is dropped if the strand has been closed).
+		template <class Handler> void post(const Handler &handler) {
+			boost::shared_ptr<void> tok = token();
+			if (tok)
+				strand_.post(tracked_handler<Handler>(handler,tok));
+		}
+
+		/**
+		* Close the strand: runs the given handler on the strand, which must end all activities of the component (close its sockets,
+		* cancel its timers), and waits until all handlers have run. Must not be called from a handler of the strand.
+		* A wrapped handler is waited for from the moment it has been wrapped, so its operation must either be ended by the stop 
+		* handler or complete on its own.
+		*/
+		void close(const boost::function<void()> &stop);
+
+	private:
+		/// The state of the tracked handlers.
+		struct idle_state {
+			boost::mutex mut;				// protects the state
+			boost::condition_variable upd;	// notified when the strand has become idle
+			bool idle;						// whether all tracked handlers are gone
+		};
+
+		/// Deleter of the token; marks the strand as idle.
+		struct idle_notifier {
+			boost::shared_ptr<idle_state> state;
+			void operator()(void *) { boost::lock_guard<boost::mutex> lock(state->mut); state->idle = true; state->upd.notify_all(); }
+		};
+
+		/// Get the current token (empty once the strand has been closed).
+		boost::shared_ptr<void> token() { boost::lock_guard<boost::mutex> lock(token_mut_); return token_; }
+
+		/// Run the stop handler of close() and release our token (runs on the strand).
+		void run_stop(const boost::function<void()> &stop);
+
+		boost::asio::io_service::strand strand_;	// the strand on which the handlers run
+		boost::shared_ptr<idle_state> state_;		// the state that is updated when the last token has been released
+		boost::shared_ptr<void> token_;				// the token that is handed to all tracked handlers (released when the strand is closed)
+		boost::mutex token_mut_;					// protects the token
+	};
+
+}
+
+#endif
@@ -771,6 +771,273 @@ LIBLSL_C_API unsigned long lsl_pull_chunk_buf(lsl_inlet in, char **data_buffer,
 	return 0;
 }
 
+LIBLSL_C_API unsigned long lsl_pull_chunk_min_f(lsl_inlet in, float *data_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, unsigned long min_samples, int *ec) {
+	if (ec)
+		*ec = lsl_no_error;
+	try {
+		return ((stream_inlet_impl*)in)->pull_chunk_multiplexed(data_buffer,timestamp_buffer,data_buffer_elements,timestamp_buffer_elements,timeout,min_samples);
+	}
+	catch(timeout_error &) { 
+		if (ec)
+			*ec = lsl_timeout_error; 
+	}
+	catch(lost_error &) { 
+		if (ec)
+			*ec = lsl_lost_error; 
+	}
+	catch(std::invalid_argument &) { 
+		if (ec)
+			*ec = lsl_argument_error; 
+	}
+	catch(std::range_error &) {
+		if (ec)
+			*ec = lsl_argument_error; 
+	}
+	catch(std::exception &) { 
+		if (ec)
+			*ec = lsl_internal_error; 
+	}
+	return 0;
+}
+
+LIBLSL_C_API unsigned long lsl_pull_chunk_min_d(lsl_inlet in, double *data_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, unsigned long min_samples, int *ec) {
+	if (ec)
+		*ec = lsl_no_error;
+	try {
+		return ((stream_inlet_impl*)in)->pull_chunk_multiplexed(data_buffer,timestamp_buffer,data_buffer_elements,timestamp_buffer_elements,timeout,min_samples);
+	}
+	catch(timeout_error &) { 
+		if (ec)
+			*ec = lsl_timeout_error; 
+	}
+	catch(lost_error &) { 
+		if (ec)
+			*ec = lsl_lost_error; 
+	}
+	catch(std::invalid_argument &) { 
+		if (ec)
+			*ec = lsl_argument_error; 
+	}
+	catch(std::range_error &) {
+		if (ec)
+			*ec = lsl_argument_error; 
+	}
+	catch(std::exception &) { 
+		if (ec)
+			*ec = lsl_internal_error; 
+	}
+	return 0;
+}
+
+LIBLSL_C_API unsigned long lsl_pull_chunk_min_l(lsl_inlet in, long *data_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, unsigned long min_samples, int *ec) {
+	if (ec)
+		*ec = lsl_no_error;
+	try {
+		return ((stream_inlet_impl*)in)->pull_chunk_multiplexed(data_buffer,timestamp_buffer,data_buffer_elements,timestamp_buffer_elements,timeout,min_samples);
+	}
+	catch(timeout_error &) { 
+		if (ec)
+			*ec = lsl_timeout_error; 
+	}
+	catch(lost_error &) { 
+		if (ec)
+			*ec = lsl_lost_error; 
+	}
+	catch(std::invalid_argument &) { 
+		if (ec)
+			*ec = lsl_argument_error; 
+	}
+	catch(std::range_error &) {
+		if (ec)
+			*ec = lsl_argument_error; 
+	}
+	catch(std::exception &) { 
+		if (ec)
+			*ec = lsl_internal_error; 
+	}
+	return 0;
+}
+
+LIBLSL_C_API unsigned long lsl_pull_chunk_min_i(lsl_inlet in, int *data_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, unsigned long min_samples, int *ec) {
+	if (ec)
+		*ec = lsl_no_error;
+	try {
+		return ((stream_inlet_impl*)in)->pull_chunk_multiplexed(data_buffer,timestamp_buffer,data_buffer_elements,timestamp_buffer_elements,timeout,min_samples);
+	}
+	catch(timeout_error &) { 
+		if (ec)
+			*ec = lsl_timeout_error; 
+	}
+	catch(lost_error &) { 
+		if (ec)
+			*ec = lsl_lost_error; 
+	}
+	catch(std::invalid_argument &) { 
+		if (ec)
+			*ec = lsl_argument_error; 
+	}
+	catch(std::range_error &) {
+		if (ec)
+			*ec = lsl_argument_error; 
+	}
+	catch(std::exception &) { 
+		if (ec)
+			*ec = lsl_internal_error; 
+	}
+	return 0;
+}
+
+LIBLSL_C_API unsigned long lsl_pull_chunk_min_s(lsl_inlet in, short *data_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, unsigned long min_samples, int *ec) {
+	if (ec)
+		*ec = lsl_no_error;
+	try {
+		return ((stream_inlet_impl*)in)->pull_chunk_multiplexed(data_buffer,timestamp_buffer,data_buffer_elements,timestamp_buffer_elements,timeout,min_samples);
+	}
+	catch(timeout_error &) { 
+		if (ec)
+			*ec = lsl_timeout_error; 
+	}
+	catch(lost_error &) { 
+		if (ec)
+			*ec = lsl_lost_error; 
+	}
+	catch(std::invalid_argument &) { 
+		if (ec)
+			*ec = lsl_argument_error; 
+	}
+	catch(std::range_error &) {
+		if (ec)
+			*ec = lsl_argument_error; 
+	}
+	catch(std::exception &) { 
+		if (ec)
+			*ec = lsl_internal_error; 
+	}
+	return 0;
+}
+
+LIBLSL_C_API unsigned long lsl_pull_chunk_min_c(lsl_inlet in, char *data_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, unsigned long min_samples, int *ec) {
+	if (ec)
+		*ec = lsl_no_error;
+	try {
+		return ((stream_inlet_impl*)in)->pull_chunk_multiplexed(data_buffer,timestamp_buffer,data_buffer_elements,timestamp_buffer_elements,timeout,min_samples);
+	}
+	catch(timeout_error &) { 
+		if (ec)
+			*ec = lsl_timeout_error; 
+	}
+	catch(lost_error &) { 
+		if (ec)
+			*ec = lsl_lost_error; 
+	}
+	catch(std::invalid_argument &) { 
+		if (ec)
+			*ec = lsl_argument_error; 
+	}
+	catch(std::range_error &) {
+		if (ec)
+			*ec = lsl_argument_error; 
+	}
+	catch(std::exception &) { 
+		if (ec)
+			*ec = lsl_internal_error; 
+	}
+	return 0;
+}
+
+LIBLSL_C_API unsigned long lsl_pull_chunk_min_str(lsl_inlet in, char **data_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, unsigned long min_samples, int *ec) {
+	if (ec)
+		*ec = lsl_no_error;
+	try {
+		// capture output in a temporary string buffer
+		if (data_buffer_elements) {
+			std::vector<std::string> tmp(data_buffer_elements);
+			unsigned long result = ((stream_inlet_impl*)in)->pull_chunk_multiplexed(&tmp[0],timestamp_buffer,data_buffer_elements,timestamp_buffer_elements,timeout,min_samples);
+			// allocate memory and copy over into buffer (only the elements that have been written)
+			for (unsigned k=0;k<result;k++) {
+				data_buffer[k] = (char*)malloc(tmp[k].size()+1);
+				if (data_buffer[k] == NULL) {
+					for (unsigned k2=0;k2<k;k2++)
+						free(data_buffer[k2]);
+					*ec = lsl_internal_error;
+					return 0;
+				}
+				strcpy(data_buffer[k],tmp[k].c_str());
+			}
+			return result;
+		} else
+			return 0;
+	}
+	catch(timeout_error &) { 
+		if (ec)
+			*ec = lsl_timeout_error; 
+	}
+	catch(lost_error &) { 
+		if (ec)
+			*ec = lsl_lost_error; 
+	}
+	catch(std::invalid_argument &) { 
+		if (ec)
+			*ec = lsl_argument_error; 
+	}
+	catch(std::range_error &) {
+		if (ec)
+			*ec = lsl_argument_error; 
+	}
+	catch(std::exception &) { 
+		if (ec)
+			*ec = lsl_internal_error; 
+	}
+	return 0;
+}
+
+LIBLSL_C_API unsigned long lsl_pull_chunk_min_buf(lsl_inlet in, char **data_buffer, unsigned *lengths_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, unsigned long min_samples, int *ec) {
+	if (ec)
+		*ec = lsl_no_error;
+	try {
+		// capture output in a temporary string buffer
+		if (data_buffer_elements) {
+			std::vector<std::string> tmp(data_buffer_elements);
+			unsigned long result = ((stream_inlet_impl*)in)->pull_chunk_multiplexed(&tmp[0],timestamp_buffer,data_buffer_elements,timestamp_buffer_elements,timeout,min_samples);
+			// allocate memory and copy over into buffer (only the elements that have been written)
+			for (unsigned k=0;k<result;k++) {
+				data_buffer[k] = (char*)malloc(tmp[k].size()+1);
+				if (data_buffer[k] == NULL) {
+					for (unsigned k2=0;k2<k;k2++)
+						free(data_buffer[k2]);
+					*ec = lsl_internal_error;
+					return 0;
+				}
+				lengths_buffer[k] = (unsigned)tmp[k].size();
+				strcpy(data_buffer[k],tmp[k].c_str());
+			}
+			return result;
+		} else
+			return 0;
+	}
+	catch(timeout_error &) { 
+		if (ec)
+			*ec = lsl_timeout_error; 
+	}
+	catch(lost_error &) { 
+		if (ec)
+			*ec = lsl_lost_error; 
+	}
+	catch(std::invalid_argument &) { 
+		if (ec)
+			*ec = lsl_argument_error; 
+	}
+	catch(std::range_error &) {
+		if (ec)
+			*ec = lsl_argument_error; 
+	}
+	catch(std::exception &) { 
+		if (ec)
+			*ec = lsl_internal_error; 
+	}
+	return 0;
+}
+
 /**
 * Query the number of samples that are currently available for immediate pickup.
 */
@@ -795,6 +1062,34 @@ LIBLSL_C_API unsigned lsl_was_clock_reset(lsl_inlet in) {
 	}
 }
 
+/**
+* Query the number of samples that were dropped since the inlet was created.
+*/
+LIBLSL_C_API unsigned lsl_samples_dropped(lsl_inlet in) {
+	try {
+		return (unsigned)((stream_inlet_impl*)in)->samples_dropped();
+	}
+	catch(std::exception &) {
+		return 0;
+	}
+}
+
+/**
+* Request the data feed of the inlet as unacknowledged datagrams.
+*/
+LIBLSL_C_API int lsl_set_datagram_data(lsl_inlet in, int redundancy) {
+	try {
+		((stream_inlet_impl*)in)->set_datagram_data(redundancy);
+		return lsl_no_error;
+	}
+	catch(std::invalid_argument &) { 
+		return lsl_argument_error; 
+	}
+	catch(std::exception &) {
+		return lsl_internal_error;
+	}
+}
+
 /**
 * Override the half-time (forget factor) of the time-stamp smoothing.
 */
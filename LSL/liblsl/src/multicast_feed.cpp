@@ -0,0 +1,359 @@
+#include "multicast_feed.h"
+#include "api_config.h"
+#include "sample.h"
+#include <cstring>
+#include <boost/bind.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+
+
+// === implementation of the multicast_feed_sender and multicast_feed_receiver classes ===
+
+using namespace lsl;
+using namespace boost::asio;
+using boost::asio::ip::udp;
+
+namespace {
+	/// The size of the datagram header.
+	const std::size_t header_bytes = 16;
+
+	/// The maximum size of a datagram (small enough to not be fragmented on common networks).
+	const std::size_t max_datagram_bytes = 1200;
+
+	/// The maximum number of samples that are sent as a single chunk.
+	const std::size_t max_block_samples = 1024;
+
+	/// The maximum number of bytes of channel data that are sent as a single chunk (a chunk can have at most 0xFFFF fragments).
+	const std::size_t max_block_bytes = 1024*1024;
+
+	/// The number of recently sent datagrams that are kept for retransmission.
+	const std::size_t history_size = 8192;
+
+	/// The maximum number of datagrams that the receiver holds while waiting for a missing one.
+	const std::size_t max_pending = 65536;
+
+	/// Time that the receiver waits for a missing datagram (which might merely be delayed) before requesting it, in seconds.
+	const double retransmit_delay = 0.01;
+
+	/// Interval at which the receiver repeats its request for a missing datagram, in seconds.
+	const double retransmit_interval = 0.1;
+
+	/// Time after which the receiver gives up on a missing datagram and skips to the next complete chunk, in seconds.
+	const double gap_timeout = 1.0;
+
+	/// Maximum time that the receiver waits for a datagram before re-checking its state, in seconds.
+	const double max_wait = 0.1;
+
+	/// Little-endian coding of the header fields.
+	template<class T> void put_le(char *p, T value) {
+		for (std::size_t b=0; b<sizeof(T); b++)
+			p[b] = (char)((value >> (8*b)) & 0xFF);
+	}
+	template<class T> T get_le(const char *p) {
+		T value = 0;
+		for (std::size_t b=0; b<sizeof(T); b++)
+			value |= (T)(unsigned char)p[b] << (8*b);
+		return value;
+	}
+}
+
+
+// === sender ===
+
+/**
+* Create a sender for the data of a send buffer.
+* @param strand The strand of the TCP server (all operations of the sender run on it).
+* @param sendbuf The send buffer of the outlet.
+* @param port The port to which the datagrams are sent (the port of the TCP server).
+* @param chunk_size The preferred chunk size of the outlet, in samples (if 0, the pushthrough flags of the samples determine the chunking).
+* @throws std::exception if the socket could not be set up.
+*/
+multicast_feed_sender::multicast_feed_sender(const io_service::strand &strand, const send_buffer_p &sendbuf, int port, int chunk_size): strand_(strand), send_buffer_(sendbuf), socket_(strand_.get_io_service()),
+	group_(ip::address::from_string(api_config::get_instance()->multicast_data_address()),(unsigned short)port), chunk_size_(chunk_size), users_(0), running_(false), next_seq_(0), seqn_(0)
+{
+	if (!group_.address().is_v4() || !group_.address().is_multicast())
+		throw std::runtime_error("The multicast data address must be an IPv4 multicast address.");
+	boost::uuids::uuid tag = boost::uuids::random_generator()();
+	memcpy(&id_,tag.data,sizeof(id_));
+	socket_.open(udp::v4());
+	socket_.set_option(ip::multicast::hops(api_config::get_instance()->multicast_ttl()));
+	socket_.set_option(ip::multicast::enable_loopback(true));
+	if (!api_config::get_instance()->listen_address().empty())
+		socket_.set_option(ip::multicast::outbound_interface(ip::address_v4::from_string(api_config::get_instance()->listen_address())));
+}
+
+/// Attach a session to the feed (starts sending if it was idle; must be called from the IO thread).
+void multicast_feed_sender::attach() {
+	users_++;
+	if (!running_) {
+		running_ = true;
+		queue_ = send_buffer_->new_consumer();
+		transfer_samples();
+	}
+}
+
+/// Detach a session from the feed (may be called from any thread; the feed ends once no session is attached).
+void multicast_feed_sender::detach() {
+	if (--users_ == 0)
+		strand_.post(boost::bind(&multicast_feed_sender::handle_detach,shared_from_this()));
+}
+
+/// Handler that ends the feed if no session is attached anymore.
+void multicast_feed_sender::handle_detach() {
+	if (users_ == 0)
+		stop();
+}
+
+/// Send some recent datagrams again (must be called from the strand).
+void multicast_feed_sender::retransmit(boost::uint64_t first, boost::uint64_t count) {
+	boost::uint64_t oldest = next_seq_ - history_.size();
+	for (boost::uint64_t seq=std::max(first,oldest), end=std::min(first+std::min(count,(boost::uint64_t)history_size),next_seq_); seq<end; seq++) {
+		boost::system::error_code ec;
+		const std::vector<char> &dgram = history_[(std::size_t)(seq-oldest)];
+		socket_.send_to(buffer(dgram),group_,0,ec);
+	}
+}
+
+/// Collect the samples from the consumer queue into chunks and send them (or arrange to be called again when the next sample is pushed).
+void multicast_feed_sender::transfer_samples() {
+	try {
+		if (!running_)
+			return;
+		sample_p samp;
+		while (users_ > 0) {
+			// get the next sample: either the continuation of the current chunk or the next entry of the sample queue
+			if (pending_) {
+				samp.swap(pending_);
+			} else if (!queue_->try_pop(samp)) {
+				// nothing there: have the queue notify us when the next sample comes in (unless one arrived in the meantime)
+				// (the notification keeps us alive; it is dropped with the queue when the feed stops)
+				if (queue_->arm_notify(boost::bind(&multicast_feed_sender::notify_transfer,shared_from_this())))
+					return;
+				continue;
+			}
+			// ignore blank samples (wakeup notifiers)
+			if (!samp)
+				continue;
+			pending_ = samp->next_in_chunk();
+			bool pushthrough = chunk_size_ ? ((++seqn_)%(unsigned)chunk_size_) == 0 : samp->pushthrough;
+			block_.push_back(samp);
+			if (pushthrough || block_.size() >= max_block_samples || (block_.size()+1)*samp->datasize() > max_block_bytes)
+				send_block();
+		}
+		stop();
+	} catch(std::exception &e) {
+		std::cerr << "Unexpected error in the multicast data feed: " << e.what() << "; ending the feed..." << std::endl;
+		stop();
+	}
+}
+
+/// Callback of the consumer queue when a new sample has been pushed; schedules transfer_samples() on the strand.
+void multicast_feed_sender::notify_transfer() {
+	strand_.post(boost::bind(&multicast_feed_sender::transfer_samples,shared_from_this()));
+}
+
+/// Send the collected block as a chunk.
+void multicast_feed_sender::send_block() {
+	message_.clear();
+	vector_sink sink = {message_};
+	sample::save_chunk_streambuf(sink,&block_[0],block_.size(),BOOST_BYTE_ORDER,coded_);
+	block_.clear();
+	std::size_t payload = max_datagram_bytes - header_bytes, count = (message_.size()+payload-1)/payload;
+	if (count > 0xFFFF) {
+		// (blocks are bounded by max_block_bytes, so this can only be a single huge sample)
+		std::cerr << "A sample is too large for the multicast data feed; it has been skipped." << std::endl;
+		return;
+	}
+	for (std::size_t k=0; k<count; k++)
+		send_datagram((boost::uint16_t)k,(boost::uint16_t)count,&message_[k*payload],std::min(payload,message_.size()-k*payload));
+}
+
+/// Send a datagram and keep it for retransmission.
+void multicast_feed_sender::send_datagram(boost::uint16_t fragment_index, boost::uint16_t fragment_count, const char *data, std::size_t size) {
+	// recycle the oldest datagram of the history
+	std::vector<char> dgram;
+	if (history_.size() >= history_size) {
+		dgram.swap(history_.front());
+		history_.pop_front();
+	}
+	dgram.resize(header_bytes+size);
+	put_le(&dgram[0],id_);
+	put_le(&dgram[4],next_seq_);
+	put_le(&dgram[12],fragment_index);
+	put_le(&dgram[14],fragment_count);
+	if (size)
+		memcpy(&dgram[header_bytes],data,size);
+	// (datagrams that cannot be sent right now are recovered by the receivers like lost ones)
+	boost::system::error_code ec;
+	socket_.send_to(buffer(dgram),group_,0,ec);
+	history_.push_back(std::vector<char>());
+	history_.back().swap(dgram);
+	next_seq_++;
+}
+
+/// Announce the end of the feed and release the consumer queue.
+void multicast_feed_sender::stop() {
+	if (!running_)
+		return;
+	running_ = false;
+	send_datagram(0,0,NULL,0);
+	queue_.reset();
+	pending_.reset();
+	block_.clear();
+}
+
+
+// === receiver ===
+
+/**
+* Join the multicast group of a feed.
+* @param address The group address of the feed.
+* @param port The port of the feed.
+* @param id The stream ID that tags the datagrams of the feed.
+* @param requests The TCP connection of the feed, over which missing datagrams are requested.
+* @throws std::exception if the group could not be joined.
+*/
+multicast_feed_receiver::multicast_feed_receiver(const std::string &address, int port, boost::uint32_t id, std::ostream &requests): id_(id), requests_(requests),
+	datagram_(max_datagram_bytes), synchronized_(false), next_seq_(0), gap_since_(0), last_request_(0), message_pos_(0), ended_(false), cancelled_(false)
+{
+	ip::address group(ip::address::from_string(address));
+	if (!group.is_v4() || !group.is_multicast())
+		throw std::runtime_error("Invalid multicast data address: " + address);
+	std::string listen_address = api_config::get_instance()->listen_address();
+	ip::address_v4 iface = listen_address.empty() ? ip::address_v4::any() : ip::address_v4::from_string(listen_address);
+	udp::socket &sock = socket_.socket();
+	sock.open(udp::v4());
+	sock.set_option(udp::socket::reuse_address(true));
+	sock.bind(udp::endpoint(ip::address_v4::any(),(unsigned short)port));
+	sock.set_option(ip::multicast::join_group(group.to_v4(),iface));
+}
+
+/// Destructor. Leaves the group.
+multicast_feed_receiver::~multicast_feed_receiver() {
+	unregister_from_all();
+}
+
+/// Read data of the feed, waiting until it is available; returns fewer bytes only if the feed has ended or the read was cancelled.
+std::streamsize multicast_feed_receiver::sgetn(char *data, std::streamsize n) {
+	std::streamsize done = 0;
+	while (done < n) {
+		if (message_pos_ < message_.size()) {
+			std::size_t count = std::min(message_.size()-message_pos_,(std::size_t)(n-done));
+			memcpy(data+done,&message_[message_pos_],count);
+			message_pos_ += count;
+			done += count;
+		} else if (!next_message())
+			break;
+	}
+	return done;
+}
+
+/// Cancel any blocking read (and all future reads).
+void multicast_feed_receiver::cancel() {
+	cancelled_ = true;
+	socket_.cancel();
+}
+
+/// Wait for the next chunk and make it the current message; returns false if the feed has ended or the read was cancelled.
+bool multicast_feed_receiver::next_message() {
+	while (!cancelled_ && !ended_) {
+		if (assemble_message())
+			return true;
+		// deal with a gap in the sequence, if any, and wait for the next datagram
+		double now = lsl_clock();
+		handle_gap(now);
+		udp::endpoint sender;
+		if (std::size_t len = socket_.receive(&datagram_[0],datagram_.size(),sender,gap_since_ ? retransmit_delay : max_wait)) {
+			if (len < header_bytes || get_le<boost::uint32_t>(&datagram_[0]) != id_)
+				continue;
+			boost::uint64_t seq = get_le<boost::uint64_t>(&datagram_[4]);
+			boost::uint16_t index = get_le<boost::uint16_t>(&datagram_[12]), count = get_le<boost::uint16_t>(&datagram_[14]);
+			if (count && index >= count)
+				continue;
+			if (!synchronized_) {
+				// start with the first chunk that begins at or after this datagram
+				next_seq_ = count ? seq + (index ? count-index : 0) : seq;
+				synchronized_ = true;
+			}
+			if (seq < next_seq_ || pending_.count(seq))
+				continue;
+			pending_[seq].assign(datagram_.begin(),datagram_.begin()+len);
+		}
+	}
+	return false;
+}
+
+/// Move the next chunk out of the received datagrams if it is complete.
+bool multicast_feed_receiver::assemble_message() {
+	std::map<boost::uint64_t,std::vector<char> >::iterator first = pending_.begin();
+	if (first == pending_.end() || first->first != next_seq_)
+		return false;
+	boost::uint16_t count = get_le<boost::uint16_t>(&first->second[14]);
+	if (!count) {
+		// end of the feed
+		ended_ = true;
+		return false;
+	}
+	if (get_le<boost::uint16_t>(&first->second[12]) != 0) {
+		// a fragment without the beginning of its chunk (after we skipped a gap): drop it
+		pending_.erase(first);
+		next_seq_++;
+		return assemble_message();
+	}
+	// check that all fragments of the chunk are there
+	std::map<boost::uint64_t,std::vector<char> >::iterator last = first;
+	for (boost::uint16_t k=1; k<count; k++)
+		if (++last == pending_.end() || last->first != next_seq_+k)
+			return false;
+	// concatenate them
+	message_.clear();
+	message_pos_ = 0;
+	for (++last; first != last; pending_.erase(first++))
+		message_.insert(message_.end(),first->second.begin()+header_bytes,first->second.end());
+	next_seq_ += count;
+	gap_since_ = 0;
+	return true;
+}
+
+/// Request missing datagrams, or skip them if they are overdue.
+void multicast_feed_receiver::handle_gap(double now) {
+	// we only get here if the next chunk is incomplete, i.e., something is missing if we hold any datagrams
+	if (pending_.empty()) {
+		gap_since_ = 0;
+		return;
+	}
+	if (!gap_since_) {
+		gap_since_ = now;
+		last_request_ = 0;
+	}
+	if (now > gap_since_+gap_timeout || pending_.size() > max_pending) {
+		// give up on the missing datagrams: continue with the next chunk that we have the beginning of
+		std::cerr << "Datagrams of the multicast data feed could not be recovered; some samples were lost." << std::endl;
+		if (pending_.begin()->first == next_seq_)
+			pending_.erase(pending_.begin());
+		while (!pending_.empty() && get_le<boost::uint16_t>(&pending_.begin()->second[12]) != 0)
+			pending_.erase(pending_.begin());
+		if (pending_.empty())
+			synchronized_ = false;
+		else
+			next_seq_ = pending_.begin()->first;
+		gap_since_ = 0;
+		return;
+	}
+	if (now < gap_since_+retransmit_delay || now < last_request_+retransmit_interval)
+		return;
+	// request the missing ranges of sequence numbers (including the rest of the last chunk, if incomplete)
+	boost::uint64_t expected = next_seq_;
+	for (std::map<boost::uint64_t,std::vector<char> >::iterator i=pending_.begin(); i!=pending_.end(); expected = (i++)->first+1)
+		if (i->first > expected)
+			requests_ << "Retransmit: " << expected << " " << (i->first-expected) << "\r\n";
+	const std::vector<char> &last = pending_.rbegin()->second;
+	boost::uint16_t index = get_le<boost::uint16_t>(&last[12]), count = get_le<boost::uint16_t>(&last[14]);
+	if (index+1 < count)
+		requests_ << "Retransmit: " << expected << " " << (count-index-1) << "\r\n";
+	requests_ << std::flush;
+	// (if the connection is gone, so is the outlet)
+	if (!requests_)
+		ended_ = true;
+	last_request_ = now;
+}
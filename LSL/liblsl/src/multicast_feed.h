@@ -0,0 +1,158 @@
+#ifndef MULTICAST_FEED_H
+#define MULTICAST_FEED_H
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <iostream>
+#include <boost/asio.hpp>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include "cancellation.h"
+#include "datagram_socket.h"
+#include "send_buffer.h"
+
+
+namespace lsl {
+
+	/// shared pointer to a multicast feed sender
+	typedef boost::shared_ptr<class multicast_feed_sender> multicast_feed_sender_p;
+
+	/**
+	* Sends the data feed of an outlet once to a multicast group, for all inlets that asked for multicast data transport
+	* ("Multicast-Data: 1" in the feed negotiation), so that the outlet's bandwidth and CPU load do not grow with the number of inlets.
+	* The samples are collected into chunks (protocol 1.20, in the outlet's native byte order), which are split into
+	* sequence-numbered datagrams. The most recent datagrams are kept so that they can be sent again when an inlet
+	* reports a gap over its TCP connection ("Retransmit: <first sequence number> <count>").
+	*
+	* Datagram layout (multi-byte quantities are little endian):
+	*   [uint32: stream ID][uint64: sequence number][uint16: fragment index][uint16: fragment count][fragment of a chunk]
+	* A datagram with a fragment count of 0 announces the end of the feed.
+	*
+	* The sender is shared by the multicast sessions of a TCP server (and runs on its strand); it starts sending
+	* when the first session attaches and stops once the last one has detached.
+	*/
+	class multicast_feed_sender: public boost::enable_shared_from_this<multicast_feed_sender>, private boost::noncopyable {
+	public:
+		/**
+		* Create a sender for the data of a send buffer.
+		* @param strand The strand of the TCP server (all operations of the sender run on it).
+		* @param sendbuf The send buffer of the outlet.
+		* @param port The port to which the datagrams are sent (the port of the TCP server).
+		* @param chunk_size The preferred chunk size of the outlet, in samples (if 0, the pushthrough flags of the samples determine the chunking).
+		* @throws std::exception if the socket could not be set up.
+		*/
+		multicast_feed_sender(const boost::asio::io_service::strand &strand, const send_buffer_p &sendbuf, int port, int chunk_size);
+
+		/// The group address of the feed.
+		std::string address() const { return group_.address().to_string(); }
+
+		/// The port of the feed.
+		int port() const { return group_.port(); }
+
+		/// The random ID that tags the datagrams of the feed.
+		boost::uint32_t id() const { return id_; }
+
+		/// Attach a session to the feed (starts sending if it was idle; must be called from the IO thread).
+		void attach();
+
+		/// Detach a session from the feed (may be called from any thread; the feed ends once no session is attached).
+		void detach();
+
+		/// Send some recent datagrams again (must be called from the strand).
+		void retransmit(boost::uint64_t first, boost::uint64_t count);
+
+	private:
+		/// Collect the samples from the consumer queue into chunks and send them (or arrange to be called again when the next sample is pushed).
+		void transfer_samples();
+
+		/// Callback of the consumer queue when a new sample has been pushed; schedules transfer_samples() on the strand.
+		void notify_transfer();
+
+		/// Handler that ends the feed if no session is attached anymore.
+		void handle_detach();
+
+		/// Send the collected block as a chunk.
+		void send_block();
+
+		/// Send a datagram and keep it for retransmission.
+		void send_datagram(boost::uint16_t fragment_index, boost::uint16_t fragment_count, const char *data, std::size_t size);
+
+		/// Announce the end of the feed and release the consumer queue.
+		void stop();
+
+		boost::asio::io_service::strand strand_;	// the strand on which we run
+		send_buffer_p send_buffer_;					// the send buffer from which we take the samples
+		boost::asio::ip::udp::socket socket_;		// the socket through which we send
+		boost::asio::ip::udp::endpoint group_;		// the multicast group and port
+		boost::uint32_t id_;						// the ID that tags our datagrams
+		int chunk_size_;							// the preferred chunk size (or 0)
+		boost::atomic<int> users_;					// the number of attached sessions
+		bool running_;								// whether the transfer chain is active
+		consumer_queue_p queue_;					// the queue from which we receive the samples (while running)
+		sample_p pending_;							// the remainder of a partially collected chunk, if any
+		std::vector<sample_p> block_;				// the samples that are waiting to be sent as the next chunk
+		std::vector<char> message_;					// scratchpad memory for the serialized chunk
+		std::vector<char> coded_;					// scratchpad memory for the byte-order conversion
+		boost::uint64_t next_seq_;					// the sequence number of the next datagram
+		std::deque<std::vector<char> > history_;	// the most recently sent datagrams (the last has sequence number next_seq_-1)
+		unsigned seqn_;								// the number of collected samples (merely used to determine chunk boundaries)
+	};
+
+
+	/**
+	* Receives the data feed of an outlet from a multicast group (see multicast_feed_sender) and reassembles it into a stream of
+	* chunks, which can be read like a stream buffer. Missing datagrams are requested again over the TCP connection of the feed;
+	* if they cannot be recovered in time the receiver skips ahead to the next complete chunk (i.e., the samples in between are lost).
+	*/
+	class multicast_feed_receiver: public cancellable_obj, private boost::noncopyable {
+	public:
+		/**
+		* Join the multicast group of a feed.
+		* @param address The group address of the feed.
+		* @param port The port of the feed.
+		* @param id The stream ID that tags the datagrams of the feed.
+		* @param requests The TCP connection of the feed, over which missing datagrams are requested.
+		* @throws std::exception if the group could not be joined.
+		*/
+		multicast_feed_receiver(const std::string &address, int port, boost::uint32_t id, std::ostream &requests);
+
+		/// Destructor. Leaves the group.
+		~multicast_feed_receiver();
+
+		/// Read data of the feed, waiting until it is available; returns fewer bytes only if the feed has ended or the read was cancelled.
+		std::streamsize sgetn(char *data, std::streamsize n);
+
+		/// Cancel any blocking read (and all future reads).
+		virtual void cancel();
+
+	private:
+		/// Wait for the next chunk and make it the current message; returns false if the feed has ended or the read was cancelled.
+		bool next_message();
+
+		/// Move the next chunk out of the received datagrams if it is complete.
+		bool assemble_message();
+
+		/// Request missing datagrams, or skip them if they are overdue.
+		void handle_gap(double now);
+
+		datagram_socket socket_;						// the socket that has joined the group
+		boost::uint32_t id_;							// the stream ID of the feed
+		std::ostream &requests_;						// the TCP connection over which we request retransmissions
+		std::vector<char> datagram_;					// the buffer of a received datagram
+		std::map<boost::uint64_t,std::vector<char> > pending_;	// datagrams that were received but not yet assembled, by sequence number
+		bool synchronized_;								// whether we know the sequence number of the next chunk
+		boost::uint64_t next_seq_;						// the sequence number of the first datagram of the next chunk
+		double gap_since_;								// the time since which next_seq_ is missing (0 if not missing)
+		double last_request_;							// the time of the last retransmission request for the current gap
+		std::vector<char> message_;						// the current chunk
+		std::size_t message_pos_;						// the read position in the current chunk
+		bool ended_;									// whether the feed has ended
+		boost::atomic<bool> cancelled_;					// whether reads have been cancelled
+	};
+
+}
+
+#endif
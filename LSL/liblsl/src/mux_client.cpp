@@ -0,0 +1,310 @@
+#include <iostream>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/thread/once.hpp>
+#include "mux_client.h"
+#include "api_config.h"
+#include "endian/conversion.hpp"
+
+
+// === implementation of the mux_client class ===
+
+using namespace lsl;
+using namespace boost::asio;
+using namespace boost::algorithm;
+
+namespace {
+	/// The frame size that confirms a subscription.
+	const boost::uint32_t subscribed_marker = 0xFFFFFFFF;
+
+	/// The frame size that announces the end of a stream.
+	const boost::uint32_t ended_marker = 0;
+
+	/// The maximum size of a frame: a chunk of up to 1024 samples (with explicit time stamps) and up to max_block_bytes of channel data.
+	const boost::uint32_t max_frame_bytes = 2*sizeof(boost::uint32_t) + sizeof(double) + 1024*(sizeof(boost::uint32_t)+sizeof(double)) + mux_client::max_block_bytes;
+
+	/// The connections of this process, by server endpoint (created once; protected by clients_mut).
+	boost::once_flag clients_once = BOOST_ONCE_INIT;
+	boost::mutex *clients_mut = NULL;
+	std::map<tcp::endpoint,boost::weak_ptr<mux_client> > *clients = NULL;
+
+	/// Create the connection table (called once).
+	void create_clients() {
+		clients_mut = new boost::mutex();
+		clients = new std::map<tcp::endpoint,boost::weak_ptr<mux_client> >();
+	}
+
+	/// Run an IO service until it runs out of work (continuing after errors in handlers).
+	void run_io(io_service *io) {
+		while (true) {
+			try {
+				io->run();
+				return;
+			} catch(std::exception &e) {
+				std::cerr << "Error during io_service processing of a multiplexed connection: " << e.what() << std::endl;
+			}
+		}
+	}
+}
+
+/**
+* Get the connection to the server at the given endpoint, connecting if necessary.
+* @param endpoint The endpoint of the server.
+* @param timeout The maximum time to wait for the connection to be established, in seconds.
+* @throws std::exception if the connection could not be established.
+*/
+mux_client_p mux_client::connect(const tcp::endpoint &endpoint, double timeout) {
+	mux_client_p result = connect_async(endpoint,timeout);
+	if (!result->wait_until_connected())
+		throw std::runtime_error("Could not establish a multiplexed connection to " + boost::lexical_cast<std::string>(endpoint) + ".");
+	return result;
+}
+
+/**
+* Get the connection to the server at the given endpoint, starting to connect if necessary, without waiting for the connection 
+* to be established (see arm_connected()).
+* @param endpoint The endpoint of the server.
+* @param timeout The maximum time that the connection may take to be established, in seconds.
+*/
+mux_client_p mux_client::connect_async(const tcp::endpoint &endpoint, double timeout) {
+	boost::call_once(&create_clients,clients_once);
+	boost::lock_guard<boost::mutex> lock(*clients_mut);
+	if (mux_client_p existing = (*clients)[endpoint].lock()) {
+		boost::lock_guard<boost::mutex> state_lock(existing->state_mut_);
+		if (!existing->closed_)
+			return existing;
+	}
+	// (the attempt runs in the background, so other inlets that ask in the meantime share it)
+	mux_client_p result(new mux_client(endpoint,timeout));
+	(*clients)[endpoint] = result;
+	return result;
+}
+
+/// Start connecting to a server (see connect()).
+mux_client::mux_client(const tcp::endpoint &endpoint, double timeout): sock_(io_), timer_(io_), byte_order_(BOOST_BYTE_ORDER), connected_(false), closed_(false), next_id_(1) {
+	sock_.async_connect(endpoint,boost::bind(&mux_client::handle_connect_outcome,this,placeholders::error));
+	timer_.expires_from_now(boost::posix_time::microseconds((boost::int64_t)(timeout*1000000)));
+	timer_.async_wait(boost::bind(&mux_client::handle_connect_timeout,this,placeholders::error));
+	io_thread_ = boost::thread(boost::bind(&run_io,&io_));
+}
+
+/// Destructor. Closes the connection.
+mux_client::~mux_client() {
+	io_.post(boost::bind(&mux_client::close,this));
+	io_thread_.join();
+}
+
+/**
+* Arm a one-shot callback that is invoked once the connection has been established or the attempt has failed.
+* @return True if the callback has been armed, or false if the outcome of the attempt is known already.
+*/
+bool mux_client::arm_connected(const boost::function<void()> &callback) {
+	boost::lock_guard<boost::mutex> lock(state_mut_);
+	if (connected_ || closed_)
+		return false;
+	connected_callbacks_.push_back(callback);
+	return true;
+}
+
+/// Invoke the callbacks that wait for the outcome of the connection attempt (runs on the IO thread).
+void mux_client::notify_connected() {
+	std::vector<boost::function<void()> > callbacks;
+	{
+		boost::lock_guard<boost::mutex> lock(state_mut_);
+		callbacks.swap(connected_callbacks_);
+	}
+	// invoke them outside the lock
+	for (std::size_t k=0; k<callbacks.size(); k++)
+		callbacks[k]();
+}
+
+/// Wait until the connection has either been established or failed; returns whether it has been established.
+bool mux_client::wait_until_connected() {
+	boost::unique_lock<boost::mutex> lock(state_mut_);
+	while (!connected_ && !closed_)
+		state_upd_.wait(lock);
+	return !closed_;
+}
+
+/**
+* Subscribe to a stream of the server's process.
+* @param uid The UID of the stream.
+* @param max_buffered The maximum amount of data that the server shall buffer for us.
+* @param max_chunklen The maximum chunk size to transmit (0 for the chunk size of the outlet).
+* @param chan The channel that receives the stream (must stay alive until it is unsubscribed).
+* @return The ID of the subscription.
+*/
+boost::uint32_t mux_client::subscribe(const std::string &uid, int max_buffered, int max_chunklen, channel *chan) {
+	boost::lock_guard<boost::mutex> lock(channels_mut_);
+	boost::uint32_t id = next_id_++;
+	bool closed;
+	{
+		boost::lock_guard<boost::mutex> state_lock(state_mut_);
+		closed = closed_;
+	}
+	if (closed) {
+		// the connection is gone already, and so is the stream as far as this subscription is concerned
+		chan->ended();
+		return id;
+	}
+	channels_[id] = chan;
+	io_.post(boost::bind(&mux_client::send_command,this,"Subscribe: " + boost::lexical_cast<std::string>(id) + " " + uid + " " +
+		boost::lexical_cast<std::string>(max_buffered) + " " + boost::lexical_cast<std::string>(max_chunklen) + "\r\n"));
+	return id;
+}
+
+/// Cancel a subscription; once this returns, the channel is no longer called.
+void mux_client::unsubscribe(boost::uint32_t id) {
+	boost::lock_guard<boost::mutex> lock(channels_mut_);
+	if (channels_.erase(id))
+		io_.post(boost::bind(&mux_client::send_command,this,"Unsubscribe: " + boost::lexical_cast<std::string>(id) + "\r\n"));
+}
+
+/// Handler that gets called when the connection has been established (or failed).
+void mux_client::handle_connect_outcome(error_code err) {
+	if (err) {
+		close();
+		return;
+	}
+	error_code ec;
+	sock_.set_option(tcp::no_delay(true),ec);
+	// request line LSL:muxfeed/[ProtocolVersion]\r\n followed by an empty line
+	send_command("LSL:muxfeed/" + boost::lexical_cast<std::string>(api_config::get_instance()->use_protocol_version()) + "\r\n\r\n");
+	async_read_until(sock_,responsebuf_,"\r\n\r\n",boost::bind(&mux_client::handle_read_response_outcome,this,placeholders::error));
+}
+
+/// Handler that gets called when the connection attempt has timed out.
+void mux_client::handle_connect_timeout(error_code err) {
+	if (err != error::operation_aborted && !connected_)
+		close();
+}
+
+/// Handler that gets called when the response of the server has been read.
+void mux_client::handle_read_response_outcome(error_code err) {
+	try {
+		if (err) {
+			close();
+			return;
+		}
+		// check the response line (LSL/[Version] [StatusCode] [Message])
+		std::istream response(&responsebuf_);
+		std::string line;
+		getline(response,line);
+		std::vector<std::string> parts; split(parts,line,is_any_of(" \t"),token_compress_on);
+		if (parts.size() < 3 || !starts_with(parts[0],"LSL/") || boost::lexical_cast<int>(parts[1]) != 200)
+			throw std::runtime_error("The server refused the connection: " + trim_copy(line));
+		// receive the response parameters
+		while (getline(response,line) && !trim_copy(line).empty()) {
+			std::string::size_type colon = line.find_first_of(":");
+			if (colon != std::string::npos && to_lower_copy(trim_copy(line.substr(0,colon))) == "byte-order")
+				byte_order_ = boost::lexical_cast<int>(trim_copy(line.substr(colon+1)));
+		}
+		error_code ec;
+		timer_.cancel(ec);
+		{
+			boost::lock_guard<boost::mutex> lock(state_mut_);
+			connected_ = true;
+		}
+		state_upd_.notify_all();
+		notify_connected();
+		read_next_frame();
+	} catch(std::exception &e) {
+		std::cerr << "Could not establish a multiplexed connection (" << e.what() << ")." << std::endl;
+		close();
+	}
+}
+
+/// Read the header of the next frame.
+void mux_client::read_next_frame() {
+	async_read(sock_,buffer(header_,sizeof(header_)),boost::bind(&mux_client::handle_read_header_outcome,this,placeholders::error));
+}
+
+/// Handler that gets called when the header of a frame has been read.
+void mux_client::handle_read_header_outcome(error_code err) {
+	if (err) {
+		close();
+		return;
+	}
+	boost::uint32_t id = header_field(0), size = header_field(1);
+	if (size == subscribed_marker || size == ended_marker) {
+		boost::lock_guard<boost::mutex> lock(channels_mut_);
+		channel_map::iterator chan = channels_.find(id);
+		if (chan != channels_.end()) {
+			if (size == subscribed_marker)
+				chan->second->subscribed();
+			else {
+				chan->second->ended();
+				channels_.erase(chan);
+			}
+		}
+		read_next_frame();
+	} else if (size > max_frame_bytes) {
+		// (the server never sends such a frame, so the connection is corrupted)
+		std::cerr << "Received an invalid frame size (" << size << " bytes) over a multiplexed connection; closing it." << std::endl;
+		close();
+	} else {
+		payload_.resize(size);
+		async_read(sock_,buffer(payload_),boost::bind(&mux_client::handle_read_payload_outcome,this,placeholders::error));
+	}
+}
+
+/// Handler that gets called when the payload of a frame has been read.
+void mux_client::handle_read_payload_outcome(error_code err) {
+	if (err) {
+		close();
+		return;
+	}
+	{
+		boost::lock_guard<boost::mutex> lock(channels_mut_);
+		channel_map::iterator chan = channels_.find(header_field(0));
+		if (chan != channels_.end())
+			chan->second->receive_chunk(&payload_[0],payload_.size(),byte_order_);
+	}
+	read_next_frame();
+}
+
+/// Queue a command for sending (runs on the IO thread).
+void mux_client::send_command(const std::string &command) {
+	commands_.push_back(command);
+	if (commands_.size() == 1)
+		async_write(sock_,buffer(commands_.front()),boost::bind(&mux_client::handle_send_command_outcome,this,placeholders::error));
+}
+
+/// Handler that gets called when a command has been sent.
+void mux_client::handle_send_command_outcome(error_code err) {
+	commands_.pop_front();
+	if (err) {
+		commands_.clear();
+		close();
+		return;
+	}
+	if (!commands_.empty())
+		async_write(sock_,buffer(commands_.front()),boost::bind(&mux_client::handle_send_command_outcome,this,placeholders::error));
+}
+
+/// End the connection (runs on the IO thread); all channels are told that their streams have ended.
+void mux_client::close() {
+	{
+		boost::lock_guard<boost::mutex> lock(state_mut_);
+		closed_ = true;
+	}
+	state_upd_.notify_all();
+	notify_connected();
+	error_code ec;
+	timer_.cancel(ec);
+	sock_.close(ec);
+	boost::lock_guard<boost::mutex> lock(channels_mut_);
+	for (channel_map::iterator chan=channels_.begin(); chan!=channels_.end(); chan++)
+		chan->second->ended();
+	channels_.clear();
+}
+
+/// Read a header field of the current frame.
+boost::uint32_t mux_client::header_field(int index) {
+	boost::uint32_t value;
+	memcpy(&value,&header_[index*sizeof(value)],sizeof(value));
+	if (byte_order_ != BOOST_BYTE_ORDER)
+		lslboost::endian::reverse(value);
+	return value;
+}
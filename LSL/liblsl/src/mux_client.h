@@ -0,0 +1,158 @@
+#ifndef MUX_CLIENT_H
+#define MUX_CLIENT_H
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/function.hpp>
+#include "common.h"
+
+
+using boost::asio::ip::tcp;
+using boost::system::error_code;
+
+namespace lsl {
+
+	/// shared pointer to a multiplexed connection
+	typedef boost::shared_ptr<class mux_client> mux_client_p;
+
+	/**
+	* A multiplexed connection to the mux_server of another process, shared by all inlets of this process that read from outlets
+	* of that process (see mux_server for the protocol). The connection has its own IO thread, which receives the frames and hands
+	* them to the channels that subscribed to the respective streams.
+	*/
+	class mux_client: private boost::noncopyable {
+	public:
+		/// The receiving end of a subscription (its functions are called from the IO thread of the connection).
+		class channel {
+		public:
+			virtual ~channel() { }
+			/// The server has accepted the subscription.
+			virtual void subscribed() = 0;
+			/// A chunk of the stream has arrived (protocol 1.20, in the given byte order).
+			virtual void receive_chunk(const char *data, std::size_t size, int byte_order) = 0;
+			/// The stream has ended (or the connection has been lost); no further calls follow.
+			virtual void ended() = 0;
+		};
+
+		/**
+		* Get the connection to the server at the given endpoint, connecting if necessary.
+		* @param endpoint The endpoint of the server.
+		* @param timeout The maximum time to wait for the connection to be established, in seconds.
+		* @throws std::exception if the connection could not be established.
+		*/
+		static mux_client_p connect(const tcp::endpoint &endpoint, double timeout);
+
+		/**
+		* Get the connection to the server at the given endpoint, starting to connect if necessary, without waiting for the connection 
+		* to be established (for callers that must not block; see arm_connected()).
+		* @param endpoint The endpoint of the server.
+		* @param timeout The maximum time that the connection may take to be established, in seconds.
+		*/
+		static mux_client_p connect_async(const tcp::endpoint &endpoint, double timeout);
+
+		/// Destructor. Closes the connection.
+		~mux_client();
+
+		/// The byte order in which the server sends the data.
+		int byte_order() const { return byte_order_; }
+
+		/// Whether the connection has been established (and has not ended since).
+		bool is_connected() { boost::lock_guard<boost::mutex> lock(state_mut_); return connected_ && !closed_; }
+
+		/**
+		* Arm a one-shot callback that is invoked once the connection has been established or the attempt has failed (see is_connected()).
+		* The callback is invoked from the IO thread of the connection and should therefore only dispatch the actual work elsewhere.
+		* @param callback The function to invoke.
+		* @return True if the callback has been armed, or false if the outcome of the attempt is known already (in which case the 
+		*		  callback is not invoked).
+		*/
+		bool arm_connected(const boost::function<void()> &callback);
+
+		/// The maximum number of bytes of channel data in a frame (the server cuts its chunks accordingly).
+		enum { max_block_bytes = 1024*1024 };
+
+		/// Whether a stream with the given channel format and sample size can be received over a multiplexed connection.
+		static bool supports(channel_format_t fmt, std::size_t sample_bytes) { return fmt != cf_string && sample_bytes <= max_block_bytes; }
+
+		/**
+		* Subscribe to a stream of the server's process.
+		* @param uid The UID of the stream.
+		* @param max_buffered The maximum amount of data that the server shall buffer for us.
+		* @param max_chunklen The maximum chunk size to transmit (0 for the chunk size of the outlet).
+		* @param chan The channel that receives the stream (must stay alive until it is unsubscribed).
+		* @return The ID of the subscription.
+		*/
+		boost::uint32_t subscribe(const std::string &uid, int max_buffered, int max_chunklen, channel *chan);
+
+		/// Cancel a subscription; once this returns, the channel is no longer called.
+		void unsubscribe(boost::uint32_t id);
+
+	private:
+		/// Start connecting to a server (see connect()).
+		mux_client(const tcp::endpoint &endpoint, double timeout);
+
+		/// Invoke the callbacks that wait for the outcome of the connection attempt (runs on the IO thread).
+		void notify_connected();
+
+		/// Wait until the connection has either been established or failed; returns whether it has been established.
+		bool wait_until_connected();
+
+		/// Handler that gets called when the connection has been established (or failed).
+		void handle_connect_outcome(error_code err);
+
+		/// Handler that gets called when the connection attempt has timed out.
+		void handle_connect_timeout(error_code err);
+
+		/// Handler that gets called when the response of the server has been read.
+		void handle_read_response_outcome(error_code err);
+
+		/// Read the header of the next frame.
+		void read_next_frame();
+
+		/// Handler that gets called when the header of a frame has been read.
+		void handle_read_header_outcome(error_code err);
+
+		/// Handler that gets called when the payload of a frame has been read.
+		void handle_read_payload_outcome(error_code err);
+
+		/// Queue a command for sending (runs on the IO thread).
+		void send_command(const std::string &command);
+
+		/// Handler that gets called when a command has been sent.
+		void handle_send_command_outcome(error_code err);
+
+		/// End the connection (runs on the IO thread); all channels are told that their streams have ended.
+		void close();
+
+		/// Read a header field of the current frame.
+		boost::uint32_t header_field(int index);
+
+		typedef std::map<boost::uint32_t,channel*> channel_map;
+
+		boost::asio::io_service io_;			// the IO service of the connection
+		tcp::socket sock_;						// the connection socket
+		boost::asio::deadline_timer timer_;		// timer for the connection attempt
+		boost::asio::streambuf responsebuf_;	// the response of the server
+		char header_[8];						// the header of the current frame
+		std::vector<char> payload_;				// the payload of the current frame
+		std::deque<std::string> commands_;		// the commands that are waiting to be sent (IO thread only; the front one is being sent)
+		int byte_order_;						// the byte order of the server
+		bool connected_;						// whether the connection has been established
+		bool closed_;							// whether the connection has ended
+		boost::mutex state_mut_;				// mutex to protect the connection state (connected_ and closed_)
+		boost::condition_variable state_upd_;	// condition variable to indicate that the connection state has changed
+		std::vector<boost::function<void()> > connected_callbacks_;	// the callbacks that wait for the outcome of the connection attempt (protected by state_mut_)
+		channel_map channels_;					// the channels of the subscriptions, by ID
+		boost::uint32_t next_id_;				// the ID of the next subscription
+		boost::mutex channels_mut_;				// mutex to protect the channels (held while a channel is being called)
+		boost::thread io_thread_;				// the thread that runs the IO service
+	};
+
+}
+
+#endif
@@ -0,0 +1,351 @@
+#include <iostream>
+#include <boost/bind.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/thread/once.hpp>
+#include "mux_server.h"
+#include "mux_client.h"
+#include "outlet_registry.h"
+#include "socket_utils.h"
+#include "api_config.h"
+
+
+// === implementation of the mux_server class ===
+
+using namespace lsl;
+using namespace boost::asio;
+
+namespace {
+	/// The frame size that confirms a subscription.
+	const boost::uint32_t subscribed_marker = 0xFFFFFFFF;
+
+	/// The frame size that announces the end of a stream.
+	const boost::uint32_t ended_marker = 0;
+
+	/// The maximum number of samples that are sent as a single chunk (the clients reject larger frames).
+	const std::size_t max_block_samples = 1024;
+
+	/// The maximum number of samples that are collected from one subscription at a time (so that the others get their turn).
+	const std::size_t max_collect_samples = 4*max_block_samples;
+
+	/// Interval at which a session checks whether the subscribed outlets still exist, in milliseconds.
+	const int outlet_check_interval = 500;
+
+	/// The server of this process, if any (created once; protected by server_mut).
+	boost::once_flag server_once = BOOST_ONCE_INIT;
+	boost::mutex *server_mut = NULL;
+	boost::weak_ptr<mux_server> *server = NULL;
+
+	/// Create the state of the process-wide server (called once).
+	void create_server_state() {
+		server_mut = new boost::mutex();
+		server = new boost::weak_ptr<mux_server>();
+	}
+
+	/// Run an IO service until it runs out of work (continuing after errors in handlers).
+	void run_io(io_service *io) {
+		while (true) {
+			try {
+				io->run();
+				return;
+			} catch(std::exception &e) {
+				std::cerr << "Error during io_service processing of the multiplexing server: " << e.what() << std::endl;
+			}
+		}
+	}
+}
+
+/**
+* Get the multiplexing server of this process, starting it if necessary.
+* @throws std::exception if no port is available.
+*/
+mux_server_p mux_server::instance() {
+	boost::call_once(&create_server_state,server_once);
+	boost::lock_guard<boost::mutex> lock(*server_mut);
+	mux_server_p result = server->lock();
+	if (!result) {
+		result.reset(new mux_server());
+		*server = result;
+	}
+	return result;
+}
+
+/// Start the server (see instance()).
+mux_server::mux_server(): acceptor_(io_), port_(0) {
+	acceptor_.open(tcp::v4());
+	port_ = bind_and_listen_to_port_in_range(acceptor_,tcp::v4(),10);
+	accept_next_connection();
+	io_thread_ = boost::thread(boost::bind(&run_io,&io_));
+}
+
+/// Destructor. Ends all sessions and stops the server.
+mux_server::~mux_server() {
+	io_.post(boost::bind(&mux_server::shutdown,this));
+	io_thread_.join();
+}
+
+/// Start accepting a new connection.
+void mux_server::accept_next_connection() {
+	session_p newsession(new session(*this));
+	acceptor_.async_accept(newsession->socket(),boost::bind(&mux_server::handle_accept_outcome,this,newsession,placeholders::error));
+}
+
+/// Handler that is called when the accept has finished.
+void mux_server::handle_accept_outcome(session_p newsession, error_code err) {
+	if (err == error::operation_aborted || !acceptor_.is_open())
+		return;
+	if (!err)
+		newsession->begin_processing();
+	accept_next_connection();
+}
+
+/// End all sessions and stop accepting connections (runs on the IO thread).
+void mux_server::shutdown() {
+	error_code ec;
+	acceptor_.close(ec);
+	std::set<session_p> sessions(sessions_);
+	for (std::set<session_p>::iterator i=sessions.begin(); i!=sessions.end(); i++)
+		(*i)->close();
+}
+
+
+// === implementation of the mux_server::session class ===
+
+/// Instantiate a new session & its socket.
+mux_server::session::session(mux_server &serv): serv_(serv), sock_(serv.io_), requeststream_(&requestbuf_), writing_(false), closed_(false), check_timer_(serv.io_) { }
+
+/// Begin processing this session (i.e., read the request).
+void mux_server::session::begin_processing() {
+	serv_.sessions_.insert(shared_from_this());
+	error_code ec;
+	sock_.set_option(tcp::no_delay(true),ec);
+	// request line LSL:muxfeed/[ProtocolVersion]\r\n, followed by (currently unused) header lines and an empty line
+	async_read_until(sock_,requestbuf_,"\r\n\r\n",
+		boost::bind(&session::handle_read_request_outcome,shared_from_this(),placeholders::error));
+}
+
+/// End the session (drops all subscriptions and closes the socket).
+void mux_server::session::close() {
+	if (closed_)
+		return;
+	closed_ = true;
+	// (this also drops the notification callbacks, which hold references to us)
+	subscriptions_.clear();
+	error_code ec;
+	check_timer_.cancel(ec);
+	sock_.shutdown(tcp::socket::shutdown_both,ec);
+	sock_.close(ec);
+	serv_.sessions_.erase(shared_from_this());
+}
+
+/// Handler that gets called when the request has been read.
+void mux_server::session::handle_read_request_outcome(error_code err) {
+	try {
+		if (err || closed_) {
+			close();
+			return;
+		}
+		std::string method, line;
+		getline(requeststream_,method);
+		boost::algorithm::trim(method);
+		while (getline(requeststream_,line) && !boost::algorithm::trim_copy(line).empty());
+		if (!boost::algorithm::starts_with(method,"LSL:muxfeed/")) {
+			close();
+			return;
+		}
+		int request_protocol_version = boost::lexical_cast<int>(method.substr(12));
+		std::ostream response_stream(&feedbuf_);
+		if (request_protocol_version/100 > api_config::get_instance()->use_protocol_version()/100)
+			response_stream << "LSL/" << api_config::get_instance()->use_protocol_version() << " 505 Version not supported\r\n\r\n";
+		else
+			response_stream << "LSL/" << api_config::get_instance()->use_protocol_version() << " 200 OK\r\nByte-Order: " << BOOST_BYTE_ORDER << "\r\n\r\n";
+		response_stream << std::flush;
+		writing_ = true;
+		async_write(sock_,feedbuf_.data(),
+			boost::bind(&session::handle_send_response_outcome,shared_from_this(),placeholders::error));
+	} catch(std::exception &e) {
+		std::cerr << "Unexpected error while reading a multiplexing request: " << e.what() << std::endl;
+		close();
+	}
+}
+
+/// Handler that gets called when the response has been sent.
+void mux_server::session::handle_send_response_outcome(error_code err) {
+	writing_ = false;
+	feedbuf_.consume(feedbuf_.size());
+	if (err || closed_) {
+		close();
+		return;
+	}
+	// start serving the subscription commands of the client
+	async_read_until(sock_,requestbuf_,"\r\n",
+		boost::bind(&session::handle_read_command_outcome,shared_from_this(),placeholders::error));
+	check_timer_.expires_from_now(boost::posix_time::milliseconds(outlet_check_interval));
+	check_timer_.async_wait(boost::bind(&session::handle_check_outlets,shared_from_this(),placeholders::error));
+}
+
+/// Handler that gets called when a subscription command has been read.
+void mux_server::session::handle_read_command_outcome(error_code err) {
+	try {
+		// on error (e.g., the client has disconnected) we end the session
+		if (err || closed_) {
+			close();
+			return;
+		}
+		// Subscribe: [Channel] [UID] [MaxBufferLength] [MaxChunkLength]\r\n or Unsubscribe: [Channel]\r\n
+		std::string line; getline(requeststream_,line);
+		std::vector<std::string> parts; boost::algorithm::split(parts,line,boost::algorithm::is_any_of(" \t\r"),boost::algorithm::token_compress_on);
+		if (parts.size() >= 5 && parts[0] == "Subscribe:")
+			subscribe(boost::lexical_cast<boost::uint32_t>(parts[1]),parts[2],boost::lexical_cast<int>(parts[3]),boost::lexical_cast<int>(parts[4]));
+		if (parts.size() >= 2 && parts[0] == "Unsubscribe:")
+			subscriptions_.erase(boost::lexical_cast<boost::uint32_t>(parts[1]));
+		transfer_samples();
+		async_read_until(sock_,requestbuf_,"\r\n",
+			boost::bind(&session::handle_read_command_outcome,shared_from_this(),placeholders::error));
+	} catch(std::exception &e) {
+		std::cerr << "Unexpected error while handling a multiplexing command: " << e.what() << "; ending the session..." << std::endl;
+		close();
+	}
+}
+
+/// Subscribe to the stream of an outlet in this process.
+void mux_server::session::subscribe(boost::uint32_t channel, const std::string &uid, int max_buffered, int max_chunklen) {
+	subscriptions_.erase(channel);
+	subscription &sub = subscriptions_[channel];
+	sub.uid = uid;
+	sub.chunk_granularity = max_chunklen;
+	sub.seqn = 0;
+	sub.confirm = true;
+	sub.ended = false;
+	sub.armed = false;
+	// (only numeric streams can be transferred in chunks)
+	outlet_registry::entry outlet;
+	if (outlet_registry::find(uid,outlet) && outlet.factory->format() != cf_string) {
+		sub.queue = outlet.buffer->new_consumer(max_buffered);
+		if (!sub.chunk_granularity)
+			sub.chunk_granularity = outlet.chunk_size;
+	} else {
+		sub.confirm = false;
+		sub.ended = true;
+	}
+}
+
+/// Collect the available samples of all subscriptions into frames and send them (or arrange to be called again when the next sample is pushed).
+void mux_server::session::transfer_samples() {
+	try {
+		if (writing_ || closed_)
+			return;
+		for (subscription_map::iterator i=subscriptions_.begin(); i!=subscriptions_.end();) {
+			subscription &sub = i->second;
+			if (sub.confirm) {
+				write_frame_header(i->first,subscribed_marker);
+				sub.confirm = false;
+			}
+			if (sub.queue)
+				collect_samples(i->first,sub);
+			if (sub.ended) {
+				// send the rest of the stream and announce its end
+				if (!sub.block.empty())
+					write_block(i->first,sub);
+				write_frame_header(i->first,ended_marker);
+				subscriptions_.erase(i++);
+			} else
+				i++;
+		}
+		if (feedbuf_.size()) {
+			// send off the frames; we resume once the transfer has completed
+			writing_ = true;
+			async_write(sock_,feedbuf_.data(),
+				boost::bind(&session::handle_write_outcome,shared_from_this(),placeholders::error,placeholders::bytes_transferred));
+			return;
+		}
+		// nothing to send: have the queues notify us when the next sample comes in (unless one arrived in the meantime)
+		bool again = false;
+		for (subscription_map::iterator i=subscriptions_.begin(); i!=subscriptions_.end(); i++) {
+			if (i->second.queue && !i->second.armed) {
+				if (i->second.queue->arm_notify(boost::bind(&session::notify_transfer,shared_from_this(),i->first)))
+					i->second.armed = true;
+				else
+					again = true;
+			}
+		}
+		if (again)
+			serv_.io_.post(boost::bind(&session::transfer_samples,shared_from_this()));
+	} catch(std::exception &e) {
+		std::cerr << "Unexpected error in the multiplexed transfer: " << e.what() << "; ending the session..." << std::endl;
+		close();
+	}
+}
+
+/// Collect the available samples of a subscription (up to a limit) into frames.
+void mux_server::session::collect_samples(boost::uint32_t channel, subscription &sub) {
+	sample_p samp;
+	// (once the outlet is gone we take everything that is left)
+	for (std::size_t n=0; n<max_collect_samples || sub.ended; n++) {
+		// get the next sample: either the continuation of the current chunk or the next entry of the sample queue
+		if (sub.pending)
+			samp.swap(sub.pending);
+		else if (!sub.queue->try_pop(samp))
+			break;
+		// ignore blank samples (wakeup notifiers)
+		if (!samp)
+			continue;
+		sub.pending = samp->next_in_chunk();
+		bool pushthrough = sub.chunk_granularity ? ((++sub.seqn)%(unsigned)sub.chunk_granularity) == 0 : samp->pushthrough;
+		sub.block.push_back(samp);
+		if (pushthrough || sub.block.size() >= max_block_samples || (sub.block.size()+1)*samp->datasize() > mux_client::max_block_bytes)
+			write_block(channel,sub);
+	}
+}
+
+/// Write the collected block of a subscription as a frame.
+void mux_server::session::write_block(boost::uint32_t channel, subscription &sub) {
+	write_frame_header(channel,(boost::uint32_t)sample::chunk_bytes(&sub.block[0],sub.block.size()));
+	sample::save_chunk_streambuf(feedbuf_,&sub.block[0],sub.block.size(),BOOST_BYTE_ORDER,coded_);
+	sub.block.clear();
+}
+
+/// Write a frame header.
+void mux_server::session::write_frame_header(boost::uint32_t channel, boost::uint32_t size) {
+	sample::save_value(feedbuf_,channel,BOOST_BYTE_ORDER);
+	sample::save_value(feedbuf_,size,BOOST_BYTE_ORDER);
+}
+
+/// Callback of a consumer queue when a new sample has been pushed; schedules handle_notify() on the IO thread.
+void mux_server::session::notify_transfer(boost::uint32_t channel) {
+	serv_.io_.post(boost::bind(&session::handle_notify,shared_from_this(),channel));
+}
+
+/// Handler that gets called after a consumer queue has notified us.
+void mux_server::session::handle_notify(boost::uint32_t channel) {
+	subscription_map::iterator i = subscriptions_.find(channel);
+	if (i != subscriptions_.end())
+		i->second.armed = false;
+	transfer_samples();
+}
+
+/// Handler that gets called when a batch of frames has been sent.
+void mux_server::session::handle_write_outcome(error_code err, std::size_t n) {
+	writing_ = false;
+	if (err || closed_) {
+		close();
+		return;
+	}
+	feedbuf_.consume(n);
+	transfer_samples();
+}
+
+/// Handler that periodically checks whether the subscribed outlets still exist.
+void mux_server::session::handle_check_outlets(error_code err) {
+	if (err || closed_)
+		return;
+	bool ended = false;
+	outlet_registry::entry outlet;
+	for (subscription_map::iterator i=subscriptions_.begin(); i!=subscriptions_.end(); i++) {
+		if (i->second.queue && !i->second.ended && !outlet_registry::find(i->second.uid,outlet))
+			ended = i->second.ended = true;
+	}
+	if (ended)
+		transfer_samples();
+	check_timer_.expires_from_now(boost::posix_time::milliseconds(outlet_check_interval));
+	check_timer_.async_wait(boost::bind(&session::handle_check_outlets,shared_from_this(),placeholders::error));
+}
@@ -0,0 +1,153 @@
+#ifndef MUX_SERVER_H
+#define MUX_SERVER_H
+
+#include <map>
+#include <set>
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include "send_buffer.h"
+#include "sample.h"
+
+
+using boost::asio::ip::tcp;
+using boost::system::error_code;
+
+namespace lsl {
+
+	/// shared pointer to a multiplexing server
+	typedef boost::shared_ptr<class mux_server> mux_server_p;
+
+	/**
+	* The multiplexing server of a process: a single TCP listener (IPv4) that is shared by all outlets of the process and over
+	* which an inlet host can receive the data of any number of these outlets through a single connection (a "mux session").
+	*
+	* A session starts with the request line "LSL:muxfeed/[ProtocolVersion]" and an empty line, which the server answers with
+	* a status line and "Byte-Order: [ByteOrder]" (the native byte order of the server, in which all data is sent).
+	* The client then subscribes to streams by UID with lines "Subscribe: [Channel] [UID] [MaxBufferLength] [MaxChunkLength]"
+	* and cancels subscriptions with "Unsubscribe: [Channel]", where the channel is a number of the client's choice.
+	* The server sends frames of the form [uint32: channel][uint32: size][chunk of the given size (protocol 1.20)];
+	* a size of 0xFFFFFFFF confirms a subscription and a size of 0 announces that the stream has ended (or does not exist here).
+	*
+	* The outlets find the outlets to serve in the outlet_registry. The server is created with the first outlet that asks for it
+	* and stops once the last outlet has released it.
+	*/
+	class mux_server: private boost::noncopyable {
+	public:
+		/**
+		* Get the multiplexing server of this process, starting it if necessary.
+		* @throws std::exception if no port is available.
+		*/
+		static mux_server_p instance();
+
+		/// Destructor. Ends all sessions and stops the server.
+		~mux_server();
+
+		/// The port on which the server listens.
+		int port() const { return port_; }
+
+	private:
+		class session;
+		typedef boost::shared_ptr<session> session_p;
+
+		/// Start the server (see instance()).
+		mux_server();
+
+		/// Start accepting a new connection.
+		void accept_next_connection();
+
+		/// Handler that is called when the accept has finished.
+		void handle_accept_outcome(session_p newsession, error_code err);
+
+		/// End all sessions and stop accepting connections (runs on the IO thread).
+		void shutdown();
+
+		/// A connection to an inlet host, over which the samples of the subscribed streams are transferred.
+		class session: public boost::enable_shared_from_this<session>, private boost::noncopyable {
+		public:
+			/// Instantiate a new session & its socket.
+			session(mux_server &serv);
+
+			/// Get the socket of this session.
+			tcp::socket &socket() { return sock_; }
+
+			/// Begin processing this session (i.e., read the request).
+			void begin_processing();
+
+			/// End the session (drops all subscriptions and closes the socket).
+			void close();
+
+		private:
+			/// A subscription to the stream of an outlet.
+			struct subscription {
+				std::string uid;				// the UID of the outlet
+				consumer_queue_p queue;			// the queue from which we receive the samples (empty if the outlet was not found)
+				sample_p pending;				// the remainder of a partially collected chunk, if any
+				std::vector<sample_p> block;	// the samples that are waiting to be sent as the next chunk
+				int chunk_granularity;			// the chunk size to use (or 0 to follow the pushthrough flags)
+				unsigned seqn;					// sequence number of the collected samples; merely used to determine chunk boundaries
+				bool confirm;					// whether the subscription still needs to be confirmed
+				bool ended;						// whether the stream has ended (the subscription is removed once this has been sent)
+				bool armed;						// whether the queue has been armed to notify us
+			};
+			typedef std::map<boost::uint32_t,subscription> subscription_map;
+
+			/// Handler that gets called when the request has been read.
+			void handle_read_request_outcome(error_code err);
+
+			/// Handler that gets called when the response has been sent.
+			void handle_send_response_outcome(error_code err);
+
+			/// Handler that gets called when a subscription command has been read.
+			void handle_read_command_outcome(error_code err);
+
+			/// Subscribe to the stream of an outlet in this process.
+			void subscribe(boost::uint32_t channel, const std::string &uid, int max_buffered, int max_chunklen);
+
+			/// Collect the available samples of all subscriptions into frames and send them (or arrange to be called again when the next sample is pushed).
+			void transfer_samples();
+
+			/// Collect the available samples of a subscription (up to a limit) into frames.
+			void collect_samples(boost::uint32_t channel, subscription &sub);
+
+			/// Write the collected block of a subscription as a frame.
+			void write_block(boost::uint32_t channel, subscription &sub);
+
+			/// Write a frame header.
+			void write_frame_header(boost::uint32_t channel, boost::uint32_t size);
+
+			/// Callback of a consumer queue when a new sample has been pushed; schedules handle_notify() on the IO thread.
+			void notify_transfer(boost::uint32_t channel);
+
+			/// Handler that gets called after a consumer queue has notified us.
+			void handle_notify(boost::uint32_t channel);
+
+			/// Handler that gets called when a batch of frames has been sent.
+			void handle_write_outcome(error_code err, std::size_t n);
+
+			/// Handler that periodically checks whether the subscribed outlets still exist.
+			void handle_check_outlets(error_code err);
+
+			mux_server &serv_;					// the server of this session
+			tcp::socket sock_;					// connection socket
+			boost::asio::streambuf requestbuf_;	// this buffer holds the requests of the client (incrementally filled)
+			std::istream requeststream_;		// a stream on top of the request buffer for convenient parsing
+			boost::asio::streambuf feedbuf_;	// this buffer holds the frames that are being collected or sent
+			bool writing_;						// whether the frames in feedbuf_ are being sent
+			bool closed_;						// whether the session has ended
+			subscription_map subscriptions_;	// the subscriptions, by channel
+			boost::asio::deadline_timer check_timer_;	// timer for the periodic check of the subscribed outlets
+			std::vector<char> coded_;			// scratchpad memory for serialization
+		};
+
+		boost::asio::io_service io_;			// the IO service on which the server runs
+		tcp::acceptor acceptor_;				// our server socket
+		int port_;								// the port on which we listen
+		std::set<session_p> sessions_;			// the active sessions (IO thread only)
+		boost::thread io_thread_;				// the thread that runs the IO service
+	};
+
+}
+
+#endif
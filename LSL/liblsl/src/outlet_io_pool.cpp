@@ -0,0 +1,78 @@
+#include <iostream>
+#include <boost/bind.hpp>
+#include <boost/thread/once.hpp>
+#include "outlet_io_pool.h"
+#include "api_config.h"
+
+
+// === implementation of the outlet_io_pool class ===
+
+using namespace lsl;
+using namespace boost::asio;
+
+namespace {
+	/// The IO pool of this process, if any (created once; protected by pool_mut).
+	boost::once_flag pool_once = BOOST_ONCE_INIT;
+	boost::mutex *pool_mut = NULL;
+	boost::weak_ptr<outlet_io_pool> *pool = NULL;
+
+	/// Create the state of the process-wide pool (called once).
+	void create_pool_state() {
+		pool_mut = new boost::mutex();
+		pool = new boost::weak_ptr<outlet_io_pool>();
+	}
+
+	/// Run an IO service until it is stopped (continuing after errors in handlers).
+	void run_io(io_service *io) {
+		while (true) {
+			try {
+				io->run();
+				return;
+			} catch(std::exception &e) {
+				std::cerr << "Error during io_service processing of the outlet IO pool: " << e.what() << std::endl;
+			}
+		}
+	}
+
+	/// Delete a pool (on a thread of its own).
+	void delete_pool(outlet_io_pool *pool) { delete pool; }
+}
+
+/// Get the IO pool of this process, starting it if necessary.
+outlet_io_pool_p outlet_io_pool::instance() {
+	boost::call_once(&create_pool_state,pool_once);
+	boost::lock_guard<boost::mutex> lock(*pool_mut);
+	outlet_io_pool_p result = pool->lock();
+	if (!result) {
+		result.reset(new outlet_io_pool(std::max(1,api_config::get_instance()->outlet_io_threads())),&outlet_io_pool::release);
+		*pool = result;
+	}
+	return result;
+}
+
+/// Get the IO pool of this process if the configuration asks for one, otherwise an empty pointer.
+outlet_io_pool_p outlet_io_pool::configured() {
+	return api_config::get_instance()->outlet_io_threads() ? instance() : outlet_io_pool_p();
+}
+
+/// Start the given number of threads (see instance()).
+outlet_io_pool::outlet_io_pool(int num_threads): work_(new io_service::work(io_)) {
+	for (int k=0; k<num_threads; k++)
+		threads_.create_thread(boost::bind(&run_io,&io_));
+}
+
+/// Destructor. Stops the threads.
+outlet_io_pool::~outlet_io_pool() {
+	work_.reset();
+	io_.stop();
+	threads_.join_all();
+}
+
+/// Delete a pool whose last reference has been released (possibly from one of its own threads).
+void outlet_io_pool::release(outlet_io_pool *pool) {
+	// (the last reference is usually dropped by a handler of a session, and a thread cannot join itself)
+	if (pool->threads_.is_this_thread_in())
+		boost::thread(boost::bind(&delete_pool,pool)).detach();
+	else
+		delete pool;
+}
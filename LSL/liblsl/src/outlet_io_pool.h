@@ -0,0 +1,56 @@
+#ifndef OUTLET_IO_POOL_H
+#define OUTLET_IO_POOL_H
+
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/enable_shared_from_this.hpp>
+
+
+namespace lsl {
+
+	/// shared pointer to an outlet IO pool
+	typedef boost::shared_ptr<class outlet_io_pool> outlet_io_pool_p;
+	/// pointer to an io_service
+	typedef boost::shared_ptr<boost::asio::io_service> io_service_p;
+
+	/**
+	* The IO pool of the outlets of a process: a fixed number of threads that run a shared IO service, on which all outlets of
+	* the process serve their TCP and UDP connections, instead of each outlet running two IO threads of its own per IP stack.
+	* This keeps the number of threads constant for applications with many outlets.
+	*
+	* The pool is used if enabled in the configuration (see api_config::outlet_io_threads()). It is created with the first outlet
+	* that asks for it and stops once the servers and sessions of the last outlet have released it. The servers run their
+	* handlers on a strand each, so that they need no further synchronization.
+	*/
+	class outlet_io_pool: public boost::enable_shared_from_this<outlet_io_pool>, private boost::noncopyable {
+	public:
+		/// Get the IO pool of this process, starting it if necessary.
+		static outlet_io_pool_p instance();
+
+		/// Get the IO pool of this process if the configuration asks for one, otherwise an empty pointer.
+		static outlet_io_pool_p configured();
+
+		/// Destructor. Stops the threads.
+		~outlet_io_pool();
+
+		/// The IO service on which the outlets run (the pointer keeps the pool alive).
+		io_service_p io() { return io_service_p(shared_from_this(),&io_); }
+
+	private:
+		/// Start the given number of threads (see instance()).
+		outlet_io_pool(int num_threads);
+
+		/// Delete a pool whose last reference has been released (possibly from one of its own threads).
+		static void release(outlet_io_pool *pool);
+
+		boost::asio::io_service io_;							// the IO service that is shared by the outlets
+		boost::scoped_ptr<boost::asio::io_service::work> work_;	// keeps the threads running while there is nothing to do
+		boost::thread_group threads_;							// the threads that run the IO service
+	};
+
+}
+
+#endif
@@ -0,0 +1,85 @@
+#include "outlet_registry.h"
+#include <map>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/once.hpp>
+
+
+// === implementation of the outlet_registry class ===
+
+using namespace lsl;
+
+namespace {
+	/// The registered outlets, by UID.
+	typedef std::map<std::string,outlet_registry::entry> outlet_map;
+
+	boost::once_flag registry_once = BOOST_ONCE_INIT;
+	boost::mutex *registry_mut = NULL;
+	boost::condition_variable *registry_upd = NULL;
+	outlet_map *registry = NULL;
+	unsigned wakeups = 0;			// incremented by wake_all() (protected by registry_mut)
+
+	/// Create the registry (called once).
+	void create_registry() {
+		registry_mut = new boost::mutex();
+		registry_upd = new boost::condition_variable();
+		registry = new outlet_map();
+	}
+}
+
+/// Add an outlet to the registry.
+void outlet_registry::add(const std::string &uid, const send_buffer_p &buffer, const sample::factory_p &factory, int chunk_size) {
+	boost::call_once(&create_registry,registry_once);
+	boost::lock_guard<boost::mutex> lock(*registry_mut);
+	entry &e = (*registry)[uid];
+	e.buffer = buffer;
+	e.factory = factory;
+	e.chunk_size = chunk_size;
+}
+
+/// Remove an outlet from the registry (wakes up everyone who waits for its removal).
+void outlet_registry::remove(const std::string &uid) {
+	boost::call_once(&create_registry,registry_once);
+	{
+		boost::lock_guard<boost::mutex> lock(*registry_mut);
+		registry->erase(uid);
+	}
+	registry_upd->notify_all();
+}
+
+/// Look up an outlet by its UID; returns false if there is no such outlet in this process.
+bool outlet_registry::find(const std::string &uid, entry &result) {
+	boost::call_once(&create_registry,registry_once);
+	boost::lock_guard<boost::mutex> lock(*registry_mut);
+	outlet_map::iterator i = registry->find(uid);
+	if (i == registry->end())
+		return false;
+	result = i->second;
+	return true;
+}
+
+/**
+* Wait until the outlet with the given UID has been removed.
+* @param uid The UID of the outlet.
+* @param timeout The maximum time to wait, in seconds.
+* @return Whether the outlet has been removed (false if the wait timed out or was interrupted by wake_all()).
+*/
+bool outlet_registry::wait_for_removal(const std::string &uid, double timeout) {
+	boost::call_once(&create_registry,registry_once);
+	boost::unique_lock<boost::mutex> lock(*registry_mut);
+	boost::chrono::steady_clock::time_point deadline = boost::chrono::steady_clock::now() + boost::chrono::duration_cast<boost::chrono::steady_clock::duration>(boost::chrono::duration<double>(timeout));
+	for (unsigned start=wakeups; registry->count(uid) && wakeups == start; )
+		if (registry_upd->wait_until(lock,deadline) == boost::cv_status::timeout)
+			break;
+	return !registry->count(uid);
+}
+
+/// Wake up all threads that wait for the removal of an outlet (so that they can re-check their own state).
+void outlet_registry::wake_all() {
+	boost::call_once(&create_registry,registry_once);
+	{
+		boost::lock_guard<boost::mutex> lock(*registry_mut);
+		wakeups++;
+	}
+	registry_upd->notify_all();
+}
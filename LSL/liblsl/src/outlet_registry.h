@@ -0,0 +1,51 @@
+#ifndef OUTLET_REGISTRY_H
+#define OUTLET_REGISTRY_H
+
+#include <string>
+#include "send_buffer.h"
+#include "sample.h"
+
+
+namespace lsl {
+
+	/**
+	* The process-wide registry of outlets, by UID.
+	* An inlet whose stream is served by an outlet in the same process looks the outlet up here and attaches its sample
+	* queue directly to the outlet's send buffer, so that the samples are shared by reference instead of being serialized,
+	* sent through a loopback connection and parsed again.
+	* Outlets add themselves when they are created and remove themselves when they are destroyed.
+	*/
+	class outlet_registry {
+	public:
+		/// The parts of an outlet that an inlet in the same process attaches to.
+		struct entry {
+			send_buffer_p buffer;			// the send buffer of the outlet
+			sample::factory_p factory;		// the factory of the outlet's samples (must outlive them)
+			int chunk_size;					// the preferred chunk size of the outlet, in samples (or 0)
+		};
+
+		/// Add an outlet to the registry.
+		static void add(const std::string &uid, const send_buffer_p &buffer, const sample::factory_p &factory, int chunk_size);
+
+		/// Remove an outlet from the registry (wakes up everyone who waits for its removal).
+		static void remove(const std::string &uid);
+
+		/// Look up an outlet by its UID; returns false if there is no such outlet in this process.
+		static bool find(const std::string &uid, entry &result);
+
+		/**
+		* Wait until the outlet with the given UID has been removed.
+		* @param uid The UID of the outlet.
+		* @param timeout The maximum time to wait, in seconds.
+		* @return Whether the outlet has been removed (false if the wait timed out or was interrupted by wake_all()).
+		*/
+		static bool wait_for_removal(const std::string &uid, double timeout);
+
+		/// Wake up all threads that wait for the removal of an outlet (so that they can re-check their own state).
+		static void wake_all();
+	};
+
+}
+
+#endif
+
@@ -20,17 +20,76 @@ bool sample::operator==(const sample &rhs) {
 	}
 }
 
+namespace {
+	/// Minimal stream buffer that only counts the bytes written to it.
+	struct counting_streambuf {
+		counting_streambuf(): count(0) {}
+		std::streamsize sputn(const char *, std::streamsize n) { count += (std::size_t)n; return n; }
+		std::size_t count;
+	};
+
+	/// Minimal stream buffer that writes into a pre-allocated memory region.
+	struct memory_streambuf {
+		memory_streambuf(char *begin, char *end): pos(begin), end(end) {}
+		std::streamsize sputn(const char *s, std::streamsize n) { 
+			n = std::min(n,(std::streamsize)(end-pos));
+			memcpy(pos,s,(std::size_t)n); 
+			pos += n; 
+			return n; 
+		}
+		char *pos, *end;
+	};
+}
+
+/// Get the wire encoding of the sample (protocol 1.10) in a given byte order, computing it if necessary.
+encoded_sample_p sample::encoded(int use_byte_order) const {
+	boost::atomic<encoded_sample*> &slot = encoded_[use_byte_order == BOOST_BYTE_ORDER ? 0 : 1];
+	if (encoded_sample *e = slot.load(boost::memory_order_acquire))
+		return encoded_sample_p(e);
+	encoded_sample_p result;
+	if (format_ == cf_string) {
+		// determine the size of the encoding, then encode the sample into a new block
+		counting_streambuf counter;
+		save_streambuf(counter,110,use_byte_order);
+		result.reset(encoded_sample::allocate(counter.count));
+		memory_streambuf writer(result->data(),result->data()+counter.count);
+		save_streambuf(writer,110,use_byte_order);
+	} else {
+		// write the header, then copy the channel data into the block and convert it in place
+		std::size_t datasize = format_sizes[format_]*num_channels_, size = 1 + (timestamp == DEDUCED_TIMESTAMP ? 0 : sizeof(double)) + datasize;
+		result.reset(encoded_sample::allocate(size,factory_ ? factory_->encoding_pool() : NULL));
+		memory_streambuf writer(result->data(),result->data()+size-datasize);
+		if (timestamp == DEDUCED_TIMESTAMP) {
+			save_value(writer,TAG_DEDUCED_TIMESTAMP,use_byte_order);
+		} else {
+			save_value(writer,TAG_TRANSMITTED_TIMESTAMP,use_byte_order);
+			save_value(writer,timestamp,use_byte_order);
+		}
+		memcpy(writer.pos,&data_,datasize);
+		if (use_byte_order != BOOST_BYTE_ORDER)
+			convert_endian(writer.pos);
+	}
+	// try to install it in the cache (if another session was faster, we use its block)
+	encoded_sample *expected = NULL;
+	intrusive_ptr_add_ref(result.get());
+	if (!slot.compare_exchange_strong(expected,result.get(),boost::memory_order_acq_rel)) {
+		intrusive_ptr_release(result.get());
+		return encoded_sample_p(expected);
+	}
+	return result;
+}
+
 /// Assign an array of string values to the sample.
 sample &sample::assign_typed(const std::string *s) { 
 	switch (format_) {
 		case cf_string:   for (std::string    *p=(std::string*)   &data_,*e=p+num_channels_; p<e; *p++ = *s++); break; 
-		case cf_float32:  for (float          *p=(float*)         &data_,*e=p+num_channels_; p<e; *p++ = boost::lexical_cast<float>(*s++)); break;
-		case cf_double64: for (double         *p=(double*)        &data_,*e=p+num_channels_; p<e; *p++ = boost::lexical_cast<double>(*s++)); break;
-		case cf_int8:     for (boost::int8_t  *p=(boost::int8_t*) &data_,*e=p+num_channels_; p<e; *p++ = boost::lexical_cast<boost::int8_t>(*s++)); break;
-		case cf_int16:    for (boost::int16_t *p=(boost::int16_t*)&data_,*e=p+num_channels_; p<e; *p++ = boost::lexical_cast<boost::int16_t>(*s++)); break;
-		case cf_int32:    for (boost::int32_t *p=(boost::int32_t*)&data_,*e=p+num_channels_; p<e; *p++ = boost::lexical_cast<boost::int32_t>(*s++)); break;
+		case cf_float32:  for (float          *p=(float*)         &data_,*e=p+num_channels_; p<e; *p++ = string_to_number<float>(*s++)); break;
+		case cf_double64: for (double         *p=(double*)        &data_,*e=p+num_channels_; p<e; *p++ = string_to_number<double>(*s++)); break;
+		case cf_int8:     for (boost::int8_t  *p=(boost::int8_t*) &data_,*e=p+num_channels_; p<e; *p++ = string_to_number<boost::int8_t>(*s++)); break;
+		case cf_int16:    for (boost::int16_t *p=(boost::int16_t*)&data_,*e=p+num_channels_; p<e; *p++ = string_to_number<boost::int16_t>(*s++)); break;
+		case cf_int32:    for (boost::int32_t *p=(boost::int32_t*)&data_,*e=p+num_channels_; p<e; *p++ = string_to_number<boost::int32_t>(*s++)); break;
 #ifndef BOOST_NO_INT64_T
-		case cf_int64:    for (boost::int64_t *p=(boost::int64_t*)&data_,*e=p+num_channels_; p<e; *p++ = boost::lexical_cast<boost::int64_t>(*s++)); break;
+		case cf_int64:    for (boost::int64_t *p=(boost::int64_t*)&data_,*e=p+num_channels_; p<e; *p++ = string_to_number<boost::int64_t>(*s++)); break;
 #endif
 		default: throw std::invalid_argument("Unsupported channel format.");
 	}
@@ -41,13 +100,13 @@ sample &sample::assign_typed(const std::string *s) {
 sample &sample::retrieve_typed(std::string *d) {
 	switch (format_) {
 		case cf_string:   for (std::string    *p=(std::string*)   &data_,*e=p+num_channels_; p<e; *d++ = *p++); break; 
-		case cf_float32:  for (float          *p=(float*)         &data_,*e=p+num_channels_; p<e; *d++ = boost::lexical_cast<std::string>(*p++)); break; 
-		case cf_double64: for (double         *p=(double*)        &data_,*e=p+num_channels_; p<e; *d++ = boost::lexical_cast<std::string>(*p++)); break; 
-		case cf_int8:     for (boost::int8_t  *p=(boost::int8_t*) &data_,*e=p+num_channels_; p<e; *d++ = boost::lexical_cast<std::string>(*p++)); break; 
-		case cf_int16:    for (boost::int16_t *p=(boost::int16_t*)&data_,*e=p+num_channels_; p<e; *d++ = boost::lexical_cast<std::string>(*p++)); break; 
-		case cf_int32:    for (boost::int32_t *p=(boost::int32_t*)&data_,*e=p+num_channels_; p<e; *d++ = boost::lexical_cast<std::string>(*p++)); break; 
+		case cf_float32:  for (float          *p=(float*)         &data_,*e=p+num_channels_; p<e; number_to_string(*p++,*d++)); break; 
+		case cf_double64: for (double         *p=(double*)        &data_,*e=p+num_channels_; p<e; number_to_string(*p++,*d++)); break; 
+		case cf_int8:     for (boost::int8_t  *p=(boost::int8_t*) &data_,*e=p+num_channels_; p<e; number_to_string(*p++,*d++)); break; 
+		case cf_int16:    for (boost::int16_t *p=(boost::int16_t*)&data_,*e=p+num_channels_; p<e; number_to_string(*p++,*d++)); break; 
+		case cf_int32:    for (boost::int32_t *p=(boost::int32_t*)&data_,*e=p+num_channels_; p<e; number_to_string(*p++,*d++)); break; 
 #ifndef BOOST_NO_INT64_T
-		case cf_int64:    for (boost::int64_t *p=(boost::int64_t*)&data_,*e=p+num_channels_; p<e; *d++ = boost::lexical_cast<std::string>(*p++)); break; 
+		case cf_int64:    for (boost::int64_t *p=(boost::int64_t*)&data_,*e=p+num_channels_; p<e; number_to_string(*p++,*d++)); break; 
 #endif
 		default: throw std::invalid_argument("Unsupported channel format.");
 	}
@@ -11,9 +11,12 @@
 #include <boost/intrusive_ptr.hpp>
 #include <boost/atomic.hpp>
 #include <boost/static_assert.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/serialization/split_member.hpp>
 #include "endian/conversion.hpp"
 #include "common.h"
+#include "sample_pool.h"
+#include "value_conversion.h"
 
 namespace lsl {
 	// if you get an error here your machine cannot represent the double-precision time-stamp format required by LSL
@@ -23,15 +26,91 @@ namespace lsl {
 	const boost::uint8_t TAG_DEDUCED_TIMESTAMP = 1;
 	const boost::uint8_t TAG_TRANSMITTED_TIMESTAMP = 2;
 
+	/// Samples with at least this many bytes of channel data are received straight into their own memory (instead of through a scratchpad).
+	const std::size_t direct_transfer_bytes = 16384;
+
 	/// channel format properties
 	const int format_sizes[] = {0,sizeof(float),sizeof(double),sizeof(std::string),sizeof(boost::int32_t),sizeof(boost::int16_t),sizeof(boost::int8_t),8};
 	const bool format_ieee754[] = {false,std::numeric_limits<float>::is_iec559,std::numeric_limits<double>::is_iec559,false,false,false,false,false}; 
 	const bool format_subnormal[] = {false,std::numeric_limits<float>::has_denorm!=std::denorm_absent,std::numeric_limits<double>::has_denorm!=std::denorm_absent,false,false,false,false,false}; 
 	const bool format_integral[] = {false,false,false,false,true,true,true,true}; 
 	const bool format_float[] = {false,true,true,false,false,false,false,false}; 
+
+	/// A minimal stream buffer that appends to a vector (for serializing samples into memory, e.g., into datagrams).
+	struct vector_sink {
+		std::vector<char> &out;
+		std::streamsize sputn(const char *data, std::streamsize n) { out.insert(out.end(),data,data+n); return n; }
+	};
+
+	/// A minimal stream buffer that reads from a block of memory (for deserializing samples that were received as a whole).
+	struct memory_source {
+		const char *data;
+		std::size_t size;
+		std::streamsize sgetn(char *dest, std::streamsize n) {
+			std::size_t count = std::min(size,(std::size_t)n);
+			memcpy(dest,data,count);
+			data += count;
+			size -= count;
+			return count;
+		}
+	};
  
 	/// smart pointer to a sample
 	typedef boost::intrusive_ptr<class sample> sample_p;
+	/// smart pointer to an encoded sample
+	typedef boost::intrusive_ptr<class encoded_sample> encoded_sample_p;
+
+	/**
+	* An immutable block of bytes holding the wire encoding of a sample (protocol 1.10) in a given byte order.
+	* A sample caches its encoding so that all client sessions that negotiated the same byte order can share it.
+	*/
+	class encoded_sample {
+	public:
+		/**
+		* Allocate a new block of a given size (the contents are written by the creator).
+		* @param size The number of bytes to allocate.
+		* @param pool Optionally a pool to allocate the block from (must outlive the block); if the pool's blocks are 
+		*			  too small, the block is allocated from the heap.
+		*/
+		static encoded_sample *allocate(std::size_t size, sample_pool *pool=NULL) { 
+			if (pool && sizeof(encoded_sample)+size <= pool->block_size())
+				return new(pool->allocate()) encoded_sample(size,pool);
+			return new(new char[sizeof(encoded_sample)+size]) encoded_sample(size,NULL); 
+		}
+
+		/// Pointer to the encoded bytes.
+		const char *data() const { return (const char*)(this+1); }
+		/// Pointer to the encoded bytes (for the creator of the block).
+		char *data() { return (char*)(this+1); }
+		/// Number of encoded bytes.
+		std::size_t size() const { return size_; }
+
+	private:
+		encoded_sample(std::size_t size, sample_pool *pool): refcount_(0), size_(size), pool_(pool) {}
+
+		/// Increment ref count.
+		friend void intrusive_ptr_add_ref(encoded_sample *e) {
+			e->refcount_.fetch_add(1,boost::memory_order_relaxed);
+		}
+
+		/// Decrement ref count and free if unreferenced.
+		friend void intrusive_ptr_release(encoded_sample *e) {
+			if (e->refcount_.fetch_sub(1,boost::memory_order_release) == 1) {
+				boost::atomic_thread_fence(boost::memory_order_acquire);
+				if (sample_pool *pool = e->pool_) {
+					e->~encoded_sample();
+					pool->release(e);
+				} else {
+					e->~encoded_sample();
+					delete[] (char*)e;
+				}
+			}
+		}
+
+		boost::atomic<int> refcount_;	// reference count used by encoded_sample_p
+		std::size_t size_;				// number of bytes following the header
+		sample_pool *pool_;				// the pool that the block was allocated from, if any
+	};
 	
 	/**
 	* The sample data type.
@@ -47,7 +126,8 @@ namespace lsl {
 		channel_format_t format_;		// the channel format
 		int num_channels_;				// number of channels
 		boost::atomic<int> refcount_;	// reference count used by sample_p
-		boost::atomic<sample*> next_;	// linked list of samples, for use in a freelist
+		mutable boost::atomic<encoded_sample*> encoded_[2];	// cached wire encodings (in native and in reversed byte order), if any
+		sample *chunk_next_;			// the next sample of the chunk that this sample belongs to, if any (we hold a reference to it)
 		factory *factory_;				// the factory used to reclaim this sample, if any
 		char data_;						// the data payload begins here
 
@@ -58,39 +138,24 @@ namespace lsl {
 		typedef boost::shared_ptr<factory> factory_p;
 
 		/// A factory to create samples of a given format/size.
+		/// The memory of the samples comes from a sample_pool that is shared with all other factories whose samples have the same size. 
 		/// Must outlive all of its created samples.
-		class factory {
+		class factory: private boost::noncopyable {
 		public:
-			/// Create a new factory and optionally pre-allocate samples.
-			factory(channel_format_t fmt, int num_chans, int num_reserve): fmt_(fmt), num_chans_(num_chans), 
-				sample_size_(ensure_multiple(sizeof(sample)-sizeof(char)+format_sizes[fmt]*num_chans,16)), storage_size_(sample_size_*std::max(1,num_reserve)), 
-				storage_(new char[storage_size_]), sentinel_(new_sample_unmanaged(fmt,num_chans,0.0,false)), head_(sentinel_), tail_(sentinel_)
-			{
-				// pre-construct an array of samples in the storage area and chain into a freelist
-				sample *s = NULL;
-				for (char *p=storage_.get(),*e=p+storage_size_;p<e;) {
-					s = new((sample*)p) sample(fmt,num_chans,this);
-					s->next_ = (sample*)(p += sample_size_);
-				}
-				s->next_ = NULL;
-				head_.store(s);
-				sentinel_->next_ = (sample*)storage_.get();
-			}
+			/// Create a new factory and optionally pre-allocate samples (but no more than max_reserve_bytes worth of them, if given).
+			factory(channel_format_t fmt, int num_chans, int num_reserve, std::size_t max_reserve_bytes=0): fmt_(fmt), num_chans_(num_chans), 
+				sample_size_(ensure_multiple(sizeof(sample)-sizeof(char)+format_sizes[fmt]*num_chans,16)), 
+				num_reserved_(std::max<std::size_t>(1,max_reserve_bytes ? std::min<std::size_t>(std::max(0,num_reserve),max_reserve_bytes/sample_size_) : std::max(0,num_reserve))),
+				pool_(sample_pool::get(sample_size_,num_reserved_)), 
+				encoding_pool_(fmt == cf_string ? sample_pool_p() : sample_pool::get(ensure_multiple(sizeof(encoded_sample)+sizeof(boost::uint8_t)+sizeof(double)+format_sizes[fmt]*num_chans,16))) { }
 
-			/// Destroy the factory and delete all of its samples.
-			~factory() {
-				if (sample *cur = head_)
-					for (sample *next=cur->next_;next;cur=next,next=next->next_)
-						delete cur;
-				delete sentinel_;
-			}
+			/// Destructor. Hands our reservation back to the pool (so that the next factory can use that memory).
+			~factory() { pool_->unreserve(num_reserved_); }
 
 			/// Create a new sample with a given timestamp and pushthrough flag.
-			/// Only one thread may call this function for a given factory object.
+			/// This function may be called by multiple threads concurrently.
 			sample_p new_sample(double timestamp, bool pushthrough) { 
-				sample *result = pop_freelist();
-				if (!result)
-					result = new(new char[sample_size_]) sample(fmt_,num_chans_,this);
+				sample *result = new(pool_->allocate()) sample(fmt_,num_chans_,this);
 				result->timestamp = timestamp;
 				result->pushthrough = pushthrough;
 				return sample_p(result);
@@ -98,9 +163,8 @@ namespace lsl {
 
 			/// Reclaim a sample that's no longer used.
 			void reclaim_sample(sample *s) { 
-				s->next_ = NULL;
-				sample *prev = head_.exchange(s);
-				prev->next_ = s;
+				s->~sample();
+				pool_->release(s);
 			}
 
 			/// Create a new sample whose memory is not managed by the factory.
@@ -111,61 +175,56 @@ namespace lsl {
 				return result;
 			}
 
+			/// Get the channel format of the samples.
+			channel_format_t format() const { return fmt_; }
+
+			/// Get the number of channels of the samples.
+			int num_channels() const { return num_chans_; }
+
+			/// Get the pool from which the wire encodings of the samples are allocated (if any).
+			sample_pool *encoding_pool() const { return encoding_pool_.get(); }
+
+			/// Get the usage statistics of the pool from which the samples are allocated.
+			sample_pool::usage_info usage() const { return pool_->usage(); }
+
 		private:
 			/// ensure that a given value is a multiple of some base, round up if necessary
 			static boost::uint32_t ensure_multiple(boost::uint32_t v, unsigned base) { return (v%base) ? v - (v%base) + base : v; }
 
-			// Pop a sample from the freelist
-			// (multi-producer/single-consumer queue by Dmitry Vjukov)
-			sample *pop_freelist(){ 
-				sample *tail=tail_, *next=tail->next_;
-				if (tail == sentinel_) { 
-					if (!next) 
-						return NULL; 
-					tail_ = next; 
-					tail = next; 
-					next = next->next_;
-				} 
-				if (next) { 
-					tail_ = next; 
-					return tail; 
-				} 
-				sample *head = head_.load(); 
-				if (tail != head)
-					return NULL; 
-				reclaim_sample(sentinel_); 
-				next = tail->next_;
-				if (next) {
-					tail_ = next; 
-					return tail; 
-				}
-				return NULL;
-			} 
-
-			friend class sample;
 			channel_format_t fmt_;					// the channel format to construct samples with
 			int num_chans_;							// the number of channels to construct samples with
 			int sample_size_;						// size of a sample, in bytes
-			int storage_size_;						// size of the allocated storage, in bytes
-			boost::scoped_array<char> storage_;		// a slab of storage for pre-allocated samples
-			sample *sentinel_;						// a sentinel element for our freelist
-			boost::atomic<sample*> head_;			// head of the freelist
-			sample *tail_;							// tail of the freelist
+			std::size_t num_reserved_;				// the number of blocks that we have reserved in the pool
+			sample_pool_p pool_;					// the pool from which the samples are allocated
+			sample_pool_p encoding_pool_;			// the pool from which the wire encodings are allocated (none for variable-size formats)
 		};
 
 
 		/// Destructor for a sample.
 		~sample() {
+			release_encoded();
 			if (format_ == cf_string)
 				for (std::string *p=(std::string*)&data_,*e=p+num_channels_; p<e; (p++)->~basic_string<char>());
 		}
 
-		/// Delete a sample.
-		void operator delete(void *x) {
-			// delete the underlying memory only if it wasn't allocated in the factory's storage area
-			sample *s = (sample*)x;
-			if (s && !(s->factory_ && (((char*)s) >= s->factory_->storage_.get() && ((char*)s) <= s->factory_->storage_.get()+s->factory_->storage_size_)))
-				delete[] (char*)x;
+		/// Delete a sample (only applicable to samples that were created by new_sample_unmanaged()).
+		void operator delete(void *x) { delete[] (char*)x; }
+
+		// === chunks ===
+
+		/// Get the next sample of the chunk that this sample belongs to (or NULL if this is the last one).
+		sample *next_in_chunk() const { return chunk_next_; }
+
+		/**
+		* Append a sample to the chunk that ends with this sample.
+		* The samples of a chunk are chained to its first sample (which owns the rest of the chunk), so that a whole chunk 
+		* can travel through the send buffer and the consumer queues as a single unit.
+		*/
+		void append_to_chunk(const sample_p &next) { 
+			if (chunk_next_)
+				throw std::logic_error("Samples can only be appended to the end of a chunk.");
+			intrusive_ptr_add_ref(next.get());
+			chunk_next_ = next.get();
 		}
 
 		/// Test for equality with another sample.
@@ -175,43 +234,19 @@ namespace lsl {
 
 		/// Assign an array of numeric values (with type conversions).
 		template<class T> sample &assign_typed(T *s) { 
-			if ((sizeof(T) == format_sizes[format_]) && ((boost::is_integral<T>::value && format_integral[format_]) || (boost::is_floating_point<T>::value && format_float[format_]))) {
-				memcpy(&data_,s,format_sizes[format_]*num_channels_);
-			} else {
-				switch (format_) {
-					case cf_float32:  for (float          *p=(float*)         &data_,*e=p+num_channels_; p<e; *p++ = (float)*s++); break;
-					case cf_double64: for (double         *p=(double*)        &data_,*e=p+num_channels_; p<e; *p++ = (double)*s++); break;
-					case cf_int8:     for (boost::int8_t  *p=(boost::int8_t*) &data_,*e=p+num_channels_; p<e; *p++ = (boost::int8_t)*s++); break; 
-					case cf_int16:    for (boost::int16_t *p=(boost::int16_t*)&data_,*e=p+num_channels_; p<e; *p++ = (boost::int16_t)*s++); break; 
-					case cf_int32:    for (boost::int32_t *p=(boost::int32_t*)&data_,*e=p+num_channels_; p<e; *p++ = (boost::int32_t)*s++); break; 
-#ifndef BOOST_NO_INT64_T
-					case cf_int64:    for (boost::int64_t *p=(boost::int64_t*)&data_,*e=p+num_channels_; p<e; *p++ = (boost::int64_t)*s++); break; 
-#endif
-					case cf_string:   for (std::string    *p=(std::string*)   &data_,*e=p+num_channels_; p<e; *p++ = boost::lexical_cast<std::string>(*s++)); break; 
-					default: throw std::invalid_argument("Unsupported channel format.");
-				}
-			}
+			if (format_ == cf_string) {
+				for (std::string *p=(std::string*)&data_,*e=p+num_channels_; p<e; number_to_string(*s++,*p++));
+			} else
+				convert_values(numeric_format<T>::value,s,format_,&data_,num_channels_);
 			return *this; 
 		}
 
 		/// Retrieve an array of numeric values (with type conversions).
 		template<class T> sample &retrieve_typed(T *d) { 
-			if ((sizeof(T) == format_sizes[format_]) && ((boost::is_integral<T>::value && format_integral[format_]) || (boost::is_floating_point<T>::value && format_float[format_]))) {
-				memcpy(d,&data_,format_sizes[format_]*num_channels_);
-			} else {
-				switch (format_) {
-					case cf_float32:  for (float          *p=(float*)         &data_,*e=p+num_channels_; p<e; *d++ = (T)*p++); break; 
-					case cf_double64: for (double         *p=(double*)        &data_,*e=p+num_channels_; p<e; *d++ = (T)*p++); break; 
-					case cf_int8:     for (boost::int8_t  *p=(boost::int8_t*) &data_,*e=p+num_channels_; p<e; *d++ = (T)*p++); break; 
-					case cf_int16:    for (boost::int16_t *p=(boost::int16_t*)&data_,*e=p+num_channels_; p<e; *d++ = (T)*p++); break; 
-					case cf_int32:    for (boost::int32_t *p=(boost::int32_t*)&data_,*e=p+num_channels_; p<e; *d++ = (T)*p++); break; 
-#ifndef BOOST_NO_INT64_T
-					case cf_int64:    for (boost::int64_t *p=(boost::int64_t*)&data_,*e=p+num_channels_; p<e; *d++ = (T)*p++); break; 
-#endif
-					case cf_string:   for (std::string    *p=(std::string*)   &data_,*e=p+num_channels_; p<e; *d++ = boost::lexical_cast<T>(*p++)); break; 
-					default: throw std::invalid_argument("Unsupported channel format.");
-				}
-			}
+			if (format_ == cf_string) {
+				for (std::string *p=(std::string*)&data_,*e=p+num_channels_; p<e; *d++ = string_to_number<T>(*p++));
+			} else
+				convert_values(format_,&data_,numeric_format<T>::value,d,num_channels_);
 			return *this; 
 		}
 
@@ -241,6 +276,15 @@ namespace lsl {
 			return *this; 
 		}
 
+		/// Get the channel format of the sample.
+		channel_format_t format() const { return format_; }
+
+		/// Get the channel data of a numeric sample (e.g., to send it straight from the sample's memory).
+		const char *channel_data() const { return &data_; }
+
+		/// Get the size of the channel data of a numeric sample, in bytes.
+		std::size_t datasize() const { return format_sizes[format_]*num_channels_; }
+
 		// === serialization functions ===
 
 		/// Helper function to save raw binary data to a stream buffer.
@@ -274,15 +318,20 @@ namespace lsl {
 		/// Load a value from a stream buffer; specialization of the above.
 		template<class StreamBuf> void load_value(StreamBuf &sb, boost::uint8_t &v, int use_byte_order) { load_raw(sb,&v,sizeof(v)); }
 
-		/// Serialize a sample to a stream buffer (protocol 1.10).
-		template<class StreamBuf> void save_streambuf(StreamBuf &sb, int protocol_version, int use_byte_order, void *scratchpad=NULL) const {
-			// write sample header
+		/// Serialize the header of a sample (its time stamp) to a stream buffer (protocol 1.10); the channel data must follow.
+		template<class StreamBuf> void save_header_streambuf(StreamBuf &sb, int use_byte_order) const {
 			if (timestamp == DEDUCED_TIMESTAMP) {
 				save_value(sb,TAG_DEDUCED_TIMESTAMP,use_byte_order);
 			} else {
 				save_value(sb,TAG_TRANSMITTED_TIMESTAMP,use_byte_order);
 				save_value(sb,timestamp,use_byte_order);
 			}
+		}
+
+		/// Serialize a sample to a stream buffer (protocol 1.10).
+		template<class StreamBuf> void save_streambuf(StreamBuf &sb, int protocol_version, int use_byte_order, void *scratchpad=NULL) const {
+			// write sample header
+			save_header_streambuf(sb,use_byte_order);
 			// write channel data
 			if (format_ == cf_string) {
 				for (std::string *p=(std::string*)&data_,*e=p+num_channels_; p<e; p++) {
@@ -320,6 +369,15 @@ namespace lsl {
 			}
 		}
 
+		/**
+		* Get the wire encoding of the sample (protocol 1.10) in a given byte order.
+		* The encoding is computed once and cached in the sample, so that it can be shared by all client sessions; 
+		* the sample must therefore not be modified anymore once it has been handed to the send buffer.
+		* Numeric channel data is copied straight into the encoding and converted there in place.
+		* @param use_byte_order The byte order to encode the sample in.
+		*/
+		encoded_sample_p encoded(int use_byte_order) const;
+
 		/// Deserialize a sample from a stream buffer (protocol 1.10).
 		template<class StreamBuf> void load_streambuf(StreamBuf &sb, int protocol_version, int use_byte_order, bool suppress_subnormals) {
 			// read sample header
@@ -358,37 +416,126 @@ namespace lsl {
 				load_raw(sb,&data_,format_sizes[format_]*num_channels_);
 				if (use_byte_order != BOOST_BYTE_ORDER && format_sizes[format_]>1)
 					convert_endian(&data_);
-				if (suppress_subnormals && format_float[format_]) {
-					if (format_ == cf_float32) {
-						for (boost::uint32_t *p=(boost::uint32_t*)&data_,*e=p+num_channels_; p<e; p++)
-							if (*p && ((*p & UINT32_C(0x7fffffff)) <= UINT32_C(0x007fffff)))
-								*p &= UINT32_C(0x80000000);
-					} else {
-#ifndef BOOST_NO_INT64_T
-						for (boost::uint64_t *p=(boost::uint64_t*)&data_,*e=p+num_channels_; p<e; p++)
-							if (*p && ((*p & UINT64_C(0x7fffffffffffffff)) <= UINT64_C(0x000fffffffffffff)))
-								*p &= UINT64_C(0x8000000000000000);
-#endif
-					}
+				if (suppress_subnormals)
+					flush_subnormals(format_,&data_,num_channels_);
+			}
+		}
+
+		/**
+		* Serialize a chunk of numeric samples to a stream buffer (protocol 1.20).
+		* A chunk has a single header, followed by the channel data of all samples in one contiguous block:
+		* [uint32: number of samples][double: time stamp of the first sample][uint32: number of further explicit time stamps]
+		* [(uint32: sample index, double: time stamp) for each further explicit time stamp][channel data of all samples]
+		* All other time stamps are deduced by the receiver.
+		* @param sb The stream buffer to write to.
+		* @param samples The samples of the chunk (at least one).
+		* @param num_samples The number of samples.
+		* @param use_byte_order The byte order to use.
+		* @param scratchpad Scratchpad memory that holds the channel data for the endian conversion (resized as needed).
+		*/
+		template<class StreamBuf> static void save_chunk_streambuf(StreamBuf &sb, const sample_p *samples, std::size_t num_samples, int use_byte_order, std::vector<char> &scratchpad) {
+			const sample &first = *samples[0];
+			std::size_t datasize = format_sizes[first.format_]*first.num_channels_;
+			save_chunk_header(sb,samples,num_samples,use_byte_order);
+			// write the channel data (gathered and converted in one go if the byte order differs)
+			if (use_byte_order == BOOST_BYTE_ORDER) {
+				for (std::size_t k=0; k<num_samples; k++)
+					save_raw(sb,&samples[k]->data_,datasize);
+			} else {
+				scratchpad.resize(std::max<std::size_t>(num_samples*datasize,1));
+				for (std::size_t k=0; k<num_samples; k++)
+					memcpy(&scratchpad[k*datasize],&samples[k]->data_,datasize);
+				reverse_byte_order(&scratchpad[0],format_sizes[first.format_],num_samples*first.num_channels_);
+				save_raw(sb,&scratchpad[0],num_samples*datasize);
+			}
+		}
+
+		/**
+		* Serialize only the header of a chunk of numeric samples (protocol 1.20).
+		* The channel data of the samples (in the given byte order) must follow; this allows the sender to transmit it straight 
+		* from the memory of the samples.
+		*/
+		template<class StreamBuf> static void save_chunk_header(StreamBuf &sb, const sample_p *samples, std::size_t num_samples, int use_byte_order) {
+			const sample &first = *samples[0];
+			boost::uint32_t num_explicit = 0;
+			for (std::size_t k=1; k<num_samples; k++)
+				if (samples[k]->timestamp != DEDUCED_TIMESTAMP)
+					num_explicit++;
+			save_value(sb,(boost::uint32_t)num_samples,use_byte_order);
+			save_value(sb,first.timestamp,use_byte_order);
+			save_value(sb,num_explicit,use_byte_order);
+			for (std::size_t k=1; k<num_samples; k++) {
+				if (samples[k]->timestamp != DEDUCED_TIMESTAMP) {
+					save_value(sb,(boost::uint32_t)k,use_byte_order);
+					save_value(sb,samples[k]->timestamp,use_byte_order);
 				}
 			}
 		}
 
-		/// Convert the endianness of channel data in-place.
-		void convert_endian(void *data) const {
-			switch (format_sizes[format_]) {
-				case 1: break;
-				case sizeof(boost::int16_t): for (boost::int16_t *p=(boost::int16_t*)data,*e=p+num_channels_; p<e; lslboost::endian::reverse(*p++)); break;
-				case sizeof(boost::int32_t): for (boost::int32_t *p=(boost::int32_t*)data,*e=p+num_channels_; p<e; lslboost::endian::reverse(*p++)); break;
-#ifndef BOOST_NO_INT64_T
-				case sizeof(boost::int64_t): for (boost::int64_t *p=(boost::int64_t*)data,*e=p+num_channels_; p<e; lslboost::endian::reverse(*p++)); break;
-#else
-				case sizeof(double): for (double *p=(double*)data,*e=p+num_channels_; p<e; lslboost::endian::reverse(*p++)); break;
-#endif
-				default: throw std::runtime_error("Unsupported channel format for endian conversion.");
+		/// Get the number of bytes that save_chunk_streambuf() writes for a chunk of samples.
+		static std::size_t chunk_bytes(const sample_p *samples, std::size_t num_samples) {
+			std::size_t result = 2*sizeof(boost::uint32_t) + sizeof(double) + num_samples*format_sizes[samples[0]->format_]*samples[0]->num_channels_;
+			for (std::size_t k=1; k<num_samples; k++)
+				if (samples[k]->timestamp != DEDUCED_TIMESTAMP)
+					result += sizeof(boost::uint32_t) + sizeof(double);
+			return result;
+		}
+
+		/**
+		* Deserialize a chunk of numeric samples from a stream buffer (protocol 1.20).
+		* @param sb The stream buffer to read from.
+		* @param fac The factory to allocate the samples from.
+		* @param use_byte_order The byte order of the data.
+		* @param suppress_subnormals Whether subnormal values shall be flushed to zero.
+		* @param scratchpad Scratchpad memory that receives the channel data (resized as needed).
+		* @param samples The vector to which the samples of the chunk are appended.
+		*/
+		template<class StreamBuf> static void load_chunk_streambuf(StreamBuf &sb, factory &fac, int use_byte_order, bool suppress_subnormals, std::vector<char> &scratchpad, std::vector<sample_p> &samples) {
+			std::size_t datasize = format_sizes[fac.format()]*fac.num_channels();
+			// read chunk header
+			boost::uint32_t num_samples, num_explicit;
+			double first_timestamp;
+			load_value(sb,num_samples,use_byte_order);
+			load_value(sb,first_timestamp,use_byte_order);
+			load_value(sb,num_explicit,use_byte_order);
+			if (!num_samples || num_explicit >= num_samples || num_samples > (1u<<30)/std::max<std::size_t>(datasize,1))
+				throw std::runtime_error("Stream contents corrupted (invalid chunk header).");
+			std::size_t begin = samples.size();
+			samples.reserve(begin+num_samples);
+			for (boost::uint32_t k=0; k<num_samples; k++)
+				samples.push_back(fac.new_sample(k ? DEDUCED_TIMESTAMP : first_timestamp,false));
+			for (boost::uint32_t k=0; k<num_explicit; k++) {
+				boost::uint32_t index; load_value(sb,index,use_byte_order);
+				if (!index || index >= num_samples)
+					throw std::runtime_error("Stream contents corrupted (invalid chunk header).");
+				load_value(sb,samples[begin+index]->timestamp,use_byte_order);
+			}
+			if (datasize >= direct_transfer_bytes) {
+				// large samples are read straight into their own memory
+				for (boost::uint32_t k=0; k<num_samples; k++) {
+					sample &s = *samples[begin+k];
+					load_raw(sb,&s.data_,datasize);
+					if (use_byte_order != BOOST_BYTE_ORDER)
+						s.convert_endian(&s.data_);
+					if (suppress_subnormals)
+						flush_subnormals(fac.format(),&s.data_,fac.num_channels());
+				}
+				return;
 			}
+			// read the channel data in one go and distribute it over the samples
+			scratchpad.resize(std::max<std::size_t>(num_samples*datasize,1));
+			load_raw(sb,&scratchpad[0],num_samples*datasize);
+			if (use_byte_order != BOOST_BYTE_ORDER)
+				reverse_byte_order(&scratchpad[0],format_sizes[fac.format()],num_samples*fac.num_channels());
+			if (suppress_subnormals)
+				flush_subnormals(fac.format(),&scratchpad[0],num_samples*fac.num_channels());
+			for (boost::uint32_t k=0; k<num_samples; k++)
+				memcpy(&samples[begin+k]->data_,&scratchpad[k*datasize],datasize);
 		}
 
+		/// Convert the endianness of channel data in-place.
+		void convert_endian(void *data) const { reverse_byte_order(data,format_sizes[format_],num_channels_); }
+
 		/// Serialize a sample into a portable archive (protocol 1.00).
 		template<class Archive> void save(Archive &ar, const unsigned int archive_version) const {
 			// write sample header
@@ -439,21 +586,34 @@ namespace lsl {
 
 	private:
 		/// Construct a new sample for a given channel format/count combination.
-		sample(channel_format_t fmt, int num_channels, factory *fact): format_(fmt), num_channels_(num_channels), refcount_(0), next_(NULL), factory_(fact) { 
+		sample(channel_format_t fmt, int num_channels, factory *fact): format_(fmt), num_channels_(num_channels), refcount_(0), chunk_next_(NULL), factory_(fact) { 
+			encoded_[0] = encoded_[1] = NULL;
 			if (format_ == cf_string)
 				for (std::string *p=(std::string*)&data_,*e=p+num_channels_; p<e; new(p++)std::string());
 		}
 
+		/// Drop the cached wire encodings, if any.
+		void release_encoded() {
+			for (int k=0;k<2;k++)
+				if (encoded_sample *e = encoded_[k].exchange(NULL,boost::memory_order_acquire))
+					intrusive_ptr_release(e);
+		}
+
 		/// Increment ref count.
 		friend void intrusive_ptr_add_ref(sample *s) {
 			s->refcount_.fetch_add(1,boost::memory_order_relaxed);
 		}
 
 		/// Decrement ref count and reclaim if unreferenced.
+		/// If the sample is the head of a chunk, the remainder of the chunk is released iteratively (rather than recursively).
 		friend void intrusive_ptr_release(sample *s) {
-			if (s->refcount_.fetch_sub(1,boost::memory_order_release) == 1) {
+			while (s && s->refcount_.fetch_sub(1,boost::memory_order_release) == 1) {
 				boost::atomic_thread_fence(boost::memory_order_acquire);
+				sample *next = s->chunk_next_;
+				s->chunk_next_ = NULL;
+				s->release_encoded();
 				s->factory_->reclaim_sample(s);
+				s = next;
 			}
 		}
 	};
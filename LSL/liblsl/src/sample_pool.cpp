@@ -0,0 +1,160 @@
+#include "sample_pool.h"
+#include <map>
+#include <boost/weak_ptr.hpp>
+#include <boost/functional/hash.hpp>
+
+
+// === implementation of the sample_pool class ===
+
+using namespace lsl;
+
+namespace {
+	/// The registry of pools, by block size.
+	typedef std::map<std::size_t,boost::weak_ptr<sample_pool> > pool_registry;
+
+	boost::once_flag registry_once = BOOST_ONCE_INIT;
+	boost::mutex *registry_mut = NULL;
+	pool_registry *registry = NULL;
+
+	/// Create the registry (called once).
+	void create_registry() {
+		registry_mut = new boost::mutex();
+		registry = new pool_registry();
+	}
+}
+
+/**
+* Get the (shared) pool for blocks of a given size.
+* @param block_size The size of the blocks, in bytes.
+* @param num_reserve The number of blocks that the caller expects to need; the pool is grown accordingly.
+*/
+sample_pool_p sample_pool::get(std::size_t block_size, std::size_t num_reserve) {
+	boost::call_once(&create_registry,registry_once);
+	sample_pool_p result;
+	{
+		boost::lock_guard<boost::mutex> lock(*registry_mut);
+		boost::weak_ptr<sample_pool> &entry = (*registry)[block_size];
+		result = entry.lock();
+		if (!result) {
+			// drop any other expired entries while we're at it
+			for (pool_registry::iterator i=registry->begin(); i!=registry->end();)
+				if (i->second.expired() && i->first != block_size)
+					registry->erase(i++);
+				else
+					i++;
+			result.reset(new sample_pool(block_size));
+			entry = result;
+		}
+	}
+	if (num_reserve)
+		result->reserve(num_reserve);
+	return result;
+}
+
+/// Create a new pool for a given block size.
+sample_pool::sample_pool(std::size_t block_size): block_size_(std::max(block_size,sizeof(free_block))), 
+	cache_blocks_(2*std::max<std::size_t>(1,std::min<std::size_t>(cache_capacity,max_cache_bytes/block_size_)/2)), slab_blocks_(std::max<std::size_t>(1,std::min<std::size_t>(min_slab_blocks,max_slab_bytes/block_size_))),
+	global_head_(NULL), global_count_(0), capacity_(0), reserved_(0), in_use_(0), peak_in_use_(0) { }
+
+/// Destructor. Frees all slabs.
+sample_pool::~sample_pool() {
+	for (std::size_t k=0;k<slabs_.size();k++)
+		delete[] slabs_[k];
+}
+
+/// Allocate a block of memory from the pool.
+void *sample_pool::allocate() {
+	block_cache &cache = this_thread_cache();
+	free_block *result;
+	{
+		boost::lock_guard<boost::mutex> lock(cache.mut);
+		if (!cache.head) {
+			// refill the cache with a batch of blocks from the central freelist (growing the pool if necessary)
+			boost::lock_guard<boost::mutex> global_lock(global_mut_);
+			if (global_count_ < cache_blocks_/2)
+				grow(std::max(slab_blocks_,capacity_/2));
+			for (std::size_t k=0; k<cache_blocks_/2; k++) {
+				free_block *b = global_head_;
+				global_head_ = b->next;
+				b->next = cache.head;
+				cache.head = b;
+			}
+			global_count_ -= cache_blocks_/2;
+			cache.count += cache_blocks_/2;
+		}
+		result = cache.head;
+		cache.head = result->next;
+		cache.count--;
+	}
+	// update the usage statistics
+	std::size_t in_use = in_use_.fetch_add(1,boost::memory_order_relaxed)+1, peak = peak_in_use_.load(boost::memory_order_relaxed);
+	while (in_use > peak && !peak_in_use_.compare_exchange_weak(peak,in_use,boost::memory_order_relaxed));
+	return result;
+}
+
+/// Return a block of memory to the pool.
+void sample_pool::release(void *block) {
+	in_use_.fetch_sub(1,boost::memory_order_relaxed);
+	block_cache &cache = this_thread_cache();
+	boost::lock_guard<boost::mutex> lock(cache.mut);
+	free_block *b = (free_block*)block;
+	b->next = cache.head;
+	cache.head = b;
+	if (++cache.count > cache_blocks_) {
+		// the cache is full: hand half of it back to the central freelist
+		boost::lock_guard<boost::mutex> global_lock(global_mut_);
+		for (std::size_t k=0; k<cache_blocks_/2; k++) {
+			b = cache.head;
+			cache.head = b->next;
+			b->next = global_head_;
+			global_head_ = b;
+		}
+		cache.count -= cache_blocks_/2;
+		global_count_ += cache_blocks_/2;
+	}
+}
+
+/// Reserve a number of blocks for a new user of the pool; the pool grows so that it can serve all reservations without growing further.
+void sample_pool::reserve(std::size_t num_blocks) {
+	boost::lock_guard<boost::mutex> lock(global_mut_);
+	reserved_ += num_blocks;
+	if (capacity_ < reserved_)
+		grow(std::max(slab_blocks_,reserved_-capacity_));
+}
+
+/// Cancel a reservation made by reserve() (when its user goes away); the blocks remain in the pool and serve later reservations.
+void sample_pool::unreserve(std::size_t num_blocks) {
+	boost::lock_guard<boost::mutex> lock(global_mut_);
+	reserved_ -= std::min(num_blocks,reserved_);
+}
+
+/// Get the usage statistics of the pool.
+sample_pool::usage_info sample_pool::usage() {
+	boost::lock_guard<boost::mutex> lock(global_mut_);
+	usage_info result;
+	result.block_size = block_size_;
+	result.num_slabs = slabs_.size();
+	result.capacity = capacity_;
+	result.in_use = in_use_.load(boost::memory_order_relaxed);
+	result.peak_in_use = peak_in_use_.load(boost::memory_order_relaxed);
+	return result;
+}
+
+/// Get the cache of the calling thread.
+sample_pool::block_cache &sample_pool::this_thread_cache() {
+	std::size_t h = boost::hash<boost::thread::id>()(boost::this_thread::get_id());
+	return caches_[((h >> 4) ^ (h >> 12)) % num_caches];
+}
+
+/// Allocate a new slab with the given number of blocks and put them into the central freelist.
+void sample_pool::grow(std::size_t num_blocks) {
+	char *slab = new char[block_size_*num_blocks];
+	slabs_.push_back(slab);
+	capacity_ += num_blocks;
+	for (std::size_t k=num_blocks; k-- > 0;) {
+		free_block *b = (free_block*)(slab + k*block_size_);
+		b->next = global_head_;
+		global_head_ = b;
+	}
+	global_count_ += num_blocks;
+}
@@ -0,0 +1,105 @@
+#ifndef SAMPLE_POOL_H
+#define SAMPLE_POOL_H
+
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace lsl {
+
+	/// shared pointer to a sample pool
+	typedef boost::shared_ptr<class sample_pool> sample_pool_p;
+
+	/**
+	* A thread-safe pool of fixed-size memory blocks from which samples (and their wire encodings) are allocated.
+	* The pool grows by whole slabs of blocks and never returns memory to the heap before it is destroyed, so that
+	* steady-state streaming does not do any heap allocations. Blocks are handed out through a small number of caches
+	* that are selected by a hash of the calling thread's id, so that multiple producer threads (and the threads that
+	* release samples) rarely contend; only when a cache runs empty or full is a batch of blocks exchanged with the
+	* pool's central freelist. Pools are shared by all users that need blocks of the same size (e.g., all outlets and
+	* inlets whose samples have the same size in memory).
+	*/
+	class sample_pool: private boost::noncopyable {
+	public:
+		/// Usage statistics of a pool.
+		struct usage_info {
+			std::size_t block_size;		// size of the blocks, in bytes
+			std::size_t num_slabs;		// number of slabs allocated so far
+			std::size_t capacity;		// total number of blocks in all slabs
+			std::size_t in_use;			// number of blocks currently handed out
+			std::size_t peak_in_use;	// maximum number of blocks that were handed out at the same time
+		};
+
+		/**
+		* Get the (shared) pool for blocks of a given size.
+		* @param block_size The size of the blocks, in bytes.
+		* @param num_reserve The number of blocks that the caller expects to need; the pool is grown accordingly.
+		*/
+		static sample_pool_p get(std::size_t block_size, std::size_t num_reserve=0);
+
+		/// Destructor. Frees all slabs (all blocks must have been released at this point).
+		~sample_pool();
+
+		/// Allocate a block of memory from the pool.
+		void *allocate();
+
+		/// Return a block of memory to the pool.
+		void release(void *block);
+
+		/// Reserve a number of blocks for a new user of the pool; the pool grows so that it can serve all reservations without growing further.
+		void reserve(std::size_t num_blocks);
+
+		/// Cancel a reservation made by reserve() (when its user goes away); the blocks remain in the pool and serve later reservations.
+		void unreserve(std::size_t num_blocks);
+
+		/// Get the size of the blocks in this pool.
+		std::size_t block_size() const { return block_size_; }
+
+		/// Get the usage statistics of the pool.
+		usage_info usage();
+
+	private:
+		/// A free block (the link is stored in the block itself).
+		struct free_block { free_block *next; };
+
+		/// A cache of free blocks that is used by a subset of threads.
+		struct block_cache {
+			block_cache(): head(NULL), count(0) {}
+			boost::mutex mut;			// mutex protecting the cache (practically uncontended)
+			free_block *head;			// the cached blocks
+			std::size_t count;			// number of cached blocks
+			char padding[64];			// keeps the caches on separate cache lines
+		};
+
+		// number of caches, the number of blocks that a cache holds at most, and the minimum number of blocks per slab
+		// (the latter two are scaled down for large blocks so that a cache holds at most max_cache_bytes and a slab is not larger than max_slab_bytes)
+		enum { num_caches = 16, cache_capacity = 64, min_slab_blocks = 32, max_cache_bytes = 1024*1024, max_slab_bytes = 4*1024*1024 };
+
+		/// Create a new pool for a given block size.
+		sample_pool(std::size_t block_size);
+
+		/// Get the cache of the calling thread.
+		block_cache &this_thread_cache();
+
+		/// Allocate a new slab with the given number of blocks and put them into the central freelist (global_mut_ must be held).
+		void grow(std::size_t num_blocks);
+
+		std::size_t block_size_;				// size of the blocks, in bytes
+		std::size_t cache_blocks_;				// the number of blocks that a cache holds at most (even)
+		std::size_t slab_blocks_;				// the minimum number of blocks per slab
+		block_cache caches_[num_caches];		// the block caches
+		boost::mutex global_mut_;				// mutex protecting the central freelist and the slabs
+		free_block *global_head_;				// central freelist
+		std::size_t global_count_;				// number of blocks in the central freelist
+		std::vector<char*> slabs_;				// the slabs that we have allocated
+		std::size_t capacity_;					// total number of blocks in all slabs
+		std::size_t reserved_;					// total number of blocks reserved by the users of the pool
+		boost::atomic<std::size_t> in_use_;		// number of blocks currently handed out
+		boost::atomic<std::size_t> peak_in_use_;// maximum number of blocks handed out at the same time
+	};
+
+}
+
+#endif
@@ -9,8 +9,9 @@ using namespace lsl;
 /**
 * Create a new send buffer.
 * @param max_capacity Hard upper bound on queue capacity beyond which the oldest samples will be dropped.
+* @param srate The nominal sampling rate of the stream (used to deduce time stamps for the inlets in the same process).
 */
-send_buffer::send_buffer(int max_capacity): max_capacity_(max_capacity) {} 
+send_buffer::send_buffer(int max_capacity, double srate): max_capacity_(max_capacity), srate_(srate), last_timestamp_(0.0) {} 
 
 
 /**
@@ -32,9 +33,25 @@ consumer_queue_p send_buffer::new_consumer(int max_buffered) {
 * Will subsequently be seen by all consumers.
 */
 void send_buffer::push_sample(const sample_p &s) {
+	// the queues count all samples of a chunk against their capacity
+	std::size_t num_samples = 0;
+	for (sample *smp=s.get(); smp; smp=smp->next_in_chunk())
+		num_samples++;
 	boost::lock_guard<boost::mutex> lock(consumers_mut_);
 	for (consumer_set::iterator i=consumers_.begin(); i != consumers_.end(); i++)
-		(*i)->push_sample(s);
+		(*i)->push_sample(s,std::max(num_samples,(std::size_t)1));
+	for (sample *smp=s.get(); smp; smp=smp->next_in_chunk()) {
+		// deduce the time stamp as the data thread of an inlet would on receipt (the sample itself is shared and stays as is)
+		double timestamp = smp->timestamp;
+		if (timestamp == DEDUCED_TIMESTAMP) {
+			timestamp = last_timestamp_;
+			if (srate_ != IRREGULAR_RATE)
+				timestamp += 1.0/srate_;
+		}
+		last_timestamp_ = timestamp;
+		for (consumer_set::iterator i=direct_consumers_.begin(); i != direct_consumers_.end(); i++)
+			(*i)->push_sample(sample_p(smp),1,timestamp);
+	}
 }
 
 
@@ -53,6 +70,25 @@ void send_buffer::unregister_consumer(consumer_queue *q) {
 	consumers_.erase(q);
 }
 
+/**
+* Attach the sample queue of an inlet in the same process directly to the buffer.
+* The queue gets every subsequently pushed sample by reference (chunks are split into their samples).
+* It must be detached again before it is destroyed.
+*/
+void send_buffer::attach_direct(consumer_queue *q) {
+	{
+		boost::lock_guard<boost::mutex> lock(consumers_mut_);
+		direct_consumers_.insert(q);
+	}
+	some_registered_.notify_all();
+}
+
+/// Detach a previously attached sample queue (no samples are pushed into it after this returns).
+void send_buffer::detach_direct(consumer_queue *q) {
+	boost::lock_guard<boost::mutex> lock(consumers_mut_);
+	direct_consumers_.erase(q);
+}
+
 /// Check whether there currently are consumers.
 bool send_buffer::have_consumers() {
 	boost::lock_guard<boost::mutex> lock(consumers_mut_);
@@ -25,8 +25,9 @@ namespace lsl {
 		/**
 		* Create a new send buffer.
 		* @param max_capacity Hard upper bound on queue capacity beyond which the oldest samples will be dropped.
+		* @param srate The nominal sampling rate of the stream (used to deduce time stamps for the inlets in the same process).
 		*/
-		send_buffer(int max_capacity);
+		send_buffer(int max_capacity, double srate=IRREGULAR_RATE);
 
 		/**
 		* Add a new consumer queue to the buffer.
@@ -51,6 +52,17 @@ namespace lsl {
 		/// Check whether any consumer is currently registered.
 		bool have_consumers();
 
+		/**
+		* Attach the sample queue of an inlet in the same process directly to the buffer.
+		* The queue gets every subsequently pushed sample by reference (chunks are split into their samples); since the samples
+		* are shared, deduced time stamps are resolved here and queued alongside the samples (see consumer_queue::push_sample()).
+		* It must be detached again before it is destroyed.
+		*/
+		void attach_direct(consumer_queue *q);
+
+		/// Detach a previously attached sample queue (no samples are pushed into it after this returns).
+		void detach_direct(consumer_queue *q);
+
 	private:
 		friend class consumer_queue;
 
@@ -60,10 +72,13 @@ namespace lsl {
 		void unregister_consumer(consumer_queue *q);
 
 		/// wait_for_consumers is waiting for this
-		bool some_registered() const { return !consumers_.empty(); }
+		bool some_registered() const { return !consumers_.empty() || !direct_consumers_.empty(); }
 
 		int max_capacity_;							// maximum capacity beyond which the oldest samples will be dropped
+		double srate_;								// nominal sampling rate of the stream
+		double last_timestamp_;						// time stamp of the most recently pushed sample (protected by consumers_mut_)
 		consumer_set consumers_;					// a set of registered consumer queues
+		consumer_set direct_consumers_;				// the sample queues of inlets in the same process
 		boost::mutex consumers_mut_;				// mutex to protect the integrity of consumers_
 		boost::condition_variable some_registered_;	// condition variable signaling that a consumer has registered
 	};
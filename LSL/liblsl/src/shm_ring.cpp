@@ -0,0 +1,244 @@
+#include "shm_ring.h"
+#include <cstring>
+#include <climits>
+#include <stdexcept>
+#include <boost/static_assert.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <boost/lexical_cast.hpp>
+
+#ifdef __linux__
+	#include <cerrno>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <sys/syscall.h>
+	#include <linux/futex.h>
+	#include <time.h>
+#endif
+
+
+// === implementation of the shm_ring class ===
+
+using namespace lsl;
+
+/// The header of a ring; lives at the beginning of the shared memory (the positions are monotonic byte counters).
+struct shm_ring::header {
+	boost::uint32_t magic;							// identifies a valid ring (written last by the creator)
+	boost::uint32_t header_size;					// the size of this header, i.e., the offset of the ring storage
+	boost::uint64_t capacity;						// the capacity of the ring, in bytes (a power of two)
+	char pad0_[48];
+	boost::atomic<boost::uint64_t> write_pos;		// the position up to which data has been published by the writer
+	char pad1_[56];
+	boost::atomic<boost::uint64_t> read_pos;		// the position up to which data has been consumed by the reader
+	char pad2_[56];
+	boost::atomic<boost::uint32_t> data_seq;		// incremented whenever data is published or the writer closes (the futex word of the reader)
+	boost::atomic<boost::uint32_t> reader_waiting;	// whether the reader is (about to be) asleep on data_seq
+	boost::atomic<boost::uint32_t> writer_closed;	// whether the writer has detached
+	boost::atomic<boost::uint32_t> reader_closed;	// whether the reader has detached
+};
+
+namespace {
+	// the futex word must be a plain 32-bit integer
+	BOOST_STATIC_ASSERT(sizeof(boost::atomic<boost::uint32_t>) == sizeof(boost::uint32_t));
+
+	/// Magic number of a valid ring ("LSLR").
+	const boost::uint32_t ring_magic = 0x4C534C52;
+
+	/// The offset of the ring storage.
+	const std::size_t storage_offset = 256;
+
+	/// Maximum time that a reader sleeps before re-checking its state, in nanoseconds.
+	const long max_wait_ns = 100000000;
+
+	/// Prefix of the names of all rings.
+	const char *name_prefix = "/lsl-";
+
+#ifdef __linux__
+	/// Sleep on a futex word in shared memory while it has the given value (or until the timeout expires).
+	void futex_wait(boost::atomic<boost::uint32_t> *word, boost::uint32_t value) {
+		timespec timeout = {0,max_wait_ns};
+		syscall(SYS_futex,(int*)word,FUTEX_WAIT,(int)value,&timeout,NULL,0);
+	}
+
+	/// Wake up all threads that sleep on a futex word in shared memory.
+	void futex_wake(boost::atomic<boost::uint32_t> *word) {
+		syscall(SYS_futex,(int*)word,FUTEX_WAKE,INT_MAX,NULL,NULL,0);
+	}
+#endif
+}
+
+/// Whether shared-memory rings are supported on this platform.
+bool shm_ring::supported() {
+#ifdef __linux__
+	return boost::atomic<boost::uint64_t>().is_lock_free() && boost::atomic<boost::uint32_t>().is_lock_free();
+#else
+	return false;
+#endif
+}
+
+/**
+* Create a new ring (writer side).
+* @param capacity The minimum capacity of the ring, in bytes (rounded up to a power of two).
+* @throws std::runtime_error if the shared memory could not be created.
+*/
+shm_ring_p shm_ring::create(std::size_t capacity) {
+#ifdef __linux__
+	BOOST_STATIC_ASSERT(sizeof(header) <= storage_offset);
+	std::size_t rounded = 4096;
+	while (rounded < capacity)
+		rounded *= 2;
+	// create a new shared-memory object under a unique name
+	std::string name = name_prefix + boost::lexical_cast<std::string>(boost::uuids::random_generator()());
+	int fd = shm_open(name.c_str(),O_CREAT|O_EXCL|O_RDWR,0600);
+	if (fd < 0)
+		throw std::runtime_error("Could not create a shared-memory ring: " + std::string(strerror(errno)));
+	void *memory = MAP_FAILED;
+	if (ftruncate(fd,(off_t)(storage_offset+rounded)) == 0)
+		memory = mmap(NULL,storage_offset+rounded,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	close(fd);
+	if (memory == MAP_FAILED) {
+		shm_unlink(name.c_str());
+		throw std::runtime_error("Could not map a shared-memory ring.");
+	}
+	// initialize the header (the memory is zero-filled); the magic number is written last
+	header *hdr = new(memory) header();
+	hdr->header_size = storage_offset;
+	hdr->capacity = rounded;
+	boost::atomic_thread_fence(boost::memory_order_release);
+	hdr->magic = ring_magic;
+	return shm_ring_p(new shm_ring(name,memory,storage_offset+rounded,true));
+#else
+	throw std::runtime_error("Shared-memory rings are not supported on this platform.");
+#endif
+}
+
+/**
+* Attach to an existing ring (reader side).
+* @param name The name of the ring, as announced by the writer.
+* @throws std::runtime_error if the shared memory could not be opened (e.g., when it is on another host or belongs to another user).
+*/
+shm_ring_p shm_ring::open(const std::string &name) {
+#ifdef __linux__
+	// only accept names of rings (the name is under the control of the other party)
+	if (name.compare(0,strlen(name_prefix),name_prefix) != 0 || name.find('/',1) != std::string::npos)
+		throw std::runtime_error("Invalid shared-memory ring name: " + name);
+	int fd = shm_open(name.c_str(),O_RDWR,0);
+	if (fd < 0)
+		throw std::runtime_error("Could not open the shared-memory ring " + name + ": " + strerror(errno));
+	struct stat st;
+	void *memory = MAP_FAILED;
+	if (fstat(fd,&st) == 0 && (std::size_t)st.st_size > storage_offset)
+		memory = mmap(NULL,(std::size_t)st.st_size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	close(fd);
+	if (memory == MAP_FAILED)
+		throw std::runtime_error("Could not map the shared-memory ring " + name + ".");
+	// validate the header
+	header *hdr = (header*)memory;
+	boost::uint64_t capacity = hdr->capacity;
+	if (hdr->magic != ring_magic || hdr->header_size != storage_offset || !capacity || (capacity & (capacity-1)) || storage_offset+capacity != (std::size_t)st.st_size) {
+		munmap(memory,(std::size_t)st.st_size);
+		throw std::runtime_error("The shared-memory ring " + name + " is malformed.");
+	}
+	boost::atomic_thread_fence(boost::memory_order_acquire);
+	// the name is no longer needed once both parties are attached
+	shm_unlink(name.c_str());
+	return shm_ring_p(new shm_ring(name,memory,(std::size_t)st.st_size,false));
+#else
+	throw std::runtime_error("Shared-memory rings are not supported on this platform.");
+#endif
+}
+
+/// Constructor (use create() or open()).
+shm_ring::shm_ring(const std::string &name, void *memory, std::size_t mapped_size, bool writer): name_(name), memory_(memory), mapped_size_(mapped_size),
+	header_((header*)memory), data_((char*)memory + storage_offset), mask_((std::size_t)header_->capacity-1), writer_(writer), position_(writer ? header_->write_pos.load() : header_->read_pos.load()), cancelled_(false) { }
+
+/// Destructor. Marks our end of the ring as closed and unmaps the memory.
+shm_ring::~shm_ring() {
+	unregister_from_all();
+#ifdef __linux__
+	if (writer_) {
+		header_->writer_closed.store(1);
+		header_->data_seq.fetch_add(1);
+		futex_wake(&header_->data_seq);
+		shm_unlink(name_.c_str());
+	} else
+		header_->reader_closed.store(1);
+	munmap(memory_,mapped_size_);
+#endif
+}
+
+
+// === writer side ===
+
+/// The number of bytes that can currently be written without overwriting unread data.
+std::size_t shm_ring::free_space() const {
+	return (std::size_t)(mask_ + 1 - (position_ - header_->read_pos.load(boost::memory_order_acquire)));
+}
+
+/// Write data at the current write position (not visible to the reader until publish() is called; the caller must ensure that there is enough free space).
+std::streamsize shm_ring::sputn(const char *data, std::streamsize n) {
+	std::size_t offset = (std::size_t)position_ & mask_, first = std::min((std::size_t)n,mask_+1-offset);
+	memcpy(data_+offset,data,first);
+	memcpy(data_,data+first,(std::size_t)n-first);
+	position_ += n;
+	return n;
+}
+
+/// Make all data written so far visible to the reader (and wake it up if necessary).
+void shm_ring::publish() {
+	header_->write_pos.store(position_);
+	header_->data_seq.fetch_add(1);
+	if (header_->reader_waiting.load())
+		wake_reader();
+}
+
+/// Whether the reader has detached from the ring.
+bool shm_ring::reader_closed() const { return header_->reader_closed.load() != 0; }
+
+/// Wake up a reader that waits for data.
+void shm_ring::wake_reader() {
+#ifdef __linux__
+	futex_wake(&header_->data_seq);
+#endif
+}
+
+
+// === reader side ===
+
+/// Read data from the ring, waiting until it is available; returns fewer bytes only if the ring was closed or the read was cancelled.
+std::streamsize shm_ring::sgetn(char *data, std::streamsize n) {
+	std::streamsize done = 0;
+	while (done < n) {
+		boost::uint32_t seq = header_->data_seq.load(boost::memory_order_acquire);
+		if (std::size_t available = (std::size_t)(header_->write_pos.load(boost::memory_order_acquire) - position_)) {
+			// copy what we can and release the space to the writer
+			std::size_t count = std::min(available,(std::size_t)(n-done)), offset = (std::size_t)position_ & mask_, first = std::min(count,mask_+1-offset);
+			memcpy(data+done,data_+offset,first);
+			memcpy(data+done+first,data_,count-first);
+			position_ += count;
+			header_->read_pos.store(position_,boost::memory_order_release);
+			done += count;
+			continue;
+		}
+		if (cancelled_ || header_->writer_closed.load())
+			break;
+		// announce that we are going to sleep, then re-check before actually doing so (the writer checks in reverse order)
+		header_->reader_waiting.store(1);
+		if (header_->write_pos.load() == position_ && !cancelled_) {
+#ifdef __linux__
+			futex_wait(&header_->data_seq,seq);
+#endif
+		}
+		header_->reader_waiting.store(0);
+	}
+	return done;
+}
+
+/// Cancel any blocking read (and all future reads).
+void shm_ring::cancel() {
+	cancelled_ = true;
+	wake_reader();
+}
@@ -0,0 +1,94 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <string>
+#include <boost/cstdint.hpp>
+#include <boost/atomic.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include "cancellation.h"
+
+namespace lsl {
+
+	/// shared pointer to a shared-memory ring
+	typedef boost::shared_ptr<class shm_ring> shm_ring_p;
+
+	/**
+	* A single-producer/single-consumer byte ring in shared memory, which carries the data feed from an outlet to an inlet
+	* on the same host (instead of a loopback TCP connection).
+	* The outlet session creates the ring and announces its name in the feed negotiation; the inlet attaches to it and reads
+	* the chunks (protocol 1.20) that the session writes into it. The writer never blocks (it checks free_space() before writing
+	* a chunk), whereas the reader sleeps on a futex in the shared header until enough data has been published.
+	* The TCP connection that negotiated the ring is kept open and determines the lifetime of the feed.
+	* Shared-memory rings are currently only supported on Linux.
+	*/
+	class shm_ring: public cancellable_obj, private boost::noncopyable {
+	public:
+		/// Whether shared-memory rings are supported on this platform.
+		static bool supported();
+
+		/**
+		* Create a new ring (writer side).
+		* @param capacity The minimum capacity of the ring, in bytes (rounded up to a power of two).
+		* @throws std::runtime_error if the shared memory could not be created.
+		*/
+		static shm_ring_p create(std::size_t capacity);
+
+		/**
+		* Attach to an existing ring (reader side).
+		* @param name The name of the ring, as announced by the writer.
+		* @throws std::runtime_error if the shared memory could not be opened (e.g., when it is on another host or belongs to another user).
+		*/
+		static shm_ring_p open(const std::string &name);
+
+		/// Destructor. Marks our end of the ring as closed and unmaps the memory.
+		~shm_ring();
+
+		/// The name of the ring.
+		const std::string &name() const { return name_; }
+
+		// === writer side ===
+
+		/// The number of bytes that can currently be written without overwriting unread data.
+		std::size_t free_space() const;
+
+		/// Write data at the current write position (not visible to the reader until publish() is called; the caller must ensure that there is enough free space).
+		std::streamsize sputn(const char *data, std::streamsize n);
+
+		/// Make all data written so far visible to the reader (and wake it up if necessary).
+		void publish();
+
+		/// Whether the reader has detached from the ring.
+		bool reader_closed() const;
+
+		// === reader side ===
+
+		/// Read data from the ring, waiting until it is available; returns fewer bytes only if the ring was closed or the read was cancelled.
+		std::streamsize sgetn(char *data, std::streamsize n);
+
+		/// Cancel any blocking read (and all future reads).
+		virtual void cancel();
+
+	private:
+		struct header;
+
+		/// Constructor (use create() or open()).
+		shm_ring(const std::string &name, void *memory, std::size_t mapped_size, bool writer);
+
+		/// Wake up a reader that waits for data.
+		void wake_reader();
+
+		std::string name_;				// the name of the shared-memory object
+		void *memory_;					// the mapped memory
+		std::size_t mapped_size_;		// the number of bytes mapped
+		header *header_;				// the header at the beginning of the mapped memory
+		char *data_;					// the ring storage
+		std::size_t mask_;				// capacity-1 (the capacity is a power of two)
+		bool writer_;					// whether we are the writer (otherwise the reader)
+		boost::uint64_t position_;		// our (unpublished) write position or our read position
+		boost::atomic<bool> cancelled_;	// whether reads have been cancelled
+	};
+
+}
+
+#endif
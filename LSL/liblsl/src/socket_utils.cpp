@@ -1,18 +1,62 @@
 #include "socket_utils.h"
 #include "endian/conversion.hpp"
 #include "common.h"
+#include "value_conversion.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef __linux__
+	#include <time.h>
+	#include <sys/socket.h>
+#endif
 
 
 // === Implementation of the socket utils ===
 
 using namespace lsl;
 
-/// Measure the endian conversion performance of this machine.
+/// Measure the endian conversion performance of this machine (number of values converted in 10ms).
 double lsl::measure_endian_performance() {
 	const double measure_duration = 0.01;
-	double data=12335.5, t_end=lsl_clock() + measure_duration;
+	const std::size_t block_size = 256;
+	double data[block_size], t_end=lsl_clock() + measure_duration;
+	std::fill(data,data+block_size,12335.5);
 	double k;
-	for (k=0; ((int)k & 0xFF) != 0 || lsl_clock()<t_end; k++)
-		lslboost::endian::reverse_value(data);
+	for (k=0; lsl_clock()<t_end; k+=block_size)
+		reverse_byte_order(data,sizeof(double),block_size);
 	return k;
 }
+
+/// Have the kernel stamp the packets that a UDP socket receives (where supported and enabled in the configuration); returns whether it does.
+bool lsl::enable_receive_timestamps(boost::asio::ip::udp::socket &sock) {
+#ifdef __linux__
+	if (!api_config::get_instance()->kernel_timestamps())
+		return false;
+	int enable = 1;
+	return setsockopt(sock.native_handle(),SOL_SOCKET,SO_TIMESTAMPNS,&enable,sizeof(enable)) == 0;
+#else
+	return false;
+#endif
+}
+
+#ifdef __linux__
+/**
+* Get the kernel receive time stamp of a packet that was received with recvmsg() or recvmmsg() (on a socket with receive
+* time stamps enabled), mapped onto the lsl_clock() timebase; returns 0 if the packet carries no (plausible) time stamp.
+*/
+double lsl::kernel_receive_time(const msghdr &msg) {
+	for (cmsghdr *cmsg=CMSG_FIRSTHDR(const_cast<msghdr*>(&msg)); cmsg; cmsg=CMSG_NXTHDR(const_cast<msghdr*>(&msg),cmsg)) {
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+			timespec stamp, now;
+			memcpy(&stamp,CMSG_DATA(cmsg),sizeof(stamp));
+			// the stamp is in wall-clock time: map it via the current difference between the wall clock and lsl_clock()
+			double local_now = lsl_clock();
+			clock_gettime(CLOCK_REALTIME,&now);
+			double age = (now.tv_sec - stamp.tv_sec) + (now.tv_nsec - stamp.tv_nsec)/1000000000.0;
+			// (a step of the wall clock in between would make the stamp implausible)
+			return (age >= 0 && age < 1.0) ? local_now - age : 0.0;
+		}
+	}
+	return 0.0;
+}
+#endif
@@ -7,6 +7,11 @@
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
 
+#ifdef __linux__
+	#include <sys/socket.h>
+	#include <time.h>
+#endif
+
 namespace lsl {
     
     /// Bind a socket (or acceptor) to a free port in the configured port range or throw an error otherwise.
@@ -78,6 +83,23 @@ namespace lsl {
 
 	/// Measure the endian conversion performance of this machine.
 	double measure_endian_performance();
+
+	/// Have the kernel stamp the packets that a UDP socket receives (where supported and enabled in the configuration); returns whether it does.
+	bool enable_receive_timestamps(boost::asio::ip::udp::socket &sock);
+
+#ifdef __linux__
+	/**
+	* Get the kernel receive time stamp of a packet that was received with recvmsg() or recvmmsg() (on a socket with receive
+	* time stamps enabled), mapped onto the lsl_clock() timebase; returns 0 if the packet carries no (plausible) time stamp.
+	*/
+	double kernel_receive_time(const msghdr &msg);
+
+	/// A buffer for the control data of a received packet that has room for a receive time stamp (aligned for the cmsghdr inside it).
+	union receive_time_control {
+		cmsghdr align;
+		char buf[CMSG_SPACE(sizeof(timespec))];
+	};
+#endif
 }
 
 #endif
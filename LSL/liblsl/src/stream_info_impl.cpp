@@ -14,7 +14,7 @@ using std::string;
 using boost::lexical_cast;
 
 /// Default Constructor.
-stream_info_impl::stream_info_impl(): channel_count_(0), nominal_srate_(0), channel_format_(cf_undefined), version_(0), v4data_port_(0), v4service_port_(0), v6data_port_(0), v6service_port_(0), created_at_(0) {
+stream_info_impl::stream_info_impl(): channel_count_(0), nominal_srate_(0), channel_format_(cf_undefined), version_(0), v4data_port_(0), v4service_port_(0), v6data_port_(0), v6service_port_(0), v4mux_port_(0), timedata_version_(0), created_at_(0) {
 	// initialize XML document
 	write_xml(doc_);
 }
@@ -22,7 +22,7 @@ stream_info_impl::stream_info_impl(): channel_count_(0), nominal_srate_(0), chan
 /// Constructor.
 stream_info_impl::stream_info_impl(const string &name, const string &type, int channel_count, double nominal_srate, channel_format_t channel_format, const string &source_id):
 	name_(name), type_(type), channel_count_(channel_count), nominal_srate_(nominal_srate), channel_format_(channel_format), source_id_(source_id), version_(api_config::get_instance()->use_protocol_version()),
-	v4data_port_(0), v4service_port_(0), v6data_port_(0), v6service_port_(0), created_at_(0) {
+	v4data_port_(0), v4service_port_(0), v6data_port_(0), v6service_port_(0), v4mux_port_(0), timedata_version_(0), created_at_(0) {
 	if (name.empty())
 		throw std::invalid_argument("The name of a stream must be non-empty.");
 	if (channel_count < 0)
@@ -56,6 +56,8 @@ void stream_info_impl::write_xml(xml_document &doc) {
 	info.append_child("v6address").append_child(node_pcdata).set_value(v6address_.c_str());
 	info.append_child("v6data_port").append_child(node_pcdata).set_value(lexical_cast<string>(v6data_port_).c_str());
 	info.append_child("v6service_port").append_child(node_pcdata).set_value(lexical_cast<string>(v6service_port_).c_str());
+	info.append_child("v4mux_port").append_child(node_pcdata).set_value(lexical_cast<string>(v4mux_port_).c_str());
+	info.append_child("timedata_version").append_child(node_pcdata).set_value(lexical_cast<string>(timedata_version_).c_str());
 	info.append_child("desc");
 }
 
@@ -122,6 +124,10 @@ void stream_info_impl::read_xml(xml_document &doc) {
 		v6data_port_ = lexical_cast<int>(info.child_value("v6data_port"));
 		// service_port
 		v6service_port_ = lexical_cast<int>(info.child_value("v6service_port"));
+		// mux_port (absent in the infos of older outlets)
+		v4mux_port_ = *info.child_value("v4mux_port") ? lexical_cast<int>(info.child_value("v4mux_port")) : 0;
+		// timedata_version (absent in the infos of older outlets)
+		timedata_version_ = *info.child_value("timedata_version") ? lexical_cast<int>(info.child_value("timedata_version")) : 0;
 	} catch(std::exception &e) {
 		// reset the stream info to blank state
 		*this = stream_info_impl();
@@ -317,6 +323,22 @@ void stream_info_impl::v6service_port(int v) {
 	doc_.child("info").child("v6service_port").first_child().set_value(lexical_cast<string>(v6service_port_).c_str()); 
 }
 
+/**
+* Set the TCP port of the multiplexing server of the process that hosts the stream (0 if it has none).
+*/
+void stream_info_impl::v4mux_port(int v) { 
+	v4mux_port_ = v; 
+	doc_.child("info").child("v4mux_port").first_child().set_value(lexical_cast<string>(v4mux_port_).c_str()); 
+}
+
+/**
+* Set the newest version of the binary time-probe exchange that the UDP service port understands (0 if only the text version).
+*/
+void stream_info_impl::timedata_version(int v) { 
+	timedata_version_ = v; 
+	doc_.child("info").child("timedata_version").first_child().set_value(lexical_cast<string>(timedata_version_).c_str()); 
+}
+
 /**
 * Assignment operator.
 * Needs special handling because xml_document is non-copyable.
@@ -337,6 +359,8 @@ stream_info_impl& stream_info_impl::operator=(stream_info_impl const &rhs) {
 	v6address_ = rhs.v6address_;
 	v6data_port_ = rhs.v6data_port_;
 	v6service_port_ = rhs.v6service_port_;
+	v4mux_port_ = rhs.v4mux_port_;
+	timedata_version_ = rhs.timedata_version_;
 	uid_ = rhs.uid_;
 	created_at_ = rhs.created_at_;
 	session_id_ = rhs.session_id_;
@@ -352,7 +376,7 @@ stream_info_impl& stream_info_impl::operator=(stream_info_impl const &rhs) {
 stream_info_impl::stream_info_impl(const stream_info_impl &rhs): name_(rhs.name_), type_(rhs.type_), channel_count_(rhs.channel_count_),
 nominal_srate_(rhs.nominal_srate_), channel_format_(rhs.channel_format_), source_id_(rhs.source_id_), version_(rhs.version_), v4address_(rhs.v4address_),
 v4data_port_(rhs.v4data_port_), v4service_port_(rhs.v4service_port_), v6address_(rhs.v6address_), v6data_port_(rhs.v6data_port_), v6service_port_(rhs.v6service_port_),
-uid_(rhs.uid_), created_at_(rhs.created_at_), session_id_(rhs.session_id_), hostname_(rhs.hostname_) {
+v4mux_port_(rhs.v4mux_port_), timedata_version_(rhs.timedata_version_), uid_(rhs.uid_), created_at_(rhs.created_at_), session_id_(rhs.session_id_), hostname_(rhs.hostname_) {
 	doc_.reset(rhs.doc_);
 }
 
@@ -220,6 +220,20 @@ namespace lsl {
 		int v6service_port() const { return v6service_port_; }
 		void v6service_port(int v);
 
+		/**
+		* Get/Set the TCP port of the multiplexing server of the process that hosts the stream (0 if it has none).
+		* Inlets can receive the data of all streams of that process over a single connection to this port.
+		*/
+		int v4mux_port() const { return v4mux_port_; }
+		void v4mux_port(int v);
+
+		/**
+		* Get/Set the newest version of the binary time-probe exchange (see time_probe.h) that the UDP service port understands
+		* (0 if it understands only the text version).
+		*/
+		int timedata_version() const { return timedata_version_; }
+		void timedata_version(int v);
+
 		/**
 		* Get the (editable) XML description of a stream.
 		*/
@@ -255,6 +269,8 @@ namespace lsl {
 		std::string v6address_;
 		int v6data_port_;
 		int v6service_port_;
+		int v4mux_port_;
+		int timedata_version_;
 		std::string uid_;
 		double created_at_;
 		std::string session_id_;
@@ -124,19 +124,33 @@ namespace lsl {
 		* @throws lost_error (if the stream source has been lost).
 		*/
 		template<class T> std::size_t pull_chunk_multiplexed(T *data_buffer, double *timestamp_buffer, std::size_t data_buffer_elements, std::size_t timestamp_buffer_elements, double timeout=0.0) {
-			std::size_t samples_written=0, num_chans = info().channel_count(), max_samples = data_buffer_elements/num_chans;
+			return pull_chunk_multiplexed(data_buffer,timestamp_buffer,data_buffer_elements,timestamp_buffer_elements,timeout,data_buffer_elements/info().channel_count());
+		}
+
+		/**
+		* Pull a chunk of data from the inlet, waiting only until a given minimum number of samples has arrived.
+		* This is the same as the above, except that the function returns as soon as min_samples samples have been 
+		* received (or the timeout has expired), so that real-time applications are woken up once per block of samples
+		* rather than once per sample.
+		* @param min_samples The number of samples to wait for (the above function waits for max. the full buffer).
+		* @return data_elements_written Number of channel data elements written to the data buffer.
+		* @throws lost_error (if the stream source has been lost).
+		*/
+		template<class T> std::size_t pull_chunk_multiplexed(T *data_buffer, double *timestamp_buffer, std::size_t data_buffer_elements, std::size_t timestamp_buffer_elements, double timeout, std::size_t min_samples) {
+			std::size_t num_chans = info().channel_count(), max_samples = data_buffer_elements/num_chans;
 			if (data_buffer_elements % num_chans != 0)
 				throw std::runtime_error("The number of buffer elements must be a multiple of the stream's channel count.");
 			if (timestamp_buffer && max_samples != timestamp_buffer_elements)
 				throw std::runtime_error("The timestamp buffer must hold the same number of samples as the data buffer.");
-			double end_time = timeout ? lsl_clock()+timeout : 0.0;
-			for (samples_written=0; samples_written<max_samples; samples_written++) {
-				if (double ts=pull_sample(&data_buffer[samples_written*num_chans],num_chans,timeout?end_time-lsl_clock():0.0)) {
-					if (timestamp_buffer)
-						timestamp_buffer[samples_written] = ts;
-				} else
-					break;
+			// the time stamps need to go through the post-processor even if the caller doesn't want them
+			if (!timestamp_buffer && max_samples) {
+				if (chunk_timestamps_.size() < max_samples)
+					chunk_timestamps_.resize(max_samples);
+				timestamp_buffer = &chunk_timestamps_[0];
 			}
+			std::size_t samples_written = data_receiver_.pull_chunk_typed(data_buffer,timestamp_buffer,max_samples,min_samples,timeout);
+			for (std::size_t k=0; k<samples_written; k++)
+				timestamp_buffer[k] = postprocess(timestamp_buffer[k]);
 			return samples_written*num_chans;
 		}
 
@@ -193,7 +207,7 @@ namespace lsl {
 		* Query the current size of the buffer, i.e. the number of samples that are buffered.
 		* Note that this value may be inaccurate and should not be relied on for program logic.
 		*/
-		std::size_t samples_available() { return (std::size_t)(!data_receiver_.empty()); };
+		std::size_t samples_available() { return data_receiver_.size(); };
 
 		/** Query whether the clock was potentially reset since the last call to was_clock_reset().
 		* This is only interesting for applications that combine multiple time_correction values to estimate clock drift
@@ -201,6 +215,16 @@ namespace lsl {
 		*/
 		bool was_clock_reset() { return time_receiver_.was_reset(); }
 
+		/// Query the number of samples that were dropped (lost in transmission with a datagram feed, or discarded because the buffer overflowed).
+		std::size_t samples_dropped() { return data_receiver_.samples_dropped(); }
+
+		/**
+		* Request the data feed as unacknowledged datagrams (overrides tuning.DatagramData and tuning.DatagramRedundancy for this inlet).
+		* Must be called before the stream is opened.
+		* @param redundancy The number of times that each chunk is sent (in consecutive datagrams), or 0 to receive the data over TCP.
+		*/
+		void set_datagram_data(int redundancy) { data_receiver_.set_datagram_data(redundancy); }
+
 		/// Override the half-time (forget factor) of the time-stamp smoothing.
 		void smoothing_halftime(float value) { postprocessor_.smoothing_halftime(value); }
 
@@ -218,6 +242,9 @@ namespace lsl {
 
 		// class for post-processing time stamps
 		time_postprocessor postprocessor_;
+
+		// receives the time stamps of pulled chunks if the caller doesn't want them (reused across calls)
+		std::vector<double> chunk_timestamps_;
 	};
 
 }
@@ -1,5 +1,8 @@
 #define NO_EXPLICIT_TEMPLATE_INSTANTIATION // a convention that applies when including portable_oarchive.h in multiple .cpp files.
 #include "stream_outlet_impl.h"
+#include "outlet_registry.h"
+#include "mux_server.h"
+#include "outlet_io_pool.h"
 #include <boost/bind.hpp>
 
 
@@ -17,11 +20,24 @@ using namespace boost::asio;
 *					   The default is sufficient to hold a bit more than 15 minutes of data at 512Hz, while consuming not more than ca. 512MB of RAM.
 */
 stream_outlet_impl::stream_outlet_impl(const stream_info_impl &info, int chunk_size, int max_capacity): chunk_size_(chunk_size), info_(new stream_info_impl(info)), 
-	sample_factory_(new sample::factory(info.channel_format(),info.channel_count(),info.nominal_srate()?info.nominal_srate()*api_config::get_instance()->outlet_buffer_reserve_ms()/1000:api_config::get_instance()->outlet_buffer_reserve_samples())), send_buffer_(new send_buffer(max_capacity))
+	sample_factory_(new sample::factory(info.channel_format(),info.channel_count(),info.nominal_srate()?info.nominal_srate()*api_config::get_instance()->outlet_buffer_reserve_ms()/1000:api_config::get_instance()->outlet_buffer_reserve_samples(),api_config::get_instance()->outlet_buffer_reserve_bytes())), send_buffer_(new send_buffer(max_capacity,info.nominal_srate()))
 {
 	ensure_lsl_initialized();
 	const api_config *cfg = api_config::get_instance();
 
+	// share the multiplexing server of this process (announced in the stream info, so it must be known before the stacks are instantiated)
+	if (cfg->multiplex() && cfg->ipv6() != "force") {
+		try {
+			mux_ = mux_server::instance();
+			info_->v4mux_port(mux_->port());
+		} catch(std::exception &e) {
+			std::cerr << "Could not start the multiplexing server: " << e.what() << std::endl;
+		}
+	}
+
+	// share the IO pool of this process, if enabled (otherwise the stacks get IO services and threads of their own)
+	io_pool_ = outlet_io_pool::configured();
+
 	// instantiate IPv4 and/or IPv6 stacks (depending on settings)
 	if (cfg->ipv6() == "disable")
 		instantiate_stack(tcp::v4(),udp::v4());
@@ -51,9 +67,13 @@ stream_outlet_impl::stream_outlet_impl(const stream_info_impl &info, int chunk_s
 	for (unsigned k=0;k<responders_.size();k++)
 		responders_[k]->begin_serving();
 
-	// and start the IO threads to handle them
-	for (unsigned k=0;k<ios_.size();k++)
-		io_threads_.push_back(thread_p(new boost::thread(boost::bind(&stream_outlet_impl::run_io,this,ios_[k]))));
+	// and start the IO threads to handle them (unless they run on the IO pool)
+	if (!io_pool_)
+		for (unsigned k=0;k<ios_.size();k++)
+			io_threads_.push_back(thread_p(new boost::thread(boost::bind(&stream_outlet_impl::run_io,this,ios_[k]))));
+
+	// let inlets in this process find us
+	outlet_registry::add(info_->uid(),send_buffer_,sample_factory_,chunk_size_);
 }
 
 /**
@@ -67,18 +87,18 @@ void stream_outlet_impl::instantiate_stack(tcp tcp_protocol, udp udp_protocol) {
 	int multicast_ttl = cfg->multicast_ttl();
 	int multicast_port = cfg->multicast_port();
 	// create TCP data server
-	ios_.push_back(io_service_p(new io_service()));
+	ios_.push_back(io_pool_ ? io_pool_->io() : io_service_p(new io_service()));
 	tcp_servers_.push_back(tcp_server_p(new tcp_server(info_, ios_.back(), send_buffer_, sample_factory_, tcp_protocol, chunk_size_)));
 	// create UDP time server
-	ios_.push_back(io_service_p(new io_service()));
-	udp_servers_.push_back(udp_server_p(new udp_server(info_, *ios_.back(), udp_protocol)));
+	ios_.push_back(io_pool_ ? io_pool_->io() : io_service_p(new io_service()));
+	udp_servers_.push_back(udp_server_p(new udp_server(info_, ios_.back(), udp_protocol)));
 	// create UDP multicast responders
 	for (std::vector<std::string>::iterator i=multicast_addrs.begin(); i != multicast_addrs.end(); i++) {
 		try {
 			// use only addresses for the protocol that we're supposed to use here
 			ip::address address(ip::address::from_string(*i));
 			if (udp_protocol == udp::v4() ? address.is_v4() : address.is_v6())
-				responders_.push_back(udp_server_p(new udp_server(info_, *ios_.back(), *i, multicast_port, multicast_ttl, listen_address)));
+				responders_.push_back(udp_server_p(new udp_server(info_, ios_.back(), *i, multicast_port, multicast_ttl, listen_address)));
 		} catch(std::exception &e) {
 			std::clog << "Note (minor): could not create multicast responder for address " << *i << " (failed with: " << e.what() << ")" << std::endl;
 		}
@@ -91,6 +111,8 @@ void stream_outlet_impl::instantiate_stack(tcp tcp_protocol, udp udp_protocol) {
 */
 stream_outlet_impl::~stream_outlet_impl() {
 	try {
+		// detach inlets in this process
+		outlet_registry::remove(info_->uid());
 		// cancel all request chains
 		for (unsigned k=0;k<tcp_servers_.size();k++)
 			tcp_servers_[k]->end_serving();
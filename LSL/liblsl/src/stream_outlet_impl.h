@@ -7,6 +7,8 @@
 #include "api_config.h"
 #include "udp_server.h"
 #include "sample.h"
+#include "mux_server.h"
+#include "outlet_io_pool.h"
 
 
 
@@ -111,8 +113,7 @@ namespace lsl {
 				throw std::runtime_error("The data buffer pointer must not be NULL.");
 			if (!timestamp_buffer)
 				throw std::runtime_error("The timestamp buffer pointer must not be NULL.");
-			for (std::size_t k=0; k<num_samples; k++)
-				enqueue(&data_buffer[k*num_chans],timestamp_buffer[k],pushthrough && k==num_samples-1);
+			enqueue_chunk(data_buffer,num_samples,timestamp_buffer,0.0,pushthrough);
 		}
 
 		/**
@@ -136,9 +137,7 @@ namespace lsl {
 					timestamp = lsl_clock();
 				if (info().nominal_srate() != IRREGULAR_RATE)
 					timestamp = timestamp - (num_samples-1)/info().nominal_srate();
-				push_sample(buffer,timestamp,pushthrough && (num_samples==1));
-				for (std::size_t k=1; k<num_samples; k++)
-					push_sample(&buffer[k*num_chans],DEDUCED_TIMESTAMP,pushthrough && (k==num_samples-1));
+				enqueue_chunk(buffer,num_samples,NULL,timestamp,pushthrough);
 			}
 		}
 
@@ -181,6 +180,35 @@ namespace lsl {
 			send_buffer_->push_sample(smp);
 		}
 
+		/**
+		* Allocate a chunk of new samples and enqueue it into the send buffer as a single unit.
+		* @param buffer The multiplexed channel data of the samples.
+		* @param num_samples The number of samples in the chunk.
+		* @param timestamps Optionally one time stamp per sample; if NULL, the first sample gets first_timestamp and the 
+		*					time stamps of the remaining samples are deduced by the receiver.
+		* @param first_timestamp Time stamp of the first sample (if no time stamps buffer is given).
+		* @param pushthrough Whether to push the chunk through to the receivers.
+		*/
+		template<class T> void enqueue_chunk(T* buffer, std::size_t num_samples, const double *timestamps, double first_timestamp, bool pushthrough) {
+			bool force_default_timestamps = lsl::api_config::get_instance()->force_default_timestamps();
+			std::size_t num_chans = info_->channel_count();
+			sample_p head, tail;
+			for (std::size_t k=0; k<num_samples; k++) {
+				double timestamp = timestamps ? timestamps[k] : (k==0 ? first_timestamp : DEDUCED_TIMESTAMP);
+				if (force_default_timestamps || timestamp == 0.0)
+					timestamp = lsl_clock();
+				sample_p smp(sample_factory_->new_sample(timestamp, pushthrough && k==num_samples-1));
+				smp->assign_typed(&buffer[k*num_chans]);
+				if (tail)
+					tail->append_to_chunk(smp);
+				else
+					head = smp;
+				tail = smp;
+			}
+			if (head)
+				send_buffer_->push_sample(head);
+		}
+
 		/**
 		* Check whether some given number of channels matches the stream's channel_count.
 		* Throws an error if not.
@@ -194,12 +222,14 @@ namespace lsl {
 		int chunk_size_;							// the preferred chunk size
 		stream_info_impl_p info_;					// stream_info shared between the various server instances
 		send_buffer_p send_buffer_;					// the single-producer, multiple-receiver send buffer
+		outlet_io_pool_p io_pool_;					// the IO pool of this process, if enabled (then all IO services below are that of the pool)
 		std::vector<io_service_p> ios_;				// the IO service objects (two per stack: one for UDP and one for TCP)
 
 		std::vector<tcp_server_p> tcp_servers_;		// the threaded TCP data server(s); two if using both IP stacks
 		std::vector<udp_server_p> udp_servers_;		// the UDP timing & ident service(s); two if using both IP stacks
 		std::vector<udp_server_p> responders_;		// UDP multicast responders for service discovery (time features disabled); also using only the allowed IP stacks
-		std::vector<thread_p> io_threads_;			// threads that handle the I/O operations (two per stack: one for UDP and one for TCP)
+		std::vector<thread_p> io_threads_;			// threads that handle the I/O operations (two per stack: one for UDP and one for TCP; none if using the IO pool)
+		mux_server_p mux_;							// the multiplexing server of this process, if enabled
 	};
 
 }
@@ -14,6 +14,15 @@
 using namespace lsl;
 using namespace boost::asio;
 
+/// The maximum number of samples that are written as a single block (if compression or protocol 1.20 is used).
+const std::size_t max_block_samples = 1024;
+
+/// The maximum number of bytes of channel data that are written as a single chunk (if protocol 1.20 or shared memory is used).
+const std::size_t max_block_bytes = 1024*1024;
+
+/// Channel data of at least this size is sent straight from the memory of the samples (if the byte order is native); smaller data is cheaper to copy than to gather.
+const std::size_t min_gather_bytes = 1024;
+
 /**
 * Construct a new TCP server for a stream outlet.
 * This opens a new TCP server port (in the allowed range) and, if successful,
@@ -27,7 +36,7 @@ using namespace boost::asio;
 * @param protocol The protocol (IPv4 or IPv6) that shall be serviced by this server.
 * @param chunk_size The preferred chunk size, in samples. If 0, the pushthrough flag determines the effective chunking.
 */
-tcp_server::tcp_server(const stream_info_impl_p &info, const io_service_p &io, const send_buffer_p &sendbuf, const sample::factory_p &factory, tcp protocol, int chunk_size): chunk_size_(chunk_size), shutdown_(false), info_(info), io_(io), factory_(factory), send_buffer_(sendbuf), acceptor_(new tcp::acceptor(*io)) {
+tcp_server::tcp_server(const stream_info_impl_p &info, const io_service_p &io, const send_buffer_p &sendbuf, const sample::factory_p &factory, tcp protocol, int chunk_size): chunk_size_(chunk_size), shutdown_(false), info_(info), io_(io), strand_(*io), factory_(factory), send_buffer_(sendbuf), acceptor_(new tcp::acceptor(*io)) {
 	// open the server connection
 	acceptor_->open(protocol);
 
@@ -66,14 +75,14 @@ void tcp_server::begin_serving() {
 * The actual teardown will be performed by the IO thread that runs the operations of this server.
 */
 void tcp_server::end_serving() {
-	// the shutdown flag informs the transfer thread that we're shutting down
+	// the shutdown flag informs the client sessions that we're shutting down
 	shutdown_ = true;
 	// issue closure of the server socket; this will result in a cancellation of the associated IO operations
-	io_->post(boost::bind(&tcp::acceptor::close,acceptor_));
+	strand_.post(boost::bind(&tcp::acceptor::close,acceptor_));
 	// issue closure of all active client session sockets; cancels the related outstanding IO jobs
 	close_inflight_sockets();
-	// also notify any transfer threads that are blocked waiting for a sample by sending them one (= a ping)
-	send_buffer_->push_sample(factory_->new_sample(lsl_clock(), true));
+	// also wake up any client sessions that are waiting for a sample by sending them a blank one (= a ping)
+	send_buffer_->push_sample(sample_p());
 }
 
 
@@ -86,7 +95,7 @@ void tcp_server::accept_next_connection() {
 		client_session_p newsession(new client_session(shared_from_this()));
 		// accept a connection on the session's socket
 		acceptor_->async_accept(*newsession->socket(),
-			boost::bind(&tcp_server::handle_accept_outcome,shared_from_this(),newsession,placeholders::error));
+			strand_.wrap(boost::bind(&tcp_server::handle_accept_outcome,shared_from_this(),newsession,placeholders::error)));
 	}  catch(std::exception &e) {
 		std::cerr << "Error during tcp_server::accept_next_connection (id: " << boost::this_thread::get_id() << "): " << e.what() << std::endl;
 	}
@@ -122,7 +131,24 @@ void tcp_server::unregister_inflight_socket(const tcp_socket_p &sock) {
 void tcp_server::close_inflight_sockets() {
 	boost::lock_guard<boost::recursive_mutex> lock(inflight_mut_);
 	for (std::set<tcp_socket_p>::iterator i=inflight_.begin(); i!=inflight_.end(); i++)
-		io_->post(boost::bind(&shutdown_and_close<tcp_socket_p,tcp>,*i));
+		strand_.post(boost::bind(&shutdown_and_close<tcp_socket_p,tcp>,*i));
+}
+
+
+// === multicast data transport ===
+
+/// Get the multicast feed of this server, creating it if necessary (returns an empty pointer if multicast data transport is not possible; IO thread only).
+multicast_feed_sender_p tcp_server::multicast_feed() {
+	multicast_feed_sender_p result = multicast_feed_.lock();
+	if (!result && acceptor_->local_endpoint().protocol() == tcp::v4()) {
+		try {
+			result.reset(new multicast_feed_sender(strand_,send_buffer_,acceptor_->local_endpoint().port(),chunk_size_));
+			multicast_feed_ = result;
+		} catch(std::exception &e) {
+			std::cerr << "Could not set up the multicast data feed (" << e.what() << "); using TCP instead." << std::endl;
+		}
+	}
+	return result;
 }
 
 
@@ -133,16 +159,18 @@ void tcp_server::close_inflight_sockets() {
 
 
 /// Instantiate a new session & its socket.
-tcp_server::client_session::client_session(const tcp_server_p &serv): registered_(false), io_(serv->io_), serv_(serv), sock_(tcp_socket_p(new tcp::socket(*serv->io_))), requeststream_(&requestbuf_), use_byte_order_(0), data_protocol_version_(100) {	}
+tcp_server::client_session::client_session(const tcp_server_p &serv): registered_(false), io_(serv->io_), serv_(serv), sock_(tcp_socket_p(new tcp::socket(*serv->io_))), requeststream_(&requestbuf_), data_protocol_version_(100), use_byte_order_(0), ring_pending_(false), ring_timer_(*serv->io_), peer_closed_(false), seqn_(0) {	}
 
 /**
 * Destructor. Unregisters the socket from the server & closes it.
-* Note: This will only be called after the transfer thread and any other operations are done, since these ops hold shared ptrs to this object.
+* Note: This will only be called after the sample transfer and any other operations are done, since these ops hold shared ptrs to this object.
 */
 tcp_server::client_session::~client_session() {
 	try {
 		if (registered_)
 			serv_->unregister_inflight_socket(sock_);
+		if (mcast_)
+			mcast_->detach();
 	}
 	catch(std::exception &e) {
 		std::cerr << "Unexpected error in client_session destructor (id: " << boost::this_thread::get_id() << "): " << e.what() << std::endl;
@@ -164,7 +192,7 @@ void tcp_server::client_session::begin_processing() {
 		registered_ = true;
 		// read the request line
 		async_read_until(*sock_, requestbuf_, "\r\n",
-			boost::bind(&client_session::handle_read_command_outcome,shared_from_this(),placeholders::error));
+			serv_->strand_.wrap(boost::bind(&client_session::handle_read_command_outcome,shared_from_this(),placeholders::error)));
 	} catch(std::exception &e) {
 		std::cerr << "Error during client_session::begin_processing (id: " << boost::this_thread::get_id() << "): " << e.what() << std::endl;
 	}
@@ -179,22 +207,22 @@ void tcp_server::client_session::handle_read_command_outcome(error_code err) {
 			if (method == "LSL:shortinfo")
 				// shortinfo request: read the content query string
 				async_read_until(*sock_, requestbuf_, "\r\n",
-					boost::bind(&client_session::handle_read_query_outcome,shared_from_this(),placeholders::error));
+					serv_->strand_.wrap(boost::bind(&client_session::handle_read_query_outcome,shared_from_this(),placeholders::error)));
 			if (method == "LSL:fullinfo")
 				// fullinfo request: reply right away
 				async_write(*sock_, boost::asio::buffer(serv_->fullinfo_msg_),
-					boost::bind(&client_session::handle_send_outcome,shared_from_this(),placeholders::error));
+					serv_->strand_.wrap(boost::bind(&client_session::handle_send_outcome,shared_from_this(),placeholders::error)));
 			if (method == "LSL:streamfeed")
 				// streamfeed request (1.00): read feed parameters
 				async_read_until(*sock_, requestbuf_, "\r\n",
-					boost::bind(&client_session::handle_read_feedparams,shared_from_this(),100,"",placeholders::error));
+					serv_->strand_.wrap(boost::bind(&client_session::handle_read_feedparams,shared_from_this(),100,"",placeholders::error)));
 			if (boost::algorithm::starts_with(method,"LSL:streamfeed/")) {
 				// streamfeed request with version: read feed parameters
 				std::vector<std::string> parts; boost::algorithm::split(parts,method,boost::algorithm::is_any_of(" \t"));
 				int request_protocol_version = boost::lexical_cast<int>(parts[0].substr(parts[0].find_first_of("/")+1));
 				std::string request_uid = (parts.size()>1) ? parts[1] : "";
 				async_read_until(*sock_, requestbuf_, "\r\n\r\n",
-					boost::bind(&client_session::handle_read_feedparams,shared_from_this(),request_protocol_version,request_uid,placeholders::error));
+					serv_->strand_.wrap(boost::bind(&client_session::handle_read_feedparams,shared_from_this(),request_protocol_version,request_uid,placeholders::error)));
 			}
 		}
 	} catch(std::exception &e) {
@@ -211,7 +239,7 @@ void tcp_server::client_session::handle_read_query_outcome(error_code err) {
 			if (serv_->info_->matches_query(query))
 				// matches: reply (otherwise just close the stream)
 				async_write(*sock_, boost::asio::buffer(serv_->shortinfo_msg_),
-					boost::bind(&client_session::handle_send_outcome,shared_from_this(),placeholders::error));
+					serv_->strand_.wrap(boost::bind(&client_session::handle_send_outcome,shared_from_this(),placeholders::error)));
 		}
 	} catch(std::exception &e) {
 		std::cerr << "Unexpected error while parsing a client request (id: " << boost::this_thread::get_id() << "): " << e.what() << std::endl;
@@ -225,7 +253,7 @@ void tcp_server::client_session::handle_send_outcome(error_code err) { }
 void tcp_server::client_session::send_status_message(const std::string &str) {
 	string_p msg(new std::string(str));
 	async_write(*sock_, boost::asio::buffer(*msg),
-		boost::bind(&client_session::handle_status_outcome,shared_from_this(),msg,placeholders::error));
+		serv_->strand_.wrap(boost::bind(&client_session::handle_status_outcome,shared_from_this(),msg,placeholders::error)));
 }
 
 /// Handler that gets called after finishing the sending of a message, holding a reference to the message.
@@ -255,6 +283,11 @@ void tcp_server::client_session::handle_read_feedparams(int request_protocol_ver
 				bool client_supports_subnormals = true;	// the client supports subnormal numbers
 				int client_protocol_version = request_protocol_version;	// assume that the client wants to use the same version for data transmission
 				int client_value_size = serv_->info_->channel_bytes();	// assume that the client has a standard size for the relevant data type
+				std::string client_compression("none");	// the codec that the client wants the data feed to be compressed with
+				bool client_shared_memory = false;		// whether the client is on the same host and can receive the data feed through shared memory
+				bool client_multicast = false;			// whether the client can receive the data feed by multicast
+				int client_datagram_port = 0;			// the port on which the client wants to receive the data feed as unacknowledged datagrams (if any)
+				int client_datagram_redundancy = 1;		// the number of datagrams in which the client wants each chunk to be sent
 				channel_format_t format = serv_->info_->channel_format();
 
 				// read feed parameters
@@ -286,6 +319,20 @@ void tcp_server::client_session::handle_read_feedparams(int request_protocol_ver
 							chunk_granularity_ = boost::lexical_cast<int>(rest);
 						if (type == "protocol-version")
 							client_protocol_version = boost::lexical_cast<int>(rest);
+						if (type == "compression")
+							client_compression = rest;
+						if (type == "shared-memory")
+							client_shared_memory = boost::lexical_cast<bool>(rest);
+						if (type == "multicast-data")
+							client_multicast = boost::lexical_cast<bool>(rest);
+						if (type == "datagram-data") {
+							// [Port] [Redundancy]
+							std::vector<std::string> parts; split(parts,rest,is_any_of(" \t"),token_compress_on);
+							if (parts.size() >= 2) {
+								client_datagram_port = boost::lexical_cast<int>(parts[0]);
+								client_datagram_redundancy = std::min(boost::lexical_cast<int>(parts[1]),16);
+							}
+						}
 					}
 				}
 
@@ -298,6 +345,9 @@ void tcp_server::client_session::handle_read_feedparams(int request_protocol_ver
 					data_protocol_version_ = 100;
 				if (!format_ieee754[cf_double64] || (format==cf_float32 && !format_ieee754[cf_float32]) || !client_has_ieee754_floats)
 					data_protocol_version_ = 100;
+				// chunked transmission (1.20) is only defined for numeric data; strings use the per-sample format of 1.10
+				if (format == cf_string)
+					data_protocol_version_ = std::min(data_protocol_version_,110);
 				if (data_protocol_version_ >= 110) {
 					// decide on the byte order if conflicting
 					if (BOOST_BYTE_ORDER != client_byte_order) {
@@ -312,6 +362,35 @@ void tcp_server::client_session::handle_read_feedparams(int request_protocol_ver
 						use_byte_order_ = BOOST_BYTE_ORDER;
 					// determine if subnormal suppression needs to be enabled
 					client_suppress_subnormals = (format_subnormal[format] && !client_supports_subnormals);
+					// transfer the data feed through shared memory if the client is on the same host and the feed is chunked (1.20)
+					if (client_shared_memory && data_protocol_version_ >= 120 && shm_ring::supported()) {
+						try {
+							std::size_t max_chunk_samples = std::max<std::size_t>(1,std::min<std::size_t>(max_block_samples,max_block_bytes/std::max(serv_->info_->sample_bytes(),1)));
+							std::size_t max_chunk_bytes = 2*sizeof(boost::uint32_t) + sizeof(double) + max_chunk_samples*(sizeof(boost::uint32_t)+sizeof(double)+serv_->info_->sample_bytes());
+							ring_ = shm_ring::create(std::max<std::size_t>(2*max_chunk_bytes,1<<20));
+						} catch(std::exception &e) {
+							std::cerr << "Could not set up a shared-memory ring (" << e.what() << "); using TCP instead." << std::endl;
+						}
+					}
+					// otherwise send it as unacknowledged datagrams if the client asked for that (trading completeness for latency)
+					if (!ring_ && client_datagram_port && data_protocol_version_ >= 120 && datagram_feed_sender::supports(serv_->info_->sample_bytes())) {
+						try {
+							ip::udp::endpoint target(sock_->remote_endpoint().address(),(unsigned short)client_datagram_port);
+							dgram_.reset(new datagram_feed_sender(*io_,target,client_datagram_redundancy,use_byte_order_,serv_->info_->nominal_srate()));
+						} catch(std::exception &e) {
+							std::cerr << "Could not set up the datagram feed (" << e.what() << "); using TCP instead." << std::endl;
+						}
+					}
+					// otherwise send it through the (shared) multicast feed if the client asked for that and can convert from our byte order
+					if (!ring_ && !dgram_ && client_multicast && data_protocol_version_ >= 120 && !(client_byte_order == 2134 && client_value_size >= 8)) {
+						if ((mcast_ = serv_->multicast_feed())) {
+							use_byte_order_ = BOOST_BYTE_ORDER;
+							mcast_->attach();
+						}
+					}
+					// otherwise compress the data feed if the client asked for a codec that we have (or else the samples are sent as they are)
+					if (!ring_ && !dgram_ && !mcast_ && client_compression == delta_bitpack_codec::name() && delta_bitpack_codec::supports(format))
+						codec_.reset(new delta_bitpack_codec(format,serv_->info_->channel_count()));
 				}
 
 				// send the response
@@ -321,6 +400,14 @@ void tcp_server::client_session::handle_read_feedparams(int request_protocol_ver
 				response_stream << "Byte-Order: " << use_byte_order_ << "\r\n";
 				response_stream << "Suppress-Subnormals: " << client_suppress_subnormals << "\r\n";
 				response_stream << "Data-Protocol-Version: " << data_protocol_version_ << "\r\n";
+				if (codec_)
+					response_stream << "Compression: " << delta_bitpack_codec::name() << "\r\n";
+				if (ring_)
+					response_stream << "Shared-Memory: " << ring_->name() << "\r\n";
+				if (dgram_)
+					response_stream << "Datagram-Data: " << dgram_->id() << "\r\n";
+				if (mcast_)
+					response_stream << "Multicast-Data: " << mcast_->address() << " " << mcast_->port() << " " << mcast_->id() << "\r\n";
 				response_stream << "\r\n" << std::flush;
 			} else {
 				// read feed parameters
@@ -344,7 +431,7 @@ void tcp_server::client_session::handle_read_feedparams(int request_protocol_ver
 			temp->assign_test_pattern(2); if (data_protocol_version_ >= 110) temp->save_streambuf(feedbuf_,data_protocol_version_,use_byte_order_,scratch_.get()); else *outarch_ << *temp;
 			// send off the newly created feedheader
 			async_write(*sock_,feedbuf_.data(),
-				boost::bind(&client_session::handle_send_feedheader_outcome,shared_from_this(),placeholders::error,placeholders::bytes_transferred));
+				serv_->strand_.wrap(boost::bind(&client_session::handle_send_feedheader_outcome,shared_from_this(),placeholders::error,placeholders::bytes_transferred)));
 		}
 	} catch(std::exception &e) {
 		std::cerr << "Unexpected error while serializing the feed header (id: " << boost::this_thread::get_id() << "): " << e.what() << std::endl;
@@ -356,81 +443,236 @@ void tcp_server::client_session::handle_send_feedheader_outcome(error_code err,
 	try {
 		if (!err) {
 			feedbuf_.consume(n);
+			if (max_buffered_ <= 0)
+				return;
 			// register outstanding work at the server (will be unregistered at session destruction)
 			work_.reset(new io_service::work(*serv_->io_));
-			// spawn a sample transfer thread
-			boost::thread(&client_session::transfer_samples_thread,this,shared_from_this());
+			// in multicast mode the samples are sent by the multicast feed: we only serve the client's retransmission requests
+			if (mcast_) {
+				async_read_until(*sock_, requestbuf_, "\r\n",
+					serv_->strand_.wrap(boost::bind(&client_session::handle_read_retransmit_request,shared_from_this(),placeholders::error)));
+				return;
+			}
+			// make a new consumer queue and start transferring samples from it
+			queue_ = serv_->send_buffer_->new_consumer(max_buffered_);
+			seqn_ = 0;
+			// in shared-memory or datagram mode the client sends nothing further, so a completed read tells us that it has disconnected
+			if (ring_ || dgram_)
+				sock_->async_read_some(boost::asio::buffer(&peer_byte_,1),serv_->strand_.wrap(boost::bind(&client_session::handle_peer_closed,shared_from_this(),placeholders::error)));
+			transfer_samples();
 		}
 	} catch(std::exception &e) {
 		std::cerr << "Unexpected error while handling the feedheader send outcome (id: " << boost::this_thread::get_id() << "): " << e.what() << std::endl;
 	}
 }
 
-/// Transfers samples from the server's send buffer into the async send queues of the IO threads.
-void tcp_server::client_session::transfer_samples_thread(client_session_p) {
-	if (max_buffered_ <= 0)
-		return;
+/// Serializes the samples that are waiting in the consumer queue and initiates the next chunk transfer.
+void tcp_server::client_session::transfer_samples() {
+	// take over the self-reference that kept us alive while waiting for a notification, if any
+	client_session_p keepalive;
+	keepalive.swap(self_);
 	try {
-		// make a new consumer queue
-		consumer_queue_p queue = serv_->send_buffer_->new_consumer(max_buffered_);
-		// the sequence # is merely used to determine chunk boundaries (no need for int64)
-		unsigned seqn = 0;
-		while (!serv_->shutdown_) {
+		// first finish writing a block that waits for room in the shared-memory ring, if any
+		if (ring_pending_ && !write_ring_block())
+			return;
+		sample_p samp;
+		while (!serv_->shutdown_ && !peer_closed_) {
+			// get the next sample: either the continuation of the current chunk or the next entry of the sample queue
+			if (pending_) {
+				samp.swap(pending_);
+			} else if (!queue_->try_pop(samp)) {
+				// nothing there: have the queue notify us when the next sample comes in (unless one arrived in the meantime)
+				self_ = shared_from_this();
+				if (queue_->arm_notify(boost::bind(&client_session::notify_transfer,this)))
+					return;
+				self_.reset();
+				continue;
+			}
+			// ignore blank samples (they are basically wakeup notifiers from someone's end_serving())
+			if (!samp)
+				continue;
+			// the samples of a chunk are chained to its first sample: remember where to continue
+			pending_ = samp->next_in_chunk();
 			try {
-				// get next sample from the sample queue (blocking)
-				sample_p samp(queue->pop_sample());
-				if (serv_->shutdown_)
-					break;
-				// ignore blank samples (they are basically wakeup notifiers from someone's end_serving())
-				if (!samp)
-					continue;
 				// optionally override the pushthrough flag by the chunk size of the receiver (if set) or of the sender (if set)
+				// (the sample is shared with other sessions, so we don't modify it)
+				bool pushthrough = samp->pushthrough;
 				if (chunk_granularity_)
-					samp->pushthrough = (((++seqn)%(unsigned)chunk_granularity_) == 0);
+					pushthrough = (((++seqn_)%(unsigned)chunk_granularity_) == 0);
 				else
 					if (serv_->chunk_size_)
-						samp->pushthrough = (((++seqn)%(unsigned)serv_->chunk_size_) == 0);
-				// serialize the sample into the stream
-				if (data_protocol_version_ >= 110) samp->save_streambuf(feedbuf_,data_protocol_version_,use_byte_order_,scratch_.get()); else *outarch_ << *samp;
-				// if the sample shall be pushed though...
-				if (samp->pushthrough) {
-					// send off the chunk that we aggregated so far
-					boost::unique_lock<boost::mutex> lock(completion_mut_);
-					transfer_completed_ = false;
-					async_write(*sock_,feedbuf_.data(),
-						boost::bind(&client_session::handle_chunk_transfer_outcome,shared_from_this(),placeholders::error,placeholders::bytes_transferred));
-					// wait for the completion condition
-					completion_cond_.wait(lock, boost::bind(&client_session::transfer_completed,this));
-					// handle transfer outcome
-					if (!transfer_error_) {
-						feedbuf_.consume(transfer_amount_);
-					} else
-						break;
+						pushthrough = (((++seqn_)%(unsigned)serv_->chunk_size_) == 0);
+				// serialize the sample into the stream (the encoding is computed once per sample and shared by all sessions)
+				if (ring_) {
+					// collect the sample into the current block, which is written into the ring at the end of the chunk (or when it gets too large)
+					block_.push_back(samp);
+					if (pushthrough || block_.size() >= max_block_samples || (block_.size()+1)*samp->datasize() > max_block_bytes) {
+						ring_pending_ = true;
+						if (!write_ring_block())
+							return;
+					}
+				} else if (dgram_) {
+					// collect the sample into the current block, which is sent as datagrams at the end of the chunk (or when it gets too large)
+					block_.push_back(samp);
+					if (pushthrough || block_.size() >= max_block_samples) {
+						dgram_->send(&block_[0],block_.size());
+						block_.clear();
+					}
+				} else if (codec_) {
+					// collect the sample into the current block, which is compressed at the end of the chunk (or when it gets too large)
+					block_.push_back(samp);
+					if (pushthrough || block_.size() >= max_block_samples) {
+						coded_.clear();
+						codec_->encode(&block_[0],block_.size(),coded_);
+						block_.clear();
+						sample::save_raw(feedbuf_,&coded_[0],coded_.size());
+					}
+				} else if (data_protocol_version_ >= 120) {
+					// collect the sample into the current chunk, which is written with a single header at its end (or when it gets too large)
+					block_.push_back(samp);
+					if (pushthrough || block_.size() >= max_block_samples || block_.size()*samp->datasize() >= max_block_bytes) {
+						if (use_byte_order_ == BOOST_BYTE_ORDER && samp->datasize() >= min_gather_bytes) {
+							// only the header goes into the feed buffer; the channel data is sent straight from the samples
+							sample::save_chunk_header(feedbuf_,&block_[0],block_.size(),use_byte_order_);
+							for (std::size_t k=0; k<block_.size(); k++)
+								gather_sample_data(block_[k]);
+						} else
+							sample::save_chunk_streambuf(feedbuf_,&block_[0],block_.size(),use_byte_order_,coded_);
+						block_.clear();
+					}
+				} else if (data_protocol_version_ >= 110) {
+					if (use_byte_order_ == BOOST_BYTE_ORDER && samp->format() != cf_string && samp->datasize() >= min_gather_bytes) {
+						// only the header goes into the feed buffer; the channel data is sent straight from the sample
+						samp->save_header_streambuf(feedbuf_,use_byte_order_);
+						gather_sample_data(samp);
+					} else {
+						encoded_sample_p enc = samp->encoded(use_byte_order_);
+						sample::save_raw(feedbuf_,enc->data(),enc->size());
+					}
+				} else 
+					*outarch_ << *samp;
+				// if the sample shall be pushed though (unless it went into the ring or out as datagrams, which bypass the socket)...
+				if (pushthrough && !ring_ && !dgram_) {
+					// send off the chunk that we aggregated so far; we resume once the transfer has completed
+					send_feed();
+					return;
 				}
-
 			} catch(std::exception &e) {
-				std::cerr << "Unexpected glitch in transfer_samples_thread (id: " << boost::this_thread::get_id() << "): " << e.what() << std::endl;
+				std::cerr << "Unexpected glitch in transfer_samples (id: " << boost::this_thread::get_id() << "): " << e.what() << std::endl;
 			}
 		}
 	} catch(std::exception &e) {
-		std::cerr << "Unexpected error in transfer_samples_thread (id: " << boost::this_thread::get_id() << "): " << e.what() << "; exiting..." << std::endl;
+		std::cerr << "Unexpected error in transfer_samples (id: " << boost::this_thread::get_id() << "): " << e.what() << "; ending the session..." << std::endl;
+	}
+}
+
+/// Have the channel data of a sample sent straight from its memory at the current end of the feed buffer (the sample is kept alive until then).
+void tcp_server::client_session::gather_sample_data(const sample_p &samp) {
+	gathered_.push_back(std::make_pair(feedbuf_.size(),samp));
+}
+
+/// Send the feed buffer, with the gathered channel data of the samples spliced in at their positions.
+void tcp_server::client_session::send_feed() {
+	if (gathered_.empty()) {
+		async_write(*sock_,feedbuf_.data(),
+			serv_->strand_.wrap(boost::bind(&client_session::handle_chunk_transfer_outcome,shared_from_this(),placeholders::error,placeholders::bytes_transferred)));
+		return;
+	}
+	const char *feed = buffer_cast<const char*>(feedbuf_.data());
+	std::size_t pos = 0;
+	gather_.clear();
+	for (std::vector<std::pair<std::size_t,sample_p> >::iterator i=gathered_.begin(); i!=gathered_.end(); i++) {
+		if (i->first > pos)
+			gather_.push_back(const_buffer(feed+pos,i->first-pos));
+		gather_.push_back(const_buffer(i->second->channel_data(),i->second->datasize()));
+		pos = i->first;
+	}
+	if (feedbuf_.size() > pos)
+		gather_.push_back(const_buffer(feed+pos,feedbuf_.size()-pos));
+	async_write(*sock_,gather_,
+		serv_->strand_.wrap(boost::bind(&client_session::handle_chunk_transfer_outcome,shared_from_this(),placeholders::error,placeholders::bytes_transferred)));
+}
+
+/// Write the collected block into the shared-memory ring; if there is no room for it yet, schedule a retry and return false.
+bool tcp_server::client_session::write_ring_block() {
+	if (serv_->shutdown_ || peer_closed_ || ring_->reader_closed())
+		return false;
+	if (ring_->free_space() < sample::chunk_bytes(&block_[0],block_.size())) {
+		// the client is lagging behind: check back shortly (the samples keep queuing up in the consumer queue meanwhile)
+		ring_timer_.expires_from_now(boost::posix_time::milliseconds(1));
+		ring_timer_.async_wait(serv_->strand_.wrap(boost::bind(&client_session::handle_ring_retry,shared_from_this(),placeholders::error)));
+		return false;
+	}
+	sample::save_chunk_streambuf(*ring_,&block_[0],block_.size(),use_byte_order_,coded_);
+	ring_->publish();
+	block_.clear();
+	ring_pending_ = false;
+	return true;
+}
+
+/// Handler that gets called when it is time to retry writing into the shared-memory ring.
+void tcp_server::client_session::handle_ring_retry(error_code err) {
+	if (!err)
+		transfer_samples();
+}
+
+/// Handler that gets called when the client has closed the connection (in shared-memory or datagram mode); ends the session.
+void tcp_server::client_session::handle_peer_closed(error_code) {
+	try {
+		peer_closed_ = true;
+		// stop retrying to write into a full ring
+		error_code ec;
+		ring_timer_.cancel(ec);
+		// stop buffering samples for the client (once the queue is gone, no further notification can be issued)
+		queue_.reset();
+		// close the ring or the datagram feed (the transfer chain checks peer_closed_ before it touches them)
+		ring_.reset();
+		dgram_.reset();
+		block_.clear();
+		pending_.reset();
+		// end the transfer chain: this releases the self-reference of a session that waits for a notification (a notification
+		// that has already been issued has queued its transfer_samples() before this one, so it is handled while we are still alive)
+		serv_->strand_.post(boost::bind(&client_session::transfer_samples,shared_from_this()));
+	} catch(std::exception &e) {
+		std::cerr << "Unexpected error while ending a session whose client has disconnected: " << e.what() << std::endl;
+	}
+}
+
+/// Handler that gets called when a retransmission request of the client has been read (in multicast mode).
+void tcp_server::client_session::handle_read_retransmit_request(error_code err) {
+	try {
+		// on error (e.g., the client has disconnected) we end the session by not continuing the handler chain
+		if (!err && !serv_->shutdown_) {
+			// request line Retransmit: [FirstSequenceNumber] [Count]\r\n
+			std::string line; getline(requeststream_,line);
+			std::vector<std::string> parts; boost::algorithm::split(parts,line,boost::algorithm::is_any_of(" \t\r"),boost::algorithm::token_compress_on);
+			if (parts.size() >= 3 && parts[0] == "Retransmit:")
+				mcast_->retransmit(boost::lexical_cast<boost::uint64_t>(parts[1]),boost::lexical_cast<boost::uint64_t>(parts[2]));
+			async_read_until(*sock_, requestbuf_, "\r\n",
+				serv_->strand_.wrap(boost::bind(&client_session::handle_read_retransmit_request,shared_from_this(),placeholders::error)));
+		}
+	} catch(std::exception &e) {
+		std::cerr << "Unexpected error while handling a retransmission request (id: " << boost::this_thread::get_id() << "): " << e.what() << std::endl;
 	}
 }
 
+/// Callback of the consumer queue when a new sample has been pushed (called from the pushing thread).
+void tcp_server::client_session::notify_transfer() {
+	// the session is kept alive by self_ until transfer_samples() runs
+	serv_->strand_.post(boost::bind(&client_session::transfer_samples,this));
+}
+
 /// Handler that gets called when a sample transfer has been completed.
-void tcp_server::client_session::handle_chunk_transfer_outcome(error_code err, std::size_t len) {
+void tcp_server::client_session::handle_chunk_transfer_outcome(error_code err, std::size_t) {
 	try {
-		{
-			boost::lock_guard<boost::mutex> lock(completion_mut_);
-			// assign the transfer outcome
-			transfer_error_ = err;
-			transfer_amount_ = len;
-			transfer_completed_ = true;
+		// on error (e.g., the connection was closed) we end the session by not continuing the handler chain
+		if (!err) {
+			// (the whole feed has been sent, including the gathered channel data)
+			feedbuf_.consume(feedbuf_.size());
+			gathered_.clear();
+			transfer_samples();
 		}
-		// notify the server thread
-		completion_cond_.notify_all();
 	} catch(std::exception &e) {
 		std::cerr << "Catastrophic error in handling the chunk transfer outcome (in tcp_server): " << e.what() << std::endl;
 	}
 }
-
@@ -11,6 +11,10 @@
 #include "common.h"
 
 #include "send_buffer.h"
+#include "delta_bitpack_codec.h"
+#include "shm_ring.h"
+#include "multicast_feed.h"
+#include "datagram_feed.h"
 #include "api_config.h"
 #include "portable_archive/portable_oarchive.hpp"
 
@@ -88,6 +92,9 @@ namespace lsl {
 		/// Post a close of all in-flight sockets.
 		void close_inflight_sockets();
 
+		/// Get the multicast feed of this server, creating it if necessary (returns an empty pointer if multicast data transport is not possible; IO thread only).
+		multicast_feed_sender_p multicast_feed();
+
 		/**
 		* Active session with a TCP client.
 		* A note on memory ownership:
@@ -98,10 +105,14 @@ namespace lsl {
 		*   instance). Their lifetime is managed by boost::asio and ends when the handler chain ends (e.g., is aborted). Since the TCP server
 		*   is referred to (occasionally) by handler code, the tcp_server is owned also by the client_sessions, and therefore kept alive for as
 		*   long as there is at least one request chain running.
-		* - There is a per-session transfer thread (transfer_samples_thread) that owns the respective client_session and therefore the 
-		*   TCP server, as well (since it may refer to it); it goes out of scope once the server is being shut down.
-		* - The TCP server and client session also have shared ownership of the io_service (since in some cases some transfer threads
+		* - The sample transfer of a session is a handler chain as well: it alternates between chunk writes and waiting for the next 
+		*   sample, in which case the session owns itself (self_) until the notification of its consumer queue has been handled by the 
+		*   IO thread; the notification is fired at the latest by the wakeup that the server pushes when it is being shut down. 
+		*   (The self-reference is only ever dropped by the IO thread, so the session is never destroyed inside the pushing thread.)
+		* - The TCP server and client session also have shared ownership of the io_service (since in some cases some sessions
 		*	can outlive the stream outlet, and so the io_service is still kept around until all sockets have been properly released).
+		* - All handlers of the server and its sessions run on the strand of the server, so they never run concurrently, even if the
+		*   io_service is run by a pool of threads that is shared by all outlets of the process (see outlet_io_pool).
 		* - So memory is generally owned by the code (functors and stack frames) that needs to refer to it for the duration of the execution.
 		*/
 		class client_session: public boost::enable_shared_from_this<client_session> {
@@ -142,14 +153,34 @@ namespace lsl {
 			/// Handler that gets called sending the feedheader has completed.
 			void handle_send_feedheader_outcome(error_code err, std::size_t n);
 
-			/// Transfers samples from the server's send buffer into the async send queues of the IO threads.
-			void transfer_samples_thread(client_session_p sess);
+			/// Serializes the samples that are waiting in the session's consumer queue and initiates the next chunk transfer
+			/// (or, if the queue runs dry, arranges to be called again when the next sample is pushed).
+			void transfer_samples();
+
+			/// Callback of the consumer queue when a new sample has been pushed; schedules transfer_samples() on the strand of the server.
+			/// Note: the session must not be released from within this function (it is called while the send buffer is locked).
+			void notify_transfer();
 
 			/// Handler that gets called when a sample transfer has been completed.
 			void handle_chunk_transfer_outcome(error_code err, std::size_t len);
 
-			/// There is a condition variable that is waiting on this condition in the inner transfer loop
-			bool transfer_completed() const { return transfer_completed_; }
+			/// Have the channel data of a sample sent straight from its memory at the current end of the feed buffer (the sample is kept alive until then).
+			void gather_sample_data(const sample_p &samp);
+
+			/// Send the feed buffer, with the gathered channel data of the samples spliced in at their positions.
+			void send_feed();
+
+			/// Write the collected block into the shared-memory ring; if there is no room for it yet, schedule a retry and return false.
+			bool write_ring_block();
+
+			/// Handler that gets called when it is time to retry writing into the shared-memory ring.
+			void handle_ring_retry(error_code err);
+
+			/// Handler that gets called when the client has closed the connection (in shared-memory or datagram mode); ends the session.
+			void handle_peer_closed(error_code err);
+
+			/// Handler that gets called when a retransmission request of the client has been read (in multicast mode).
+			void handle_read_retransmit_request(error_code err);
 
 			bool registered_;					// whether we have registered ourselves at the server as active (so we need to unregister ourselves at destruction)
 			io_service_p io_;					// shared pointer to IO service; ensures that the IO is still around by the time the serv_ and sock_ need to be destroyed
@@ -167,28 +198,41 @@ namespace lsl {
 			int use_byte_order_;				// byte order to use (0=portable, 1234=little endian, 4321=big endian, 2134=PDP endian, not supported)
 			int chunk_granularity_;				// our chunk granularity
 			int max_buffered_;					// maximum number of samples buffered
-
-			// data exchanged between the transfer completion handler and the transfer thread
-			bool transfer_completed_;			// whether the current transfer has finished (possibly with an error)
-			error_code transfer_error_;			// the outcome of the last chunk transfer
-			std::size_t transfer_amount_;		// the amount of bytes transferred
-			boost::mutex completion_mut_;		// a mutex that protects the completion data
-			boost::condition_variable completion_cond_;	// a condition variable that signals completion
+			consumer_queue_p queue_;			// the queue from which we receive the samples to transfer
+			sample_p pending_;					// the remainder of a partially transferred chunk, if any
+			boost::scoped_ptr<delta_bitpack_codec> codec_;	// the codec for compressed data blocks (if negotiated)
+			std::vector<sample_p> block_;		// the samples that are waiting to be written as the next block (compressed or chunked)
+			std::vector<char> coded_;			// scratchpad memory for the most recently written block
+			std::vector<std::pair<std::size_t,sample_p> > gathered_;	// the samples whose channel data is sent straight from their memory, with their positions in the feed buffer
+			std::vector<boost::asio::const_buffer> gather_;	// the buffers of the feed that is being sent (feed buffer pieces and channel data)
+			shm_ring_p ring_;					// the shared-memory ring through which the samples are transferred to a client on the same host (if negotiated)
+			bool ring_pending_;					// whether the current block is waiting for room in the ring
+			boost::asio::deadline_timer ring_timer_;	// timer to retry writing into a full ring
+			bool peer_closed_;					// whether the client has closed the connection (monitored in shared-memory or datagram mode)
+			char peer_byte_;					// buffer for monitoring the connection in shared-memory or datagram mode
+			multicast_feed_sender_p mcast_;		// the multicast feed through which the samples are transferred (if negotiated)
+			boost::scoped_ptr<datagram_feed_sender> dgram_;	// the datagram feed through which the samples are transferred (if negotiated)
+			unsigned seqn_;						// sequence number of the transferred samples; merely used to determine chunk boundaries (no need for int64)
+			client_session_p self_;				// keeps the session alive while it is waiting for a notification from its consumer queue
 		};
 
-		// data used by the transfer threads
+		// data used by the client sessions
 		int chunk_size_;						// the chunk size to use (or 0)
-		bool shutdown_;							// shutdown flag: tells the transfer thread that it should terminate itself asap
+		bool shutdown_;							// shutdown flag: tells the sessions that they should stop transferring samples asap
 
 		// data shared with the outlet
 		stream_info_impl_p info_;				// shared stream_info object
 		io_service_p io_;						// shared ptr to IO service; ensures that the IO is still around by the time the acceptor needs to be destroyed
+		boost::asio::io_service::strand strand_;	// strand on which the handlers of the server and its sessions run (the IO service may be run by several threads)
 		sample::factory_p factory_;				// reference to the sample factory (which owns the samples)
 		send_buffer_p send_buffer_;				// the send buffer, shared with other TCP's and the outlet
 
 		// acceptor socket
 		tcp_acceptor_p acceptor_;				// our server socket
 
+		// multicast data transport
+		boost::weak_ptr<multicast_feed_sender> multicast_feed_;	// the multicast feed shared by the sessions that requested it (if any)
+
 		// registry of in-flight client sockets (for cancellation)
 		std::set<tcp_socket_p> inflight_;		// registry of currently in-flight sockets
 		boost::recursive_mutex inflight_mut_;	// mutex protecting the registry from concurrent access
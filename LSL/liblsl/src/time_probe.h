@@ -0,0 +1,97 @@
+#ifndef TIME_PROBE_H
+#define TIME_PROBE_H
+
+#include <cstring>
+#include <boost/cstdint.hpp>
+
+
+namespace lsl {
+
+	/**
+	* The binary time-probe exchange between a host_clock and the udp_server of a stream.
+	* This replaces the text exchange ("LSL:timedata\r\n[wave id] [t0]\r\n", answered by " [wave id] [t0] [t1] [t2]") for streams
+	* that announce it (see stream_info_impl::timedata_version()): the packets have a fixed layout, so the server can take its
+	* time stamps right at the socket, without formatting or parsing in between.
+	*
+	* Packet layout (multi-byte quantities are little endian, time stamps are IEEE 754 doubles):
+	*   request: [char[4]: "LSLt"][uint8: version][uint8: 1][uint16: 0][int32: wave id][uint32: 0][double: t0]
+	*   reply:   [char[4]: "LSLt"][uint8: version][uint8: 2][uint16: 0][int32: wave id][uint32: 0][double: t0][double: t1][double: t2]
+	* Later versions may only append fields, so a server answers a request of any version with a reply of its own version.
+	*/
+
+	/// The newest version of the binary time-probe exchange.
+	const int timedata_version = 1;
+
+	/// The size of a time-probe request.
+	const std::size_t time_request_bytes = 24;
+
+	/// The size of a time-probe reply.
+	const std::size_t time_reply_bytes = 40;
+
+	namespace detail {
+		/// Little-endian coding of the packet fields.
+		template<class T> void put_le(char *p, T value) {
+			for (std::size_t b=0; b<sizeof(T); b++)
+				p[b] = (char)((value >> (8*b)) & 0xFF);
+		}
+		template<class T> T get_le(const char *p) {
+			T value = 0;
+			for (std::size_t b=0; b<sizeof(T); b++)
+				value |= (T)(unsigned char)p[b] << (8*b);
+			return value;
+		}
+		inline void put_time(char *p, double t) { boost::uint64_t bits; memcpy(&bits,&t,sizeof(t)); put_le(p,bits); }
+		inline double get_time(const char *p) { boost::uint64_t bits = get_le<boost::uint64_t>(p); double t; memcpy(&t,&bits,sizeof(t)); return t; }
+
+		/// Write the header of a time-probe packet.
+		inline void put_time_header(char *p, int kind, boost::int32_t wave_id) {
+			memcpy(p,"LSLt",4);
+			p[4] = (char)timedata_version;
+			p[5] = (char)kind;
+			put_le<boost::uint16_t>(p+6,0);
+			put_le<boost::uint32_t>(p+8,(boost::uint32_t)wave_id);
+			put_le<boost::uint32_t>(p+12,0);
+		}
+
+		/// Check the header of a time-probe packet of the given kind and size.
+		inline bool is_time_packet(const char *p, std::size_t len, int kind, std::size_t size) {
+			return len >= size && !memcmp(p,"LSLt",4) && (unsigned char)p[4] >= 1 && p[5] == kind;
+		}
+	}
+
+	/// Check whether a packet is a binary time-probe request (rather than a text request).
+	inline bool is_time_request(const char *data, std::size_t len) { return detail::is_time_packet(data,len,1,time_request_bytes); }
+
+	/// Check whether a packet is a binary time-probe reply.
+	inline bool is_time_reply(const char *data, std::size_t len) { return detail::is_time_packet(data,len,2,time_reply_bytes); }
+
+	/// Write a time-probe request into a buffer of time_request_bytes.
+	inline void encode_time_request(char *buf, boost::int32_t wave_id, double t0) {
+		detail::put_time_header(buf,1,wave_id);
+		detail::put_time(buf+16,t0);
+	}
+
+	/**
+	* Turn a time-probe request into the reply, in place (the buffer must hold time_reply_bytes).
+	* The time stamp t2 is taken by the caller right before sending; the reply then only needs it to be filled in (see put_time_reply_t2()).
+	*/
+	inline void make_time_reply(char *buf, double t1) {
+		buf[4] = (char)timedata_version;
+		buf[5] = 2;
+		detail::put_time(buf+24,t1);
+	}
+
+	/// Fill in the time of submission of a reply (made by make_time_reply()).
+	inline void put_time_reply_t2(char *buf, double t2) { detail::put_time(buf+32,t2); }
+
+	/// Read a time-probe reply.
+	inline void decode_time_reply(const char *buf, boost::int32_t &wave_id, double &t0, double &t1, double &t2) {
+		wave_id = (boost::int32_t)detail::get_le<boost::uint32_t>(buf+8);
+		t0 = detail::get_time(buf+16);
+		t1 = detail::get_time(buf+24);
+		t2 = detail::get_time(buf+32);
+	}
+
+}
+
+#endif
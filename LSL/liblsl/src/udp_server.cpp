@@ -4,6 +4,11 @@
 #include "udp_server.h"
 #include "api_config.h"
 #include "socket_utils.h"
+#include "time_probe.h"
+
+#ifdef __linux__
+	#include <sys/socket.h>
+#endif
 
 
 // === implementation of the udp_server class ===
@@ -11,13 +16,19 @@
 using namespace lsl;
 using namespace boost::asio;
 
+namespace {
+	/// The maximum number of packets that are answered before other handlers get a turn.
+	const std::size_t max_packets_per_wakeup = 256;
+}
+
 /*
 * Create a UDP responder in unicast mode that listens next to a TCP server.
 * This server will listen on a free local port for timedata and shortinfo requests -- mainly for timing information (unless shortinfo is needed by clients).
 * @param info The stream_info of the stream to serve (shared). After success, the appropriate service port will be assigned.
+* @param io The IO service on which the server runs (may be shared with other servers).
 * @param protocol The protocol stack to use (tcp::v4() or tcp::v6()).
 */
-udp_server::udp_server(const stream_info_impl_p &info, io_service &io, udp protocol): info_(info), io_(io), socket_(new udp::socket(io)), time_services_enabled_(true) {
+udp_server::udp_server(const stream_info_impl_p &info, const io_service_p &io, udp protocol): info_(info), io_(io), strand_(*io), socket_(new udp::socket(*io)), buffers_(new char[batch_packets*max_packet_bytes]), time_services_enabled_(true) {
 	// open the socket for the specified protocol
 	socket_->open(protocol);
 
@@ -29,13 +40,19 @@ udp_server::udp_server(const stream_info_impl_p &info, io_service &io, udp proto
 		info_->v4service_port(port);
 	else
 		info_->v6service_port(port);
+
+	// announce that we understand the binary time probes
+	info_->timedata_version(timedata_version);
+
+	// have the kernel stamp the time requests on arrival (if supported)
+	enable_receive_timestamps(*socket_);
 }
 
 /*
 * Create a new UDP server in multicast mode.
 * This server will listen on a multicast address and responds only to LSL:shortinfo requests. This is for multicast/broadcast local service discovery.
 */
-udp_server::udp_server(const stream_info_impl_p &info, io_service &io, const std::string &address, int port, int ttl, const std::string &listen_address): info_(info), io_(io), socket_(new udp::socket(io)), time_services_enabled_(false) {
+udp_server::udp_server(const stream_info_impl_p &info, const io_service_p &io, const std::string &address, int port, int ttl, const std::string &listen_address): info_(info), io_(io), strand_(*io), socket_(new udp::socket(*io)), buffers_(new char[batch_packets*max_packet_bytes]), time_services_enabled_(false) {
 	ip::address addr = ip::address::from_string(address);
 	bool is_broadcast = address=="255.255.255.255";
 
@@ -82,6 +99,8 @@ udp_server::udp_server(const stream_info_impl_p &info, io_service &io, const std
 void udp_server::begin_serving() {
 	// pre-calculate the shortinfo message (now that everyone should have initialized their part).
 	shortinfo_msg_ = info_->to_shortinfo_message();
+	// (the packets are received and answered without blocking)
+	socket_->non_blocking(true);
 	// start asking for a packet
 	request_next_packet();
 }
@@ -89,7 +108,7 @@ void udp_server::begin_serving() {
 /// Initiate teardown of UDP traffic.
 void udp_server::end_serving() {
 	// gracefully close the socket; this will eventually lead to the cancellation of the IO operation(s) tied to its socket
-	io_.post(boost::bind(&close_if_open<udp_socket_p>,socket_));
+	strand_.post(boost::bind(&close_if_open<udp_socket_p>,socket_));
 }
 
 
@@ -98,48 +117,20 @@ void udp_server::end_serving() {
 /// Initiate next packet request.
 /// The result of the operation will eventually trigger the handle_receive_outcome() handler.
 void udp_server::request_next_packet() {
-	socket_->async_receive_from(boost::asio::buffer(buffer_), remote_endpoint_,
-		boost::bind(&udp_server::handle_receive_outcome, shared_from_this(), placeholders::error, placeholders::bytes_transferred));
+	socket_->async_receive(boost::asio::null_buffers(),
+		strand_.wrap(boost::bind(&udp_server::handle_receive_outcome, shared_from_this(), placeholders::error)));
 }
 
-/// Handler that gets called when the next packet was received (or the op was cancelled).
-void udp_server::handle_receive_outcome(error_code err, std::size_t len) {
+/// Handler that gets called when packets are waiting to be received (or the op was cancelled); receives and answers them in batches.
+void udp_server::handle_receive_outcome(error_code err) {
 	if (err != error::operation_aborted && err != error::shut_down) {
 		try {
 			if (!err) {
-				// remember the time of packet reception for possible later use
-				double t1 = time_services_enabled_ ? lsl_clock() : 0.0;
-
-				// wrap received packet into a request stream and parse the method from it
-				std::istringstream request_stream(std::string(buffer_,buffer_+len));
-				std::string method; getline(request_stream,method); boost::trim(method);
-				if (method == "LSL:shortinfo") {
-					// shortinfo request: parse content query string
-					std::string query; getline(request_stream,query); boost::trim(query);
-					// parse return address, port, and query ID
-					int return_port; request_stream >> return_port;
-					std::string query_id; request_stream >> query_id;
-					// check query
-					if (info_->matches_query(query)) {
-						// query matches: send back reply
-						udp::endpoint return_endpoint(remote_endpoint_.address(),(unsigned short)return_port);
-						string_p replymsg(new std::string((query_id += "\r\n") += shortinfo_msg_));
-						socket_->async_send_to(boost::asio::buffer(*replymsg), return_endpoint,
-							boost::bind(&udp_server::handle_send_outcome,shared_from_this(),replymsg,placeholders::error));
-						return;
-					}
-				} else {
-					if (time_services_enabled_ && method == "LSL:timedata") {
-						// timedata request: parse time of original transmission
-						int wave_id; request_stream >> wave_id;
-						double t0; request_stream >> t0;
-						// send it off (including the time of packet submission and a shared ptr to the message content owned by the handler)
-						std::ostringstream reply; reply.precision(16); reply << " " << wave_id << " " << t0 << " " << t1 << " " << lsl_clock();
-						string_p replymsg(new std::string(reply.str()));
-						socket_->async_send_to(boost::asio::buffer(*replymsg), remote_endpoint_,
-							boost::bind(&udp_server::handle_send_outcome,shared_from_this(),replymsg,placeholders::error));
-						return;
-					}
+				for (std::size_t answered=0, count; answered < max_packets_per_wakeup && (count = receive_batch()); answered += count) {
+					// remember the time of packet reception for possible later use (unless the kernel has stamped the packets)
+					double t1 = time_services_enabled_ ? lsl_clock() : 0.0;
+					for (std::size_t k=0; k<count; k++)
+						process_packet(&buffers_[k*max_packet_bytes],lengths_[k],senders_[k],times_[k] ? times_[k] : t1);
 				}
 			}
 		} catch(std::exception &e) {
@@ -149,11 +140,89 @@ void udp_server::handle_receive_outcome(error_code err, std::size_t len) {
 	}
 }
 
-/// Handler that's called after a response packet has been sent off.
-void udp_server::handle_send_outcome(string_p /*replymsg*/, error_code err) {
-	if (err != error::operation_aborted && err != error::shut_down)
-		// done sending: ask for next packet
-		request_next_packet();
+/// Receive a batch of waiting packets without blocking (with their kernel receive time stamps, where available); returns the number of packets received.
+std::size_t udp_server::receive_batch() {
+#ifdef __linux__
+	// receive as many packets as are waiting (up to a batch) with a single system call
+	mmsghdr msgs[batch_packets];
+	iovec iovs[batch_packets];
+	receive_time_control controls[batch_packets];
+	memset(msgs,0,sizeof(msgs));
+	for (std::size_t k=0; k<batch_packets; k++) {
+		iovs[k].iov_base = &buffers_[k*max_packet_bytes];
+		iovs[k].iov_len = max_packet_bytes;
+		msgs[k].msg_hdr.msg_iov = &iovs[k];
+		msgs[k].msg_hdr.msg_iovlen = 1;
+		msgs[k].msg_hdr.msg_name = senders_[k].data();
+		msgs[k].msg_hdr.msg_namelen = (socklen_t)senders_[k].capacity();
+		if (time_services_enabled_) {
+			msgs[k].msg_hdr.msg_control = controls[k].buf;
+			msgs[k].msg_hdr.msg_controllen = sizeof(controls[k].buf);
+		}
+	}
+	int count = recvmmsg(socket_->native_handle(),msgs,batch_packets,MSG_DONTWAIT,NULL);
+	if (count <= 0)
+		return 0;
+	for (int k=0; k<count; k++) {
+		senders_[k].resize(msgs[k].msg_hdr.msg_namelen);
+		lengths_[k] = msgs[k].msg_len;
+		times_[k] = time_services_enabled_ ? kernel_receive_time(msgs[k].msg_hdr) : 0.0;
+	}
+	return (std::size_t)count;
+#else
+	// receive a single packet (if one is waiting)
+	error_code ec;
+	lengths_[0] = socket_->receive_from(boost::asio::buffer(&buffers_[0],max_packet_bytes),senders_[0],0,ec);
+	times_[0] = 0.0;
+	return ec ? 0 : 1;
+#endif
 }
 
+/// Answer a received packet.
+/// @param t1 The time at which the packet was received (if the time services are enabled).
+void udp_server::process_packet(char *data, std::size_t len, const udp::endpoint &sender, double t1) {
+	try {
+		if (time_services_enabled_ && is_time_request(data,len)) {
+			// binary timedata request: turn it into the reply in place and send it off right away (stamped as late as possible)
+			make_time_reply(data,t1);
+			put_time_reply_t2(data,lsl_clock());
+			error_code ec;
+			socket_->send_to(boost::asio::buffer(data,time_reply_bytes),sender,0,ec);
+			return;
+		}
+		// wrap received packet into a request stream and parse the method from it
+		std::istringstream request_stream(std::string(data,data+len));
+		std::string method; getline(request_stream,method); boost::trim(method);
+		if (method == "LSL:shortinfo") {
+			// shortinfo request: parse content query string
+			std::string query; getline(request_stream,query); boost::trim(query);
+			// parse return address, port, and query ID
+			int return_port; request_stream >> return_port;
+			std::string query_id; request_stream >> query_id;
+			// check query
+			if (info_->matches_query(query)) {
+				// query matches: send back reply
+				udp::endpoint return_endpoint(sender.address(),(unsigned short)return_port);
+				string_p replymsg(new std::string((query_id += "\r\n") += shortinfo_msg_));
+				socket_->async_send_to(boost::asio::buffer(*replymsg), return_endpoint,
+					strand_.wrap(boost::bind(&udp_server::handle_send_outcome,shared_from_this(),replymsg,placeholders::error)));
+			}
+		} else {
+			if (time_services_enabled_ && method == "LSL:timedata") {
+				// timedata request: parse time of original transmission
+				int wave_id; request_stream >> wave_id;
+				double t0; request_stream >> t0;
+				// send it off (including the time of packet submission)
+				std::ostringstream reply; reply.precision(16); reply << " " << wave_id << " " << t0 << " " << t1 << " " << lsl_clock();
+				std::string replymsg(reply.str());
+				error_code ec;
+				socket_->send_to(boost::asio::buffer(replymsg), sender, 0, ec);
+			}
+		}
+	} catch(std::exception &e) {
+		std::cerr << "udp_server: hiccup during request processing: " << e.what() << std::endl;
+	}
+}
 
+/// Handler that's called after a response packet has been sent off (merely keeps the message alive until then).
+void udp_server::handle_send_outcome(string_p /*replymsg*/, error_code /*err*/) { }
@@ -4,6 +4,7 @@
 #include "common.h"
 #include "stream_info_impl.h"
 #include <boost/asio.hpp>
+#include <boost/scoped_array.hpp>
 #include <boost/enable_shared_from_this.hpp>
 
 
@@ -18,12 +19,17 @@ namespace lsl {
 	typedef boost::shared_ptr<class udp_server> udp_server_p;
 	/// shared pointer to a socket
 	typedef boost::shared_ptr<udp::socket> udp_socket_p;
+	/// pointer to an io_service
+	typedef boost::shared_ptr<boost::asio::io_service> io_service_p;
 
 	/*
 	* A lightweight UDP responder service.
 	* Understands the following messages:
 	*  * LSL:shortinfo. This is a request for the stream_info that comes with a query string (and a return address). A packet is returned only if the query matches.
 	*  * LSL:timedata.  This is a request for time synchronization info that comes with a time stamp (t0). The t0 stamp and two more time stamps (t1 and t2) are returned (similar to the NTP packet exchange).
+	*  * Binary time-probe requests (see time_probe.h), which are answered like LSL:timedata, but with a fixed packet layout.
+	* Waiting packets are received in batches (with a single system call where supported) and answered right away. Where supported,
+	* time requests are stamped (t1) with their receive times from the kernel, so that the dispatch delays of the server do not count.
 	*/
 	class udp_server: public boost::enable_shared_from_this<udp_server> {
 	public:
@@ -31,15 +37,16 @@ namespace lsl {
 		* Create a UDP responder that listens "side by side" with a TCP server.
 		* This server will listen on a free local port for timedata and shortinfo requests -- mainly for timing information (unless shortinfo is needed by clients).
 		* @param info The stream_info of the stream to serve (shared). After success, the appropriate service port will be assigned.
+		* @param io The IO service on which the server runs (may be shared with other servers).
 		* @param protocol The protocol stack to use (tcp::v4() or tcp::v6()).
 		*/
-		udp_server(const stream_info_impl_p &info, boost::asio::io_service &io, udp protocol);
+		udp_server(const stream_info_impl_p &info, const io_service_p &io, udp protocol);
 
 		/**
 		* Create a new UDP server in multicast mode.
 		* This server will listen on a multicast address and responds only to LSL:shortinfo requests. This is for multicast/broadcast (and optionally unicast) local service discovery.
 		*/
-		udp_server(const stream_info_impl_p &info, boost::asio::io_service &io, const std::string &address, int port, int ttl, const std::string &listen_address);
+		udp_server(const stream_info_impl_p &info, const io_service_p &io, const std::string &address, int port, int ttl, const std::string &listen_address);
 
 
 		/// Start serving UDP traffic.
@@ -54,19 +61,32 @@ namespace lsl {
 		/// The result of the operation will eventually trigger the handle_receive_outcome() handler.
 		void request_next_packet();
 
-		/// Handler that gets called when a the next packet was received (or the op was cancelled).
-		void handle_receive_outcome(error_code err, std::size_t len);
+		/// Handler that gets called when packets are waiting to be received (or the op was cancelled); receives and answers them in batches.
+		void handle_receive_outcome(error_code err);
 
-		/// Handler that gets called after a response packet has been sent off.
+		/// Receive a batch of waiting packets without blocking (with their kernel receive time stamps, where available); returns the number of packets received.
+		std::size_t receive_batch();
+
+		/// Answer a received packet.
+		/// @param t1 The time at which the packet was received (if the time services are enabled).
+		void process_packet(char *data, std::size_t len, const udp::endpoint &sender, double t1);
+
+		/// Handler that gets called after a response packet has been sent off (merely keeps the message alive until then).
 		void handle_send_outcome(string_p replymsg, error_code err);
 
+		/// The maximum number of packets that are received at once and the maximum size of a packet.
+		enum { batch_packets = 16, max_packet_bytes = 65536 };
+
 		stream_info_impl_p info_;			// stream_info reference
-		boost::asio::io_service &io_;		// IO service reference
+		io_service_p io_;					// IO service pointer; keeps the IO (which may be shared by many outlets) around while handlers are pending
+		boost::asio::io_service::strand strand_;	// strand on which our handlers run (the IO service may be run by several threads)
 		udp_socket_p socket_;				// our socket
 
-		char buffer_[65536];				// a buffer of data (we're receiving on it)
+		boost::scoped_array<char> buffers_;	// the buffers of a batch of packets (one maximum-size packet each; memory is only committed once used)
+		std::size_t lengths_[batch_packets];	// the lengths of the packets of the current batch
+		udp::endpoint senders_[batch_packets];	// the endpoints that sent the packets of the current batch
+		double times_[batch_packets];		// the kernel receive time stamps of the packets of the current batch (0 if not stamped)
 		bool time_services_enabled_;		// whether the time services are enabled
-		udp::endpoint remote_endpoint_;		// the endpoint that we're currently talking to
 		std::string shortinfo_msg_;			// pre-computed server response
 	};
 }
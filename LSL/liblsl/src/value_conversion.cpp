@@ -0,0 +1,824 @@
+#include "value_conversion.h"
+#include "sample.h"
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+#include <clocale>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+#include <boost/cstdint.hpp>
+#include <boost/thread/once.hpp>
+
+// SSE2 is part of every x86-64 CPU (and can be enabled for 32-bit builds)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define LSL_CONVERT_SSE2
+	#include <emmintrin.h>
+#endif
+// AVX2 kernels are compiled for a specific target and are only used if the CPU supports them
+#if defined(LSL_CONVERT_SSE2) && defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9) || defined(__clang__))
+	#define LSL_CONVERT_AVX2
+	#define LSL_TARGET_AVX2 __attribute__((target("avx2")))
+	#include <immintrin.h>
+#endif
+
+
+// === implementation of the numeric value conversions ===
+
+using namespace lsl;
+
+namespace {
+
+	/// Signature of a conversion kernel.
+	typedef void (*conversion_fn)(const void *src, void *dst, std::size_t num_values);
+	/// Signature of a kernel that works in place.
+	typedef void (*inplace_fn)(void *data, std::size_t num_values);
+
+	/// Saturating conversion of a single value (by target category: floating-point, from floating-point, between integers).
+	template<class S, class D, bool DstFloat=boost::is_floating_point<D>::value, bool SrcFloat=boost::is_floating_point<S>::value> struct saturate {
+		static D apply(S v) { return (D)v; }
+	};
+	template<class S, class D> struct saturate<S,D,false,true> {
+		static D apply(S v) {
+			if (v != v)
+				return 0;
+			if (v <= (S)std::numeric_limits<D>::min())
+				return std::numeric_limits<D>::min();
+			if (v >= (S)std::numeric_limits<D>::max())
+				return std::numeric_limits<D>::max();
+			return (D)v;
+		}
+	};
+	template<class S, class D> struct saturate<S,D,false,false> {
+		static D apply(S v) {
+			if (sizeof(S) > sizeof(D)) {
+				if (v < (S)std::numeric_limits<D>::min())
+					return std::numeric_limits<D>::min();
+				if (v > (S)std::numeric_limits<D>::max())
+					return std::numeric_limits<D>::max();
+			}
+			return (D)v;
+		}
+	};
+
+	/// Scalar conversion kernel (used for all format pairs, and for the remainder of the vectorized kernels).
+	template<class S, class D> void convert_scalar(const void *src, void *dst, std::size_t num_values) {
+		const S *s = (const S*)src; D *d = (D*)dst;
+		for (const S *e=s+num_values; s<e; *d++ = saturate<S,D>::apply(*s++));
+	}
+
+	/// Scalar byte reversal kernel (the values may be unaligned, e.g., behind the header of a wire encoding).
+	template<class T> void reverse_scalar(void *data, std::size_t num_values) {
+		for (char *p=(char*)data,*e=p+num_values*sizeof(T); p<e; p+=sizeof(T)) {
+			T value;
+			memcpy(&value,p,sizeof(T));
+			lslboost::endian::reverse(value);
+			memcpy(p,&value,sizeof(T));
+		}
+	}
+
+	/// Scalar subnormal flushing kernels.
+	void flush_float_scalar(void *data, std::size_t num_values) {
+		for (boost::uint32_t *p=(boost::uint32_t*)data,*e=p+num_values; p<e; p++)
+			if (*p && ((*p & UINT32_C(0x7fffffff)) <= UINT32_C(0x007fffff)))
+				*p &= UINT32_C(0x80000000);
+	}
+#ifndef BOOST_NO_INT64_T
+	void flush_double_scalar(void *data, std::size_t num_values) {
+		for (boost::uint64_t *p=(boost::uint64_t*)data,*e=p+num_values; p<e; p++)
+			if (*p && ((*p & UINT64_C(0x7fffffffffffffff)) <= UINT64_C(0x000fffffffffffff)))
+				*p &= UINT64_C(0x8000000000000000);
+	}
+#endif
+
+#ifdef LSL_CONVERT_SSE2
+	/// Loading and (saturating) storing of 4 integers of a given type as 32-bit lanes.
+	template<class T> struct sse2_int;
+	template<> struct sse2_int<boost::int8_t> {
+		static __m128i load4(const boost::int8_t *p) {
+			boost::int32_t v; memcpy(&v,p,4);
+			__m128i x = _mm_cvtsi32_si128(v);
+			x = _mm_unpacklo_epi8(x,x);
+			return _mm_srai_epi32(_mm_unpacklo_epi16(x,x),24);
+		}
+		static void store4(boost::int8_t *p, __m128i x) {
+			x = _mm_packs_epi32(x,x);
+			boost::int32_t v = _mm_cvtsi128_si32(_mm_packs_epi16(x,x));
+			memcpy(p,&v,4);
+		}
+	};
+	template<> struct sse2_int<boost::int16_t> {
+		static __m128i load4(const boost::int16_t *p) {
+			__m128i x = _mm_loadl_epi64((const __m128i*)p);
+			return _mm_srai_epi32(_mm_unpacklo_epi16(x,x),16);
+		}
+		static void store4(boost::int16_t *p, __m128i x) { _mm_storel_epi64((__m128i*)p,_mm_packs_epi32(x,x)); }
+	};
+	template<> struct sse2_int<boost::int32_t> {
+		static __m128i load4(const boost::int32_t *p) { return _mm_loadu_si128((const __m128i*)p); }
+		static void store4(boost::int32_t *p, __m128i x) { _mm_storeu_si128((__m128i*)p,x); }
+	};
+
+	/// Convert 4 floats into 32-bit integers, saturated to the range of D.
+	template<class D> inline __m128i sse2_cvt_float(__m128 x) {
+		x = _mm_and_ps(x,_mm_cmpord_ps(x,x));
+		if (sizeof(D) == 4) {
+			// out-of-range values come out as 0x80000000; flip those that overflowed upwards into 0x7FFFFFFF
+			__m128i overflow = _mm_castps_si128(_mm_cmpge_ps(x,_mm_set1_ps(2147483648.0f)));
+			return _mm_xor_si128(_mm_cvttps_epi32(_mm_max_ps(x,_mm_set1_ps(-2147483648.0f))),overflow);
+		}
+		return _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(x,_mm_set1_ps((float)std::numeric_limits<D>::min())),_mm_set1_ps((float)std::numeric_limits<D>::max())));
+	}
+
+	/// Convert 2x2 doubles into 32-bit integers, saturated to the range of D.
+	template<class D> inline __m128i sse2_cvt_double(__m128d lo, __m128d hi) {
+		const __m128d minval = _mm_set1_pd((double)std::numeric_limits<D>::min()), maxval = _mm_set1_pd((double)std::numeric_limits<D>::max());
+		lo = _mm_min_pd(_mm_max_pd(_mm_and_pd(lo,_mm_cmpord_pd(lo,lo)),minval),maxval);
+		hi = _mm_min_pd(_mm_max_pd(_mm_and_pd(hi,_mm_cmpord_pd(hi,hi)),minval),maxval);
+		return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo),_mm_cvttpd_epi32(hi));
+	}
+
+	template<class S, class D> void sse2_int_to_int(const void *src, void *dst, std::size_t num_values) {
+		const S *s = (const S*)src; D *d = (D*)dst;
+		for (; num_values >= 4; num_values-=4, s+=4, d+=4)
+			sse2_int<D>::store4(d,sse2_int<S>::load4(s));
+		convert_scalar<S,D>(s,d,num_values);
+	}
+
+	template<class S> void sse2_int_to_float(const void *src, void *dst, std::size_t num_values) {
+		const S *s = (const S*)src; float *d = (float*)dst;
+		for (; num_values >= 4; num_values-=4, s+=4, d+=4)
+			_mm_storeu_ps(d,_mm_cvtepi32_ps(sse2_int<S>::load4(s)));
+		convert_scalar<S,float>(s,d,num_values);
+	}
+
+	template<class S> void sse2_int_to_double(const void *src, void *dst, std::size_t num_values) {
+		const S *s = (const S*)src; double *d = (double*)dst;
+		for (; num_values >= 4; num_values-=4, s+=4, d+=4) {
+			__m128i x = sse2_int<S>::load4(s);
+			_mm_storeu_pd(d,_mm_cvtepi32_pd(x));
+			_mm_storeu_pd(d+2,_mm_cvtepi32_pd(_mm_shuffle_epi32(x,_MM_SHUFFLE(1,0,3,2))));
+		}
+		convert_scalar<S,double>(s,d,num_values);
+	}
+
+	template<class D> void sse2_float_to_int(const void *src, void *dst, std::size_t num_values) {
+		const float *s = (const float*)src; D *d = (D*)dst;
+		for (; num_values >= 4; num_values-=4, s+=4, d+=4)
+			sse2_int<D>::store4(d,sse2_cvt_float<D>(_mm_loadu_ps(s)));
+		convert_scalar<float,D>(s,d,num_values);
+	}
+
+	template<class D> void sse2_double_to_int(const void *src, void *dst, std::size_t num_values) {
+		const double *s = (const double*)src; D *d = (D*)dst;
+		for (; num_values >= 4; num_values-=4, s+=4, d+=4)
+			sse2_int<D>::store4(d,sse2_cvt_double<D>(_mm_loadu_pd(s),_mm_loadu_pd(s+2)));
+		convert_scalar<double,D>(s,d,num_values);
+	}
+
+	void sse2_float_to_double(const void *src, void *dst, std::size_t num_values) {
+		const float *s = (const float*)src; double *d = (double*)dst;
+		for (; num_values >= 4; num_values-=4, s+=4, d+=4) {
+			__m128 x = _mm_loadu_ps(s);
+			_mm_storeu_pd(d,_mm_cvtps_pd(x));
+			_mm_storeu_pd(d+2,_mm_cvtps_pd(_mm_movehl_ps(x,x)));
+		}
+		convert_scalar<float,double>(s,d,num_values);
+	}
+
+	void sse2_double_to_float(const void *src, void *dst, std::size_t num_values) {
+		const double *s = (const double*)src; float *d = (float*)dst;
+		for (; num_values >= 4; num_values-=4, s+=4, d+=4)
+			_mm_storeu_ps(d,_mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(s)),_mm_cvtpd_ps(_mm_loadu_pd(s+2))));
+		convert_scalar<double,float>(s,d,num_values);
+	}
+
+	/// Swap the bytes within each 16-bit lane.
+	inline __m128i sse2_swap16(__m128i x) { return _mm_or_si128(_mm_slli_epi16(x,8),_mm_srli_epi16(x,8)); }
+
+	void sse2_reverse16(void *data, std::size_t num_values) {
+		char *p = (char*)data;
+		for (; num_values >= 8; num_values-=8, p+=16)
+			_mm_storeu_si128((__m128i*)p,sse2_swap16(_mm_loadu_si128((const __m128i*)p)));
+		reverse_scalar<boost::int16_t>(p,num_values);
+	}
+
+	void sse2_reverse32(void *data, std::size_t num_values) {
+		char *p = (char*)data;
+		for (; num_values >= 4; num_values-=4, p+=16) {
+			__m128i x = sse2_swap16(_mm_loadu_si128((const __m128i*)p));
+			_mm_storeu_si128((__m128i*)p,_mm_shufflehi_epi16(_mm_shufflelo_epi16(x,_MM_SHUFFLE(2,3,0,1)),_MM_SHUFFLE(2,3,0,1)));
+		}
+		reverse_scalar<boost::int32_t>(p,num_values);
+	}
+
+#ifndef BOOST_NO_INT64_T
+	void sse2_reverse64(void *data, std::size_t num_values) {
+		char *p = (char*)data;
+		for (; num_values >= 2; num_values-=2, p+=16) {
+			__m128i x = sse2_swap16(_mm_loadu_si128((const __m128i*)p));
+			_mm_storeu_si128((__m128i*)p,_mm_shufflehi_epi16(_mm_shufflelo_epi16(x,_MM_SHUFFLE(0,1,2,3)),_MM_SHUFFLE(0,1,2,3)));
+		}
+		reverse_scalar<boost::int64_t>(p,num_values);
+	}
+#endif
+
+	void sse2_flush_float(void *data, std::size_t num_values) {
+		char *p = (char*)data;
+		const __m128i expmask = _mm_set1_epi32(0x7f800000), absmask = _mm_set1_epi32(0x7fffffff);
+		for (; num_values >= 4; num_values-=4, p+=16) {
+			__m128i x = _mm_loadu_si128((const __m128i*)p);
+			// values with a zero exponent are zeros or subnormals: clear everything but their sign
+			__m128i subnormal = _mm_cmpeq_epi32(_mm_and_si128(x,expmask),_mm_setzero_si128());
+			_mm_storeu_si128((__m128i*)p,_mm_andnot_si128(_mm_and_si128(subnormal,absmask),x));
+		}
+		flush_float_scalar(p,num_values);
+	}
+
+#ifndef BOOST_NO_INT64_T
+	void sse2_flush_double(void *data, std::size_t num_values) {
+		char *p = (char*)data;
+		const __m128i expmask = _mm_set_epi32(0x7ff00000,0,0x7ff00000,0), absmask = _mm_set_epi32(0x7fffffff,-1,0x7fffffff,-1);
+		for (; num_values >= 2; num_values-=2, p+=16) {
+			__m128i x = _mm_loadu_si128((const __m128i*)p);
+			// the exponent is in the upper half of each value: compare that and broadcast the result to the whole value
+			__m128i subnormal = _mm_shuffle_epi32(_mm_cmpeq_epi32(_mm_and_si128(x,expmask),_mm_setzero_si128()),_MM_SHUFFLE(3,3,1,1));
+			_mm_storeu_si128((__m128i*)p,_mm_andnot_si128(_mm_and_si128(subnormal,absmask),x));
+		}
+		flush_double_scalar(p,num_values);
+	}
+#endif
+#endif
+
+#ifdef LSL_CONVERT_AVX2
+	/// Whether the CPU that we're running on supports AVX2.
+	bool cpu_has_avx2() {
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") != 0;
+	}
+
+	LSL_TARGET_AVX2 void avx2_int16_to_float(const void *src, void *dst, std::size_t num_values) {
+		const boost::int16_t *s = (const boost::int16_t*)src; float *d = (float*)dst;
+		for (; num_values >= 8; num_values-=8, s+=8, d+=8)
+			_mm256_storeu_ps(d,_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)s))));
+		convert_scalar<boost::int16_t,float>(s,d,num_values);
+	}
+
+	LSL_TARGET_AVX2 void avx2_int32_to_float(const void *src, void *dst, std::size_t num_values) {
+		const boost::int32_t *s = (const boost::int32_t*)src; float *d = (float*)dst;
+		for (; num_values >= 8; num_values-=8, s+=8, d+=8)
+			_mm256_storeu_ps(d,_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)s)));
+		convert_scalar<boost::int32_t,float>(s,d,num_values);
+	}
+
+	LSL_TARGET_AVX2 void avx2_float_to_int16(const void *src, void *dst, std::size_t num_values) {
+		const float *s = (const float*)src; boost::int16_t *d = (boost::int16_t*)dst;
+		const __m256 minval = _mm256_set1_ps(-32768.0f), maxval = _mm256_set1_ps(32767.0f);
+		for (; num_values >= 8; num_values-=8, s+=8, d+=8) {
+			__m256 x = _mm256_loadu_ps(s);
+			x = _mm256_min_ps(_mm256_max_ps(_mm256_and_ps(x,_mm256_cmp_ps(x,x,_CMP_ORD_Q)),minval),maxval);
+			__m256i i = _mm256_cvttps_epi32(x);
+			_mm_storeu_si128((__m128i*)d,_mm_packs_epi32(_mm256_castsi256_si128(i),_mm256_extracti128_si256(i,1)));
+		}
+		convert_scalar<float,boost::int16_t>(s,d,num_values);
+	}
+
+	LSL_TARGET_AVX2 void avx2_float_to_int32(const void *src, void *dst, std::size_t num_values) {
+		const float *s = (const float*)src; boost::int32_t *d = (boost::int32_t*)dst;
+		const __m256 minval = _mm256_set1_ps(-2147483648.0f), limit = _mm256_set1_ps(2147483648.0f);
+		for (; num_values >= 8; num_values-=8, s+=8, d+=8) {
+			__m256 x = _mm256_loadu_ps(s);
+			x = _mm256_and_ps(x,_mm256_cmp_ps(x,x,_CMP_ORD_Q));
+			__m256i overflow = _mm256_castps_si256(_mm256_cmp_ps(x,limit,_CMP_GE_OQ));
+			_mm256_storeu_si256((__m256i*)d,_mm256_xor_si256(_mm256_cvttps_epi32(_mm256_max_ps(x,minval)),overflow));
+		}
+		convert_scalar<float,boost::int32_t>(s,d,num_values);
+	}
+
+	LSL_TARGET_AVX2 void avx2_float_to_double(const void *src, void *dst, std::size_t num_values) {
+		const float *s = (const float*)src; double *d = (double*)dst;
+		for (; num_values >= 4; num_values-=4, s+=4, d+=4)
+			_mm256_storeu_pd(d,_mm256_cvtps_pd(_mm_loadu_ps(s)));
+		convert_scalar<float,double>(s,d,num_values);
+	}
+
+	LSL_TARGET_AVX2 void avx2_double_to_float(const void *src, void *dst, std::size_t num_values) {
+		const double *s = (const double*)src; float *d = (float*)dst;
+		for (; num_values >= 4; num_values-=4, s+=4, d+=4)
+			_mm_storeu_ps(d,_mm256_cvtpd_ps(_mm256_loadu_pd(s)));
+		convert_scalar<double,float>(s,d,num_values);
+	}
+
+	template<class T> LSL_TARGET_AVX2 void avx2_reverse(void *data, std::size_t num_values) {
+		char *p = (char*)data, mask[32];
+		for (int k=0; k<32; k++)
+			mask[k] = (char)((k/sizeof(T))*sizeof(T) + sizeof(T)-1 - k%sizeof(T));
+		const __m256i shuffle = _mm256_loadu_si256((const __m256i*)mask);
+		for (; num_values >= 32/sizeof(T); num_values-=32/sizeof(T), p+=32)
+			_mm256_storeu_si256((__m256i*)p,_mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)p),shuffle));
+		reverse_scalar<T>(p,num_values);
+	}
+#endif
+
+	/// The conversion kernels, indexed by [source format][destination format] (NULL for unsupported pairs).
+	conversion_fn conversions[8][8];
+	/// The byte reversal kernels, indexed by value size.
+	inplace_fn reversals[9];
+	/// The subnormal flushing kernels, indexed by channel format.
+	inplace_fn flushes[8];
+	boost::once_flag kernels_once = BOOST_ONCE_INIT;
+
+	/// Register the scalar kernels for a given source type.
+	template<class S> void register_scalar(channel_format_t fmt) {
+		conversions[fmt][cf_float32] = &convert_scalar<S,float>;
+		conversions[fmt][cf_double64] = &convert_scalar<S,double>;
+		conversions[fmt][cf_int8] = &convert_scalar<S,boost::int8_t>;
+		conversions[fmt][cf_int16] = &convert_scalar<S,boost::int16_t>;
+		conversions[fmt][cf_int32] = &convert_scalar<S,boost::int32_t>;
+#ifndef BOOST_NO_INT64_T
+		conversions[fmt][cf_int64] = &convert_scalar<S,boost::int64_t>;
+#endif
+	}
+
+	/// Fill the kernel tables with the fastest kernels that are supported on this machine.
+	void init_kernels() {
+		register_scalar<float>(cf_float32);
+		register_scalar<double>(cf_double64);
+		register_scalar<boost::int8_t>(cf_int8);
+		register_scalar<boost::int16_t>(cf_int16);
+		register_scalar<boost::int32_t>(cf_int32);
+#ifndef BOOST_NO_INT64_T
+		register_scalar<boost::int64_t>(cf_int64);
+#endif
+		reversals[sizeof(boost::int16_t)] = &reverse_scalar<boost::int16_t>;
+		reversals[sizeof(boost::int32_t)] = &reverse_scalar<boost::int32_t>;
+		flushes[cf_float32] = &flush_float_scalar;
+#ifndef BOOST_NO_INT64_T
+		reversals[sizeof(boost::int64_t)] = &reverse_scalar<boost::int64_t>;
+		flushes[cf_double64] = &flush_double_scalar;
+#endif
+#ifdef LSL_CONVERT_SSE2
+		conversions[cf_int8][cf_int16] = &sse2_int_to_int<boost::int8_t,boost::int16_t>;
+		conversions[cf_int8][cf_int32] = &sse2_int_to_int<boost::int8_t,boost::int32_t>;
+		conversions[cf_int16][cf_int8] = &sse2_int_to_int<boost::int16_t,boost::int8_t>;
+		conversions[cf_int16][cf_int32] = &sse2_int_to_int<boost::int16_t,boost::int32_t>;
+		conversions[cf_int32][cf_int8] = &sse2_int_to_int<boost::int32_t,boost::int8_t>;
+		conversions[cf_int32][cf_int16] = &sse2_int_to_int<boost::int32_t,boost::int16_t>;
+		conversions[cf_int8][cf_float32] = &sse2_int_to_float<boost::int8_t>;
+		conversions[cf_int16][cf_float32] = &sse2_int_to_float<boost::int16_t>;
+		conversions[cf_int32][cf_float32] = &sse2_int_to_float<boost::int32_t>;
+		conversions[cf_int8][cf_double64] = &sse2_int_to_double<boost::int8_t>;
+		conversions[cf_int16][cf_double64] = &sse2_int_to_double<boost::int16_t>;
+		conversions[cf_int32][cf_double64] = &sse2_int_to_double<boost::int32_t>;
+		conversions[cf_float32][cf_int8] = &sse2_float_to_int<boost::int8_t>;
+		conversions[cf_float32][cf_int16] = &sse2_float_to_int<boost::int16_t>;
+		conversions[cf_float32][cf_int32] = &sse2_float_to_int<boost::int32_t>;
+		conversions[cf_double64][cf_int8] = &sse2_double_to_int<boost::int8_t>;
+		conversions[cf_double64][cf_int16] = &sse2_double_to_int<boost::int16_t>;
+		conversions[cf_double64][cf_int32] = &sse2_double_to_int<boost::int32_t>;
+		conversions[cf_float32][cf_double64] = &sse2_float_to_double;
+		conversions[cf_double64][cf_float32] = &sse2_double_to_float;
+		reversals[sizeof(boost::int16_t)] = &sse2_reverse16;
+		reversals[sizeof(boost::int32_t)] = &sse2_reverse32;
+		flushes[cf_float32] = &sse2_flush_float;
+#ifndef BOOST_NO_INT64_T
+		reversals[sizeof(boost::int64_t)] = &sse2_reverse64;
+		flushes[cf_double64] = &sse2_flush_double;
+#endif
+#endif
+#ifdef LSL_CONVERT_AVX2
+		if (cpu_has_avx2()) {
+			conversions[cf_int16][cf_float32] = &avx2_int16_to_float;
+			conversions[cf_int32][cf_float32] = &avx2_int32_to_float;
+			conversions[cf_float32][cf_int16] = &avx2_float_to_int16;
+			conversions[cf_float32][cf_int32] = &avx2_float_to_int32;
+			conversions[cf_float32][cf_double64] = &avx2_float_to_double;
+			conversions[cf_double64][cf_float32] = &avx2_double_to_float;
+			reversals[sizeof(boost::int16_t)] = &avx2_reverse<boost::int16_t>;
+			reversals[sizeof(boost::int32_t)] = &avx2_reverse<boost::int32_t>;
+			reversals[sizeof(boost::int64_t)] = &avx2_reverse<boost::int64_t>;
+		}
+#endif
+	}
+}
+
+/**
+* Convert an array of numeric values from one channel format into another.
+* Conversions into an integer format saturate at the limits of the target type (NaN becomes 0) and
+* floating-point values are truncated towards zero.
+* @param src_format The channel format of the source values.
+* @param src The source values.
+* @param dst_format The channel format of the destination values.
+* @param dst The destination array (must not overlap with the source).
+* @param num_values The number of values to convert.
+*/
+void lsl::convert_values(channel_format_t src_format, const void *src, channel_format_t dst_format, void *dst, std::size_t num_values) {
+	if (src_format == dst_format && src_format != cf_string && src_format != cf_undefined) {
+		memcpy(dst,src,format_sizes[src_format]*num_values);
+		return;
+	}
+	boost::call_once(&init_kernels,kernels_once);
+	conversion_fn fn = ((unsigned)src_format < 8 && (unsigned)dst_format < 8) ? conversions[src_format][dst_format] : NULL;
+	if (!fn)
+		throw std::invalid_argument("Unsupported channel format.");
+	fn(src,dst,num_values);
+}
+
+/**
+* Reverse the byte order of an array of values in place.
+* @param data The values to convert (need not be aligned).
+* @param value_size The size of each value in bytes (1, 2, 4 or 8).
+* @param num_values The number of values.
+*/
+void lsl::reverse_byte_order(void *data, std::size_t value_size, std::size_t num_values) {
+	if (value_size == 1)
+		return;
+	boost::call_once(&init_kernels,kernels_once);
+	inplace_fn fn = value_size < 9 ? reversals[value_size] : NULL;
+	if (!fn)
+		throw std::runtime_error("Unsupported channel format for endian conversion.");
+	fn(data,num_values);
+}
+
+/**
+* Flush subnormal floating-point values to zero (retaining the sign) in place.
+* @param format The channel format of the values (values of non-floating-point formats are left alone).
+* @param data The values to process.
+* @param num_values The number of values.
+*/
+void lsl::flush_subnormals(channel_format_t format, void *data, std::size_t num_values) {
+	boost::call_once(&init_kernels,kernels_once);
+	if (inplace_fn fn = (unsigned)format < 8 ? flushes[format] : NULL)
+		fn(data,num_values);
+}
+
+
+// === conversions between numbers and strings ===
+
+namespace {
+
+	/// A floating-point number f*2^e with a 64-bit significand (used for the shortest number formatting, after the Grisu2 algorithm by F. Loitsch).
+	struct diy_fp {
+		diy_fp(boost::uint64_t f, int e): f(f), e(e) {}
+		boost::uint64_t f;
+		int e;
+	};
+
+	inline diy_fp operator-(const diy_fp &a, const diy_fp &b) { return diy_fp(a.f-b.f,a.e); }
+
+	/// Multiply two numbers and round the 128-bit product to its upper 64 bits.
+	inline diy_fp operator*(const diy_fp &a, const diy_fp &b) {
+		const boost::uint64_t M32 = 0xFFFFFFFF;
+		boost::uint64_t ah = a.f >> 32, al = a.f & M32, bh = b.f >> 32, bl = b.f & M32;
+		boost::uint64_t hh = ah*bh, lh = al*bh, hl = ah*bl, ll = al*bl;
+		boost::uint64_t mid = (ll >> 32) + (hl & M32) + (lh & M32) + (UINT64_C(1) << 31);
+		return diy_fp(hh + (hl >> 32) + (lh >> 32) + (mid >> 32), a.e + b.e + 64);
+	}
+
+	/// Shift a (non-zero) number so that the most significant bit of its significand is set.
+	inline diy_fp normalize(diy_fp x) {
+		while (!(x.f & UINT64_C(0x8000000000000000))) {
+			x.f <<= 1;
+			x.e--;
+		}
+		return x;
+	}
+
+	/// Get a cached power of ten 10^-K such that the product with a number of binary exponent e has an exponent in [-60,-32].
+	diy_fp cached_power(int e, int &K) {
+		// 10^-348, 10^-340, ..., 10^340 (normalized)
+		static const boost::uint64_t cached_f[] = {
+			UINT64_C(0xfa8fd5a0081c0288), UINT64_C(0xbaaee17fa23ebf76), UINT64_C(0x8b16fb203055ac76), UINT64_C(0xcf42894a5dce35ea),
+			UINT64_C(0x9a6bb0aa55653b2d), UINT64_C(0xe61acf033d1a45df), UINT64_C(0xab70fe17c79ac6ca), UINT64_C(0xff77b1fcbebcdc4f),
+			UINT64_C(0xbe5691ef416bd60c), UINT64_C(0x8dd01fad907ffc3c), UINT64_C(0xd3515c2831559a83), UINT64_C(0x9d71ac8fada6c9b5),
+			UINT64_C(0xea9c227723ee8bcb), UINT64_C(0xaecc49914078536d), UINT64_C(0x823c12795db6ce57), UINT64_C(0xc21094364dfb5637),
+			UINT64_C(0x9096ea6f3848984f), UINT64_C(0xd77485cb25823ac7), UINT64_C(0xa086cfcd97bf97f4), UINT64_C(0xef340a98172aace5),
+			UINT64_C(0xb23867fb2a35b28e), UINT64_C(0x84c8d4dfd2c63f3b), UINT64_C(0xc5dd44271ad3cdba), UINT64_C(0x936b9fcebb25c996),
+			UINT64_C(0xdbac6c247d62a584), UINT64_C(0xa3ab66580d5fdaf6), UINT64_C(0xf3e2f893dec3f126), UINT64_C(0xb5b5ada8aaff80b8),
+			UINT64_C(0x87625f056c7c4a8b), UINT64_C(0xc9bcff6034c13053), UINT64_C(0x964e858c91ba2655), UINT64_C(0xdff9772470297ebd),
+			UINT64_C(0xa6dfbd9fb8e5b88f), UINT64_C(0xf8a95fcf88747d94), UINT64_C(0xb94470938fa89bcf), UINT64_C(0x8a08f0f8bf0f156b),
+			UINT64_C(0xcdb02555653131b6), UINT64_C(0x993fe2c6d07b7fac), UINT64_C(0xe45c10c42a2b3b06), UINT64_C(0xaa242499697392d3),
+			UINT64_C(0xfd87b5f28300ca0e), UINT64_C(0xbce5086492111aeb), UINT64_C(0x8cbccc096f5088cc), UINT64_C(0xd1b71758e219652c),
+			UINT64_C(0x9c40000000000000), UINT64_C(0xe8d4a51000000000), UINT64_C(0xad78ebc5ac620000), UINT64_C(0x813f3978f8940984),
+			UINT64_C(0xc097ce7bc90715b3), UINT64_C(0x8f7e32ce7bea5c70), UINT64_C(0xd5d238a4abe98068), UINT64_C(0x9f4f2726179a2245),
+			UINT64_C(0xed63a231d4c4fb27), UINT64_C(0xb0de65388cc8ada8), UINT64_C(0x83c7088e1aab65db), UINT64_C(0xc45d1df942711d9a),
+			UINT64_C(0x924d692ca61be758), UINT64_C(0xda01ee641a708dea), UINT64_C(0xa26da3999aef774a), UINT64_C(0xf209787bb47d6b85),
+			UINT64_C(0xb454e4a179dd1877), UINT64_C(0x865b86925b9bc5c2), UINT64_C(0xc83553c5c8965d3d), UINT64_C(0x952ab45cfa97a0b3),
+			UINT64_C(0xde469fbd99a05fe3), UINT64_C(0xa59bc234db398c25), UINT64_C(0xf6c69a72a3989f5c), UINT64_C(0xb7dcbf5354e9bece),
+			UINT64_C(0x88fcf317f22241e2), UINT64_C(0xcc20ce9bd35c78a5), UINT64_C(0x98165af37b2153df), UINT64_C(0xe2a0b5dc971f303a),
+			UINT64_C(0xa8d9d1535ce3b396), UINT64_C(0xfb9b7cd9a4a7443c), UINT64_C(0xbb764c4ca7a44410), UINT64_C(0x8bab8eefb6409c1a),
+			UINT64_C(0xd01fef10a657842c), UINT64_C(0x9b10a4e5e9913129), UINT64_C(0xe7109bfba19c0c9d), UINT64_C(0xac2820d9623bf429),
+			UINT64_C(0x80444b5e7aa7cf85), UINT64_C(0xbf21e44003acdd2d), UINT64_C(0x8e679c2f5e44ff8f), UINT64_C(0xd433179d9c8cb841),
+			UINT64_C(0x9e19db92b4e31ba9), UINT64_C(0xeb96bf6ebadf77d9), UINT64_C(0xaf87023b9bf0ee6b)
+		};
+		static const boost::int16_t cached_e[] = {
+			-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927, -901, -874, -847, -821,
+			-794, -768, -741, -715, -688, -661, -635, -608, -582, -555, -529, -502, -475, -449, -422, -396,
+			-369, -343, -316, -289, -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+			56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348, 375, 402, 428, 455,
+			481, 508, 534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+			907, 933, 960, 986, 1013, 1039, 1066
+		};
+		double dk = (-61 - e) * 0.30102999566398114 + 347;
+		int k = (int)dk;
+		if (dk - k > 0.0)
+			k++;
+		unsigned index = (unsigned)((k >> 3) + 1);
+		K = -(-348 + (int)(index << 3));
+		return diy_fp(cached_f[index],cached_e[index]);
+	}
+
+	const boost::uint32_t pow10_32[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+	/// Move the last generated digit towards the exact value as long as the result stays within the rounding interval.
+	inline void grisu_round(char *buffer, int length, boost::uint64_t delta, boost::uint64_t rest, boost::uint64_t ten_kappa, boost::uint64_t wp_w) {
+		while (rest < wp_w && delta - rest >= ten_kappa && (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+			buffer[length-1]--;
+			rest += ten_kappa;
+		}
+	}
+
+	/// Generate the shortest digit string within the interval (Mp-delta, Mp] that is closest to W.
+	void digit_gen(const diy_fp &W, const diy_fp &Mp, boost::uint64_t delta, char *buffer, int &length, int &K) {
+		const diy_fp one(UINT64_C(1) << -Mp.e, Mp.e);
+		const diy_fp wp_w = Mp - W;
+		boost::uint32_t p1 = (boost::uint32_t)(Mp.f >> -one.e);
+		boost::uint64_t p2 = Mp.f & (one.f - 1);
+		int kappa = 1;
+		while (kappa < 10 && p1 >= pow10_32[kappa])
+			kappa++;
+		length = 0;
+		// integral part
+		while (kappa > 0) {
+			boost::uint32_t d = p1 / pow10_32[kappa-1];
+			p1 %= pow10_32[kappa-1];
+			if (d || length)
+				buffer[length++] = (char)('0' + d);
+			kappa--;
+			boost::uint64_t rest = ((boost::uint64_t)p1 << -one.e) + p2;
+			if (rest <= delta) {
+				K += kappa;
+				grisu_round(buffer,length,delta,rest,(boost::uint64_t)pow10_32[kappa] << -one.e,wp_w.f);
+				return;
+			}
+		}
+		// fractional part
+		for (;;) {
+			p2 *= 10;
+			delta *= 10;
+			char d = (char)(p2 >> -one.e);
+			if (d || length)
+				buffer[length++] = (char)('0' + d);
+			p2 &= one.f - 1;
+			kappa--;
+			if (p2 < delta) {
+				K += kappa;
+				grisu_round(buffer,length,delta,p2,one.f,wp_w.f * pow10_32[-kappa]);
+				return;
+			}
+		}
+	}
+
+	/// Generate the shortest digits of the (positive) value f*2^e; the value is then digits*10^K.
+	void grisu2(boost::uint64_t f, int e, bool lower_boundary_closer, char *buffer, int &length, int &K) {
+		diy_fp plus = normalize(diy_fp((f << 1) + 1, e - 1));
+		diy_fp minus = lower_boundary_closer ? diy_fp((f << 2) - 1, e - 2) : diy_fp((f << 1) - 1, e - 1);
+		minus.f <<= minus.e - plus.e;
+		minus.e = plus.e;
+		diy_fp c_mk = cached_power(plus.e,K);
+		diy_fp W = normalize(diy_fp(f,e)) * c_mk, Wp = plus * c_mk, Wm = minus * c_mk;
+		Wm.f++;
+		Wp.f--;
+		digit_gen(W,Wp,Wp.f-Wm.f,buffer,length,K);
+	}
+
+	/// Write the digits*10^K in plain notation if that is reasonably short, otherwise in scientific notation.
+	std::size_t write_decimal(const char *digits, int length, int K, char *buffer) {
+		char *pos = buffer;
+		int point = length + K;	// position of the decimal point relative to the first digit
+		if (length <= point && point <= 21) {
+			// integral value: 1234e2 -> 123400
+			memcpy(pos,digits,length); pos += length;
+			for (int k=length; k<point; k++)
+				*pos++ = '0';
+		} else if (0 < point && point <= 21) {
+			// 1234e-2 -> 12.34
+			memcpy(pos,digits,point); pos += point;
+			*pos++ = '.';
+			memcpy(pos,digits+point,length-point); pos += length-point;
+		} else if (-6 < point && point <= 0) {
+			// 1234e-6 -> 0.001234
+			*pos++ = '0';
+			*pos++ = '.';
+			for (int k=point; k<0; k++)
+				*pos++ = '0';
+			memcpy(pos,digits,length); pos += length;
+		} else {
+			// 1234e30 -> 1.234e+33
+			*pos++ = digits[0];
+			if (length > 1) {
+				*pos++ = '.';
+				memcpy(pos,digits+1,length-1); pos += length-1;
+			}
+			*pos++ = 'e';
+			int exponent = point - 1;
+			*pos++ = exponent < 0 ? '-' : '+';
+			pos += print_unsigned((boost::uint64_t)(exponent < 0 ? -exponent : exponent),pos);
+		}
+		return pos - buffer;
+	}
+
+	/// Format an IEEE 754 number given by its fields.
+	std::size_t format_ieee(bool negative, int biased_exponent, boost::uint64_t significand, int significand_bits, int max_biased_exponent, int bias, char *buffer) {
+		char *pos = buffer;
+		if (biased_exponent == max_biased_exponent && significand) {
+			memcpy(pos,"nan",3);
+			return 3;
+		}
+		if (negative)
+			*pos++ = '-';
+		if (biased_exponent == max_biased_exponent) {
+			memcpy(pos,"inf",3);
+			return pos + 3 - buffer;
+		}
+		if (!biased_exponent && !significand) {
+			*pos++ = '0';
+			return pos - buffer;
+		}
+		boost::uint64_t f = biased_exponent ? significand + (UINT64_C(1) << significand_bits) : significand;
+		int e = (biased_exponent ? biased_exponent : 1) - bias;
+		char digits[24]; int length, K;
+		grisu2(f,e,biased_exponent > 1 && !significand,digits,length,K);
+		return pos - buffer + write_decimal(digits,length,K,pos);
+	}
+
+	const double pow10_exact[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+	/**
+	* Try to parse a plain decimal number ([+-]digits[.digits][(e|E)[+-]digits]) whose value can be computed exactly
+	* in double precision (at most 2^53 as a significand and a decimal exponent of at most 22 in magnitude).
+	* @return False if the number is not of this form (it then needs to go through the slow path).
+	*/
+	bool parse_decimal_fast(const char *p, const char *end, double &value) {
+		bool negative = false;
+		if (p != end && (*p == '-' || *p == '+'))
+			negative = (*p++ == '-');
+		boost::uint64_t significand = 0;
+		int exponent = 0, num_digits = 0, num_significant = 0;
+		for (; p != end && (unsigned)(*p - '0') <= 9; p++, num_digits++) {
+			if (num_significant || *p != '0')
+				if (++num_significant > 19)
+					return false;
+			significand = significand*10 + (*p - '0');
+		}
+		if (p != end && *p == '.') {
+			for (p++; p != end && (unsigned)(*p - '0') <= 9; p++, num_digits++, exponent--) {
+				if (num_significant || *p != '0')
+					if (++num_significant > 19)
+						return false;
+				significand = significand*10 + (*p - '0');
+			}
+		}
+		if (!num_digits)
+			return false;
+		if (p != end && (*p == 'e' || *p == 'E')) {
+			bool negative_exponent = false;
+			if (++p != end && (*p == '-' || *p == '+'))
+				negative_exponent = (*p++ == '-');
+			if (p == end)
+				return false;
+			int explicit_exponent = 0;
+			for (; p != end && (unsigned)(*p - '0') <= 9 && explicit_exponent < 10000; p++)
+				explicit_exponent = explicit_exponent*10 + (*p - '0');
+			exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+		}
+		if (p != end)
+			return false;
+		if (!significand)
+			value = 0.0;
+		else if (significand <= (UINT64_C(1) << 53) && exponent >= -22 && exponent <= 22)
+			value = exponent < 0 ? (double)significand / pow10_exact[-exponent] : (double)significand * pow10_exact[exponent];
+		else
+			return false;
+		if (negative)
+			value = -value;
+		return true;
+	}
+
+	/**
+	* Parse a floating-point number with strtod() (correctly rounded), independently of the current C locale.
+	* Accepts the same inputs as boost::lexical_cast: infinities and NaNs are allowed, but hexadecimal numbers and finite
+	* numbers beyond the range of a double are not.
+	*/
+	bool parse_decimal_slow(const char *begin, const char *end, double &value) {
+		std::size_t length = end - begin;
+		if (!length || isspace((unsigned char)*begin) || memchr(begin,'x',length) || memchr(begin,'X',length))
+			return false;
+		char buffer[64];
+		if (length >= sizeof(buffer)) {
+			// unusually long number: go through a stream in the classic locale
+			std::istringstream stream(std::string(begin,end));
+			stream.imbue(std::locale::classic());
+			stream >> value;
+			return !stream.fail() && stream.peek() == EOF;
+		}
+		memcpy(buffer,begin,length);
+		buffer[length] = 0;
+		// strtod() expects the decimal point of the current C locale
+		char point = *localeconv()->decimal_point;
+		if (point != '.')
+			if (char *dot = (char*)memchr(buffer,'.',length))
+				*dot = point;
+		char *stop;
+		value = strtod(buffer,&stop);
+		if (stop != buffer + length)
+			return false;
+		// an overflow also yields an infinity (but then the number does not start with "inf")
+		if (value == std::numeric_limits<double>::infinity() || value == -std::numeric_limits<double>::infinity())
+			return isalpha((unsigned char)buffer[*buffer == '-' || *buffer == '+']) != 0;
+		return true;
+	}
+}
+
+/// Format an integer in decimal notation; returns the number of characters written (no terminating zero).
+std::size_t lsl::print_unsigned(boost::uint64_t value, char *buffer) {
+	char digits[20]; 
+	int length = 0;
+	do {
+		digits[length++] = (char)('0' + value%10);
+		value /= 10;
+	} while (value);
+	for (int k=0; k<length; k++)
+		buffer[k] = digits[length-1-k];
+	return length;
+}
+
+/// Format an integer in decimal notation; returns the number of characters written (no terminating zero).
+std::size_t lsl::print_integer(boost::int64_t value, char *buffer) {
+	if (value < 0) {
+		buffer[0] = '-';
+		return 1 + print_unsigned(0 - (boost::uint64_t)value,buffer+1);
+	}
+	return print_unsigned((boost::uint64_t)value,buffer);
+}
+
+/// Format a floating-point number as a short decimal string that parses back to exactly the same value.
+std::size_t lsl::print_float(float value, char *buffer) {
+	boost::uint32_t bits; memcpy(&bits,&value,sizeof(bits));
+	return format_ieee((bits >> 31) != 0, (int)((bits >> 23) & 0xFF), bits & 0x7FFFFF, 23, 0xFF, 150, buffer);
+}
+
+/// Format a floating-point number as a short decimal string that parses back to exactly the same value.
+std::size_t lsl::print_double(double value, char *buffer) {
+	boost::uint64_t bits; memcpy(&bits,&value,sizeof(bits));
+	return format_ieee((bits >> 63) != 0, (int)((bits >> 52) & 0x7FF), bits & UINT64_C(0xFFFFFFFFFFFFF), 52, 0x7FF, 1075, buffer);
+}
+
+/// Parse an integer in decimal notation (the whole range must be consumed); returns false if malformed or out of range.
+bool lsl::parse_unsigned(const char *begin, const char *end, boost::uint64_t &value) {
+	if (begin != end && *begin == '+')
+		begin++;
+	if (begin == end)
+		return false;
+	boost::uint64_t result = 0;
+	for (; begin != end; begin++) {
+		unsigned digit = (unsigned)(*begin - '0');
+		if (digit > 9 || result > (std::numeric_limits<boost::uint64_t>::max() - digit)/10)
+			return false;
+		result = result*10 + digit;
+	}
+	value = result;
+	return true;
+}
+
+/// Parse an integer in decimal notation (the whole range must be consumed); returns false if malformed or out of range.
+bool lsl::parse_integer(const char *begin, const char *end, boost::int64_t &value) {
+	bool negative = (begin != end && *begin == '-');
+	if (negative && ++begin != end && *begin == '+')
+		return false;
+	boost::uint64_t magnitude;
+	if (!parse_unsigned(begin,end,magnitude) || magnitude > (boost::uint64_t)std::numeric_limits<boost::int64_t>::max() + (negative ? 1 : 0))
+		return false;
+	value = negative ? (boost::int64_t)(0 - magnitude) : (boost::int64_t)magnitude;
+	return true;
+}
+
+/// Parse a floating-point number (the whole range must be consumed, independently of the current locale); returns false if malformed or out of range
+/// (accepts the same inputs as boost::lexical_cast: infinities and NaNs, but no hexadecimal numbers).
+bool lsl::parse_double(const char *begin, const char *end, double &value) {
+	return parse_decimal_fast(begin,end,value) || parse_decimal_slow(begin,end,value);
+}
+
+/// Parse a floating-point number (the whole range must be consumed, independently of the current locale); returns false if malformed or out of range
+/// (accepts the same inputs as boost::lexical_cast: infinities and NaNs, but no hexadecimal numbers).
+bool lsl::parse_float(const char *begin, const char *end, float &value) {
+	double tmp;
+	if (!parse_double(begin,end,tmp))
+		return false;
+	value = (float)tmp;
+	// finite numbers beyond the range of a float are rejected (as with boost::lexical_cast)
+	const float inf = std::numeric_limits<float>::infinity();
+	return !((value == inf || value == -inf) && tmp != (double)value);
+}
@@ -0,0 +1,136 @@
+#ifndef VALUE_CONVERSION_H
+#define VALUE_CONVERSION_H
+
+#include <cstddef>
+#include <string>
+#include <limits>
+#include <typeinfo>
+#include <boost/cstdint.hpp>
+#include <boost/type_traits.hpp>
+#include <boost/lexical_cast.hpp>
+#include "common.h"
+
+namespace lsl {
+
+	/// The numeric channel format that has the same representation as a given value type (cf_undefined if there is none).
+	template<class T> struct numeric_format {
+		static const channel_format_t value =
+			boost::is_floating_point<T>::value ? (sizeof(T)==4 ? cf_float32 : (sizeof(T)==8 ? cf_double64 : cf_undefined)) :
+			boost::is_integral<T>::value ? (sizeof(T)==1 ? cf_int8 : (sizeof(T)==2 ? cf_int16 : (sizeof(T)==4 ? cf_int32 : (sizeof(T)==8 ? cf_int64 : cf_undefined)))) :
+			cf_undefined;
+	};
+
+	/**
+	* Convert an array of numeric values from one channel format into another.
+	* Conversions into an integer format saturate at the limits of the target type (NaN becomes 0) and
+	* floating-point values are truncated towards zero. Where the CPU supports it, the frequent format pairs
+	* are converted using SSE2 or AVX2 kernels (selected at run time).
+	* @param src_format The channel format of the source values.
+	* @param src The source values.
+	* @param dst_format The channel format of the destination values.
+	* @param dst The destination array (must not overlap with the source).
+	* @param num_values The number of values to convert.
+	*/
+	void convert_values(channel_format_t src_format, const void *src, channel_format_t dst_format, void *dst, std::size_t num_values);
+
+	/**
+	* Reverse the byte order of an array of values in place.
+	* @param data The values to convert (need not be aligned).
+	* @param value_size The size of each value in bytes (1, 2, 4 or 8).
+	* @param num_values The number of values.
+	*/
+	void reverse_byte_order(void *data, std::size_t value_size, std::size_t num_values);
+
+	/**
+	* Flush subnormal floating-point values to zero (retaining the sign) in place.
+	* @param format The channel format of the values (values of non-floating-point formats are left alone).
+	* @param data The values to process.
+	* @param num_values The number of values.
+	*/
+	void flush_subnormals(channel_format_t format, void *data, std::size_t num_values);
+
+
+	// === conversions between numbers and strings ===
+
+	/// The maximum number of characters written by the number printing functions.
+	const std::size_t max_number_chars = 32;
+
+	/// Format an integer in decimal notation; returns the number of characters written (no terminating zero).
+	std::size_t print_integer(boost::int64_t value, char *buffer);
+	std::size_t print_unsigned(boost::uint64_t value, char *buffer);
+
+	/**
+	* Format a floating-point number as a short decimal string that parses back to exactly the same value (using Grisu2,
+	* the result is the shortest such string in all but a small fraction of cases). The output does not depend on the 
+	* current locale; returns the number of characters written (no terminating zero).
+	*/
+	std::size_t print_float(float value, char *buffer);
+	std::size_t print_double(double value, char *buffer);
+
+	/// Parse an integer in decimal notation (the whole range must be consumed); returns false if malformed or out of range.
+	bool parse_integer(const char *begin, const char *end, boost::int64_t &value);
+	bool parse_unsigned(const char *begin, const char *end, boost::uint64_t &value);
+
+	/// Parse a floating-point number (the whole range must be consumed, independently of the current locale); returns false if malformed or out of range
+	/// (accepts the same inputs as boost::lexical_cast: infinities and NaNs, but no hexadecimal numbers).
+	bool parse_float(const char *begin, const char *end, float &value);
+	bool parse_double(const char *begin, const char *end, double &value);
+
+	/// Formatting and parsing of a value type (by category; single-byte integers are treated as characters, like boost::lexical_cast does).
+	enum number_kind { character_number, float_number, double_number, signed_number, unsigned_number };
+	template<class T> struct number_kind_of {
+		static const number_kind value = 
+			boost::is_floating_point<T>::value ? (sizeof(T) <= sizeof(float) ? float_number : double_number) :
+			sizeof(T) == 1 ? character_number : (boost::is_signed<T>::value ? signed_number : unsigned_number);
+	};
+	template<class T, number_kind Kind=number_kind_of<T>::value> struct number_io;
+	template<class T> struct number_io<T,character_number> {
+		static std::size_t format(T v, char *buffer) { buffer[0] = (char)v; return 1; }
+		static bool parse(const char *begin, const char *end, T &v) { if (end-begin != 1) return false; v = (T)*begin; return true; }
+	};
+	template<class T> struct number_io<T,float_number> {
+		static std::size_t format(T v, char *buffer) { return print_float((float)v,buffer); }
+		static bool parse(const char *begin, const char *end, T &v) { float tmp; if (!parse_float(begin,end,tmp)) return false; v = (T)tmp; return true; }
+	};
+	template<class T> struct number_io<T,double_number> {
+		static std::size_t format(T v, char *buffer) { return print_double((double)v,buffer); }
+		static bool parse(const char *begin, const char *end, T &v) { double tmp; if (!parse_double(begin,end,tmp)) return false; v = (T)tmp; return true; }
+	};
+	template<class T> struct number_io<T,signed_number> {
+		static std::size_t format(T v, char *buffer) { return print_integer((boost::int64_t)v,buffer); }
+		static bool parse(const char *begin, const char *end, T &v) { 
+			boost::int64_t tmp; 
+			if (!parse_integer(begin,end,tmp) || tmp < (boost::int64_t)std::numeric_limits<T>::min() || tmp > (boost::int64_t)std::numeric_limits<T>::max()) 
+				return false; 
+			v = (T)tmp; 
+			return true; 
+		}
+	};
+	template<class T> struct number_io<T,unsigned_number> {
+		static std::size_t format(T v, char *buffer) { return print_unsigned((boost::uint64_t)v,buffer); }
+		static bool parse(const char *begin, const char *end, T &v) { 
+			boost::uint64_t tmp; 
+			if (!parse_unsigned(begin,end,tmp) || tmp > (boost::uint64_t)std::numeric_limits<T>::max()) 
+				return false; 
+			v = (T)tmp; 
+			return true; 
+		}
+	};
+
+	/// Convert a number into a string (reusing the string's memory).
+	template<class T> void number_to_string(T value, std::string &result) {
+		char buffer[max_number_chars];
+		result.assign(buffer,number_io<T>::format(value,buffer));
+	}
+
+	/// Convert a string into a number; throws boost::bad_lexical_cast if the string does not hold a valid value of the type.
+	template<class T> T string_to_number(const std::string &str) {
+		T result;
+		if (!number_io<T>::parse(str.data(),str.data()+str.size(),result))
+			throw boost::bad_lexical_cast(typeid(std::string),typeid(T));
+		return result;
+	}
+
+}
+
+#endif
@@ -0,0 +1,210 @@
+#include "../../include/lsl_cpp.h"
+#include <boost/lexical_cast.hpp>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+#include <cfloat>
+using namespace std;
+
+// Round-trip test for the conversions between numbers and string-formatted channels:
+// numbers pushed into a cf_string outlet must come out of the inlet as strings that parse back to exactly the
+// same value (and in the shortest form for a few well-known values), and the strings must parse back into the
+// same numbers; strings that boost::lexical_cast rejects must still be rejected. Exits with 1 on any failure.
+// Afterwards, the time that the conversions take in push_sample()/pull_sample() is compared with the equivalent 
+// boost::lexical_cast conversions.
+
+int checks = 0, failures = 0;
+
+// record the outcome of a check
+void check(bool ok, const string &what) {
+	checks++;
+	if (!ok) {
+		failures++;
+		cout << "FAILED: " << what << endl;
+	}
+}
+
+// compare two values bit by bit (so that -0 != 0 and NaN == NaN)
+template<class T> bool identical(T a, T b) { return !memcmp(&a,&b,sizeof(T)); }
+
+// a pseudo-random 64-bit pattern (deterministic)
+unsigned long long next_bits() {
+	static unsigned long long state = 88172645463325252ULL;
+	state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+	return state;
+}
+
+// push a number, pull it back as a string and that string back as a number
+template<class T> void round_trip(lsl::stream_outlet &outlet, lsl::stream_inlet &inlet, T value, const char *expected=NULL) {
+	vector<T> numbers(1,value);
+	vector<string> strings(1);
+	outlet.push_sample(numbers);
+	if (!inlet.pull_sample(strings,5.0)) {
+		check(false,"no sample received");
+		return;
+	}
+	const string &str = strings[0];
+	if (expected)
+		check(str == expected,"formatted as " + str + " instead of " + expected);
+	T parsed = sizeof(T) == sizeof(float) ? (T)strtof(str.c_str(),NULL) : (T)strtod(str.c_str(),NULL);
+	check(identical(parsed,value) || (value != value && parsed != parsed),"formatted value " + str + " does not parse back to the same number");
+	outlet.push_sample(strings);
+	numbers[0] = 0;
+	if (!inlet.pull_sample(numbers,5.0)) {
+		check(false,"no sample received");
+		return;
+	}
+	check(identical(numbers[0],value) || (value != value && numbers[0] != numbers[0]),"string " + str + " was not parsed back into the original number");
+}
+
+// push a string and check whether it is accepted as a number (and if so, whether it has the expected value)
+template<class T> void parse(lsl::stream_outlet &outlet, lsl::stream_inlet &inlet, const string &str, bool valid, T expected=0) {
+	vector<string> strings(1,str);
+	vector<T> numbers(1);
+	outlet.push_sample(strings);
+	try {
+		if (!inlet.pull_sample(numbers,5.0)) {
+			check(false,"no sample received");
+			return;
+		}
+		check(valid,"invalid string \"" + str + "\" was accepted");
+		if (valid)
+			check(identical(numbers[0],expected) || (expected != expected && numbers[0] != numbers[0]),"string \"" + str + "\" was parsed into the wrong value");
+	} catch(std::exception &) {
+		check(!valid,"valid string \"" + str + "\" was rejected");
+	}
+}
+
+const int bench_channels = 32;			// number of channels of the benchmark stream
+const int bench_samples = 50000;		// number of samples converted by the benchmark
+
+// time the formatting and parsing of a block of values by push_sample()/pull_sample() against boost::lexical_cast
+void benchmark() {
+	// generate some test data
+	vector<vector<double> > data(bench_samples,vector<double>(bench_channels));
+	for (int s=0;s<bench_samples;s++)
+		for (int c=0;c<bench_channels;c++)
+			data[s][c] = (s*bench_channels+c) * 0.37 - 1000.0;
+
+	// reference: format and parse the values with lexical_cast
+	vector<string> strings(bench_channels);
+	vector<double> values(bench_channels);
+	double start = lsl::local_clock();
+	for (int s=0;s<bench_samples;s++)
+		for (int c=0;c<bench_channels;c++)
+			strings[c] = boost::lexical_cast<string>(data[s][c]);
+	double lexical_format = lsl::local_clock() - start;
+	start = lsl::local_clock();
+	for (int s=0;s<bench_samples;s++)
+		for (int c=0;c<bench_channels;c++)
+			values[c] = boost::lexical_cast<double>(strings[c]);
+	double lexical_parse = lsl::local_clock() - start;
+
+	// formatting: push numbers into a string outlet without consumers
+	lsl::stream_outlet idle_outlet(lsl::stream_info("StringConversionBenchIdle","Benchmark",bench_channels,lsl::IRREGULAR_RATE,lsl::cf_string,"StringConversionBenchIdle"));
+	start = lsl::local_clock();
+	for (int s=0;s<bench_samples;s++)
+		idle_outlet.push_sample(data[s],1.0);
+	double lsl_format = lsl::local_clock() - start;
+
+	// parsing: transmit the samples to an inlet that can buffer all of them (irregular-rate buffers are sized in hundreds of samples),
+	// then pull them back out as numbers
+	lsl::stream_outlet outlet(lsl::stream_info("StringConversionBench","Benchmark",bench_channels,lsl::IRREGULAR_RATE,lsl::cf_string,"StringConversionBench"),0,bench_samples/100+1);
+	vector<lsl::stream_info> results = lsl::resolve_stream("source_id","StringConversionBench",1,5.0);
+	if (results.empty()) {
+		check(false,"the benchmark stream could not be resolved");
+		return;
+	}
+	lsl::stream_inlet inlet(results[0],bench_samples/100+1);
+	inlet.open_stream(5.0);
+	for (int s=0;s<bench_samples;s++)
+		outlet.push_sample(data[s],1.0);
+	for (double deadline=lsl::local_clock()+10.0; inlet.samples_available() < (size_t)bench_samples && lsl::local_clock() < deadline; )
+		lsl::local_clock();
+	int mismatches = 0;
+	start = lsl::local_clock();
+	for (int s=0;s<bench_samples;s++)
+		if (!inlet.pull_sample(values,1.0) || values != data[s])
+			mismatches++;
+	double lsl_parse = lsl::local_clock() - start;
+	check(!mismatches,"benchmark samples did not round-trip exactly");
+
+	cout << "converted " << bench_samples*bench_channels << " values" << endl;
+	cout << "formatting: lexical_cast " << lexical_format << "s, push_sample " << lsl_format << "s" << endl;
+	cout << "parsing:    lexical_cast " << lexical_parse << "s, pull_sample " << lsl_parse << "s" << endl;
+}
+
+int main(int argc, char* argv[]) {
+	try {
+		lsl::stream_info info("StringConversionTest","Test",1,lsl::IRREGULAR_RATE,lsl::cf_string,"StringConversionTest");
+		lsl::stream_outlet outlet(info);
+		vector<lsl::stream_info> results = lsl::resolve_stream("source_id","StringConversionTest",1,5.0);
+		if (results.empty())
+			throw runtime_error("The test stream could not be resolved.");
+		lsl::stream_inlet inlet(results[0]);
+		inlet.open_stream(5.0);
+
+		// numbers that must be printed in their shortest form
+		round_trip(outlet,inlet,0.1,"0.1");
+		round_trip(outlet,inlet,4.35,"4.35");
+		round_trip(outlet,inlet,-2.5,"-2.5");
+		round_trip(outlet,inlet,100.0,"100");
+		round_trip(outlet,inlet,123456789.0,"123456789");
+		round_trip(outlet,inlet,1e22,"1e+22");
+		round_trip(outlet,inlet,1e-7,"1e-7");
+		round_trip(outlet,inlet,0.0,"0");
+		round_trip(outlet,inlet,-0.0,"-0");
+		round_trip(outlet,inlet,0.1f,"0.1");
+		round_trip(outlet,inlet,4.35f,"4.35");
+		// extremes
+		round_trip(outlet,inlet,DBL_MAX);
+		round_trip(outlet,inlet,-DBL_MIN);
+		round_trip(outlet,inlet,5e-324);
+		round_trip(outlet,inlet,1.0/3);
+		round_trip(outlet,inlet,FLT_MAX);
+		round_trip(outlet,inlet,FLT_MIN);
+		round_trip(outlet,inlet,1e-45f);
+		round_trip(outlet,inlet,numeric_limits<double>::infinity());
+		round_trip(outlet,inlet,-numeric_limits<float>::infinity());
+		round_trip(outlet,inlet,numeric_limits<double>::quiet_NaN());
+		// random bit patterns
+		for (int k=0; k<1000; k++) {
+			unsigned long long bits = next_bits();
+			double d; memcpy(&d,&bits,sizeof(d));
+			unsigned int fbits = (unsigned int)(bits >> 32);
+			float f; memcpy(&f,&fbits,sizeof(f));
+			round_trip(outlet,inlet,d);
+			round_trip(outlet,inlet,f);
+		}
+
+		// strings that boost::lexical_cast accepts
+		parse(outlet,inlet,"+1",true,1.0);
+		parse(outlet,inlet,"1.",true,1.0);
+		parse(outlet,inlet,".5",true,0.5);
+		parse(outlet,inlet,"1e5",true,1e5);
+		parse(outlet,inlet,"-17.25e-1",true,-1.725);
+		parse(outlet,inlet,"1e-400",true,0.0);
+		parse(outlet,inlet,"0.30000000000000000000001",true,0.3);
+		parse(outlet,inlet,"nan",true,numeric_limits<double>::quiet_NaN());
+		parse(outlet,inlet,"-inf",true,-numeric_limits<double>::infinity());
+		parse(outlet,inlet,"Infinity",true,numeric_limits<double>::infinity());
+		parse(outlet,inlet,"3.4e38",true,3.4e38f);
+		// ... and those that it rejects
+		const char *invalid[] = {"","abc","0x10","0X1p3","1e400","-1.8e308","1.5e"," 1","1 ","1,5","inf(1)","infinit",NULL};
+		for (int k=0; invalid[k]; k++) {
+			parse<double>(outlet,inlet,invalid[k],false);
+			parse<float>(outlet,inlet,invalid[k],false);
+		}
+		parse<float>(outlet,inlet,"1e40",false);
+		parse<float>(outlet,inlet,"-3.5e38",false);
+
+		benchmark();
+	} catch(std::exception &e) {
+		check(false,string("got an exception: ") + e.what());
+	}
+	cout << checks << " checks, " << failures << " failures" << endl;
+	return failures ? 1 : 0;
+}